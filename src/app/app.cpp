@@ -13,6 +13,7 @@
 
 #include <core/core.h>
 #include <core/core/memory.h>
+#include <core/core/sched.h>
 #include <core/os/time.h>
 #include <engine/graphics/vulkan/frame.h>
 #include <engine/graphics/vulkan/init.h>
@@ -187,7 +188,7 @@ void GPUDataStorage::uninit(subsystem::video& v) {
   LOG_TRACE("HERE");
   for (auto& mesh : meshes.iter())
     unload_mesh(v, mesh);
-  meshes.reset(core::get_named_allocator(core::AllocatorName::General));
+  meshes.deallocate();
   camera_descriptor.uninit(v);
   bindless_texture_descriptor.uninit(v);
   texture_cache.uninit(v.device);
@@ -291,6 +292,7 @@ void debug_stuff(App& app) {
 
   utils::config_bool("timing.wait_timing_target", &appconf.wait_timing_target);
   utils::config_u64("timing.timing_target_usec", &appconf.timing_target_usec);
+  utils::config_u64("timing.task_min_budget_usec", &appconf.task_min_budget_usec);
   if (app.state->config.wait_timing_target) {
     auto frame_report_scope = utils::scope_start("wait timing target"_hs);
     defer { utils::scope_end(frame_report_scope); };
@@ -401,6 +403,16 @@ EXPORT AppEvent new_frame(App& app) {
   utils::timings_frame_end();
   utils::timings_frame_start();
 
+  // The background tasks get what the last frames left of the timing target, spread over the ticks until the next one
+  {
+    auto& appconf = app.state->config;
+    u64 frame_ns  = utils::get_last_frame_dt().ns;
+    u64 target_ns = USEC(appconf.timing_target_usec);
+    u64 slack_ns  = target_ns > frame_ns ? target_ns - frame_ns : 0;
+
+    core::default_task_queue()->frame_budget_ns = MAX(slack_ns, (u64)USEC(appconf.task_min_budget_usec));
+  }
+
   AppEvent sev{};
   core::get_named_arena(core::ArenaName::Frame).reset();
 
@@ -412,6 +424,7 @@ EXPORT AppEvent new_frame(App& app) {
   // Things that happens once a frame are here
 
   profiling_window();
+  memory_window();
   debug_stuff(app);
 
   update(app);
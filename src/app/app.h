@@ -4,6 +4,7 @@
 #include "app/camera.h"
 #include "app/grid_renderer.h"
 #include "app/renderer.h"
+#include "core/containers/vm_vec.h"
 #include "core/core.h"
 #include <SDL3/SDL_events.h>
 #include <SDL3/SDL_gamepad.h>
@@ -68,7 +69,7 @@ struct InputState {
 struct GPUDataStorage {
   MeshLoader mesh_loader;
 
-  core::vec<GpuMesh> meshes;
+  core::vm_vec<GpuMesh> meshes;
   TextureCache texture_cache{};
   CameraDescriptor camera_descriptor;
   BindlessTextureDescriptor bindless_texture_descriptor;
@@ -108,6 +109,8 @@ struct AppState {
     bool crash_on_out_of_memory_budget = true;
 
     u64 timing_target_usec = 5500;
+    // Background tasks always get at least this much per frame, so they progress even over the timing target
+    u64 task_min_budget_usec = 500;
 
     GridConfig grid{};
 
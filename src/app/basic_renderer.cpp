@@ -2,6 +2,7 @@
 #include "app/renderer.h"
 #include "camera.h"
 
+#include <core/containers/small_vec.h>
 #include <core/core.h>
 #include <core/fs/fs.h>
 #include <core/math.h>
@@ -138,7 +139,7 @@ BindlessTextureDescriptor BindlessTextureDescriptor::init(subsystem::video& v) {
 void BindlessTextureDescriptor::update(VkDevice device, VkSampler sampler, const TextureCache& texture_cache) {
   auto scratch          = core::scratch_get();
   core::Allocator alloc = scratch;
-  core::vec<VkDescriptorImageInfo> image_infos;
+  core::small_vec<VkDescriptorImageInfo, 32> image_infos;
   image_infos.set_capacity(alloc, 1 + texture_cache.textures.size());
   image_infos.push(
       alloc,
@@ -22,121 +22,288 @@ void unload_mesh(subsystem::video& v, GpuMesh mesh) {
   vmaDestroyBuffer(v.device.allocator, mesh.index_buffer, mesh.index_buf_allocation);
 }
 
-// TODO: transform this big coroutine like task into a set of smaller, independant tasks
-struct LoadMeshTask {
+// A glTF file loaded by a job graph:
+//   parse (Worker) -> decode images (Worker) and convert primitives (Worker) -> upload (Main)
+// The parse job launches the decodes and the conversions, it holds ready until they are all launched
+// The upload records the GPU copies from what the workers produced, one primitive per step so that a step is bounded
+struct MeshLoad {
+  // the parse job allocates from it, nothing else does
   core::Arena* arena;
 
   vk::Device& device;
-  cgltf_data* data;
+  const char* path;
   MeshToken mesh_token;
   MeshLoader* mesh_loader;
   TextureCache* tex_cache;
+  cgltf_data* data = nullptr;
+
+  // The base color images decoded by the workers, indexed like data->images
+  struct DecodedImage {
+    cgltf_buffer_view* view;
+    int width, height;
+    u8* pixels; // from stbi, freed once uploaded
+    core::Job job;
+  };
+  core::storage<DecodedImage> images{};
+
+  // A primitive of a node, converted to the GPU formats by the workers, in scene order
+  struct Primitive {
+    cgltf_primitive* primitive;
+    math::Mat4 transform;
+    core::Maybe<usize> image;
+    core::storage<u8> indices;
+    usize index_size;
+    core::storage<Vertex> vertices;
+    core::Job job;
+  };
+  core::storage<Primitive> primitives{};
+  usize next_primitive = 0;
+
+  core::Job parse;
+  core::Job upload;
+  // the decodes and the conversions
+  core::JobCounter ready;
+  // set by MeshLoader::uninit, the upload stops without recording anything
+  bool cancelled = false;
+
+  core::Maybe<usize> base_color_image(const cgltf_primitive& primitive) {
+    if (primitive.material == nullptr) {
+      return {};
+    }
+    auto& material = *primitive.material;
+    if (!material.has_pbr_metallic_roughness || material.pbr_metallic_roughness.base_color_texture.texture == nullptr) {
+      return {};
+    }
+    return usize(cgltf_image_index(data, material.pbr_metallic_roughness.base_color_texture.texture->image));
+  }
+
+  // === Parse ===
 
-  usize stack[16];
-  usize stack_depth = 0;
+  template <class F>
+  static void visit_nodes(cgltf_node* node, F& f) {
+    f(node);
+    for (auto* child : core::storage{node->children_count, node->children}.iter()) {
+      visit_nodes(child, f);
+    }
+  }
 
-  core::TaskReturn operator()(core::TaskQueue*) {
-    auto s = utils::scope_start("Load Mesh Task"_hs);
+  static core::TaskReturn parse_task(MeshLoad* load, core::TaskQueue* queue) {
+    auto s = utils::scope_start("Parse Mesh"_hs);
     defer { utils::scope_end(s); };
+    load->parse_gltf(queue);
+    return core::TaskReturn::Stop;
+  }
 
-    auto cmdtok = mesh_loader->command_buffers.insert(
-        core::get_named_allocator(core::AllocatorName::General), CommandBuffer::init(device, mesh_loader->pool)
-    );
+  void parse_gltf(core::TaskQueue* queue) {
+    cgltf_options options = {
+        .type   = cgltf_file_type_glb,
+        .memory = {
+            .alloc_func =
+                [](void* arena, usize size) {
+                  core::Allocator alloc = *(core::Arena*)arena;
+                  return alloc.allocate_uninit(size);
+                },
+            .free_func =
+                [](void* arena, void* ptr) {
+                  core::Allocator alloc = *(core::Arena*)arena;
+                  return alloc.deallocate(ptr, 0);
+                },
+            .user_data = arena,
+        },
+    };
 
-    CommandBuffer command_buffer = mesh_loader->command_buffers.get(cmdtok).expect("idk why");
-    VkCommandBufferBeginInfo begin_info{
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    LOG2_TRACE("loading into memory ", path);
+    cgltf_result result = cgltf_parse_file(&options, path, &data);
+    if (result != cgltf_result_success) {
+      core::panic("can't load gltf: %u", result);
+    }
+    result = cgltf_load_buffers(&options, data, path);
+    if (result != cgltf_result_success) {
+      core::panic("can't load gltf: %u", result);
+    }
+
+    core::Allocator arena_alloc = *arena;
+    auto& scene                 = *data->scene;
+    auto roots                  = core::storage{scene.nodes_count, scene.nodes};
+
+    usize primitive_count = 0;
+    auto count            = [&](cgltf_node* node) {
+      if (node->mesh != nullptr) {
+        primitive_count += node->mesh->primitives_count;
+      }
     };
-    vkBeginCommandBuffer(command_buffer.cmd, &begin_info);
+    for (auto* root : roots.iter()) {
+      visit_nodes(root, count);
+    }
 
-    defer {
-      vkEndCommandBuffer(command_buffer.cmd);
-      command_buffer.submit(device.omni_queue);
+    images     = arena_alloc.allocate_array<DecodedImage>(data->images_count);
+    primitives = arena_alloc.allocate_array<Primitive>(primitive_count);
+
+    usize primitive_idx = 0;
+    auto collect        = [&](cgltf_node* node) {
+      if (node->mesh == nullptr) {
+        return;
+      }
+      math::Mat4 transform = math::Mat4::Id;
+      cgltf_node_transform_world(node, transform._coeffs);
+      for (auto& primitive : core::storage{node->mesh->primitives_count, node->mesh->primitives}.iter()) {
+        ASSERT(primitive.type == cgltf_primitive_type_triangles);
+        collect_primitive(queue, primitives[primitive_idx++], primitive, transform);
+      }
     };
+    for (auto* root : roots.iter()) {
+      visit_nodes(root, collect);
+    }
+  }
+
+  void collect_primitive(
+      core::TaskQueue* queue,
+      Primitive& p,
+      cgltf_primitive& primitive,
+      const math::Mat4& transform
+  ) {
+    core::Allocator arena_alloc = *arena;
+
+    p.primitive = &primitive;
+    p.transform = transform;
+
+    switch (primitive.indices->component_type) {
+    case cgltf_component_type_r_16u:
+      p.index_size = sizeof(u16);
+      break;
+    case cgltf_component_type_r_32u:
+      p.index_size = sizeof(u32);
+      break;
+    default:
+      ASSERTM(false, "Component type not supported");
+    }
+    p.indices  = arena_alloc.allocate_array_uninit<u8>(primitive.indices->count * p.index_size);
+    p.vertices = arena_alloc.allocate_array<Vertex>(primitive.attributes[0].data->count);
 
-    auto& scene = *data->scene;
+    new (&p.job) core::Job;
+    p.job.init(
+        core::Task::from(convert_primitive, &p, core::TaskAffinity::Worker, core::TaskPriority::Background), &ready
+    );
+    queue->launch(p.job);
 
-    if (stack_depth == 0) {
-      stack_depth++;
-      stack[0] = 0;
+    // images are decoded once, whatever the number of primitives using them
+    p.image = base_color_image(primitive);
+    if (p.image.is_none() || images[*p.image].view != nullptr) {
+      return;
     }
+    auto& image = images[*p.image];
+    image.view  = data->images[*p.image].buffer_view;
+    new (&image.job) core::Job;
+    image.job.init(
+        core::Task::from(decode_image, &image, core::TaskAffinity::Worker, core::TaskPriority::Background), &ready
+    );
+    queue->launch(image.job);
+  }
+
+  // === Decode and convert ===
 
-    upload_node(command_buffer.cmd, cmdtok, scene.nodes[stack[0]], 1);
+  static core::TaskReturn decode_image(DecodedImage* image, core::TaskQueue*) {
+    int channels;
+    image->pixels = stbi_load_from_memory(
+        (const stbi_uc*)image->view->buffer->data + image->view->offset, (int)image->view->size, &image->width,
+        &image->height, &channels, 4
+    );
+    ASSERTM(image->pixels != nullptr, "can't load texture: %s", stbi_failure_reason());
+    return core::TaskReturn::Stop;
+  }
 
-    if (stack_depth == 1) {
-      stack[0] += 1;
-      if (scene.nodes_count >= stack[0]) {
-        stack_depth--;
+  static core::TaskReturn convert_primitive(Primitive* p, core::TaskQueue*) {
+    auto& primitive = *p->primitive;
+    ASSERT(cgltf_accessor_unpack_indices(primitive.indices, p->indices.data, p->index_size, primitive.indices->count));
+
+    auto attributes = core::storage{primitive.attributes_count, primitive.attributes};
+    for (auto& attribute : attributes.iter()) {
+      ASSERT(p->vertices.size == attribute.data->count);
+      switch (attribute.type) {
+      case cgltf_attribute_type_position:
+      case cgltf_attribute_type_normal:
+      case cgltf_attribute_type_texcoord:
+        break;
+      case cgltf_attribute_type_tangent:
+        LOG_WARNING("tangent attribute type not supported");
+        break;
+      case cgltf_attribute_type_color:
+        LOG_WARNING("color attribute type not supported");
+        break;
+      default:
+        LOG_WARNING("<unknown> attribute type not supported");
+        break;
       }
     }
 
-    if (stack_depth == 0) {
-      stack_depth--;
-      mesh_loader->mesh_job_infos[mesh_token].expect("mesh info does not exist?!").staging_done = true;
-      LOG_INFO("mesh done!");
-      return core::TaskReturn::Stop;
-    } else {
-      return core::TaskReturn::Yield;
+    for (auto i : core::range{0zu, p->vertices.size}.iter()) {
+      auto& vertex = p->vertices[i];
+      for (auto& attribute : attributes.iter()) {
+        switch (attribute.type) {
+        case cgltf_attribute_type_position:
+          ASSERT(cgltf_accessor_read_float(attribute.data, i, &vertex.x, 3));
+          break;
+        case cgltf_attribute_type_normal:
+          ASSERT(cgltf_accessor_read_float(attribute.data, i, &vertex.nx, 3));
+          break;
+        case cgltf_attribute_type_texcoord:
+          if (attribute.index == 0) {
+            ASSERT(cgltf_accessor_read_float(attribute.data, i, &vertex.u, 2));
+          }
+          break;
+        default:
+          break;
+        }
+      }
     }
+    return core::TaskReturn::Stop;
   }
 
-  void upload_node(VkCommandBuffer cmd, CommandBufferToken cmdtok, cgltf_node* node, usize depth) {
-    if (depth == stack_depth) {
-      stack_depth++;
-      stack[depth] = 0;
+  // === Upload ===
 
-      math::Mat4 transform = math::Mat4::Id;
-      cgltf_node_transform_world(node, transform._coeffs);
-      if (node->mesh != nullptr) {
-        upload_mesh(cmd, cmdtok, *node->mesh, transform);
-      }
+  static core::TaskReturn upload_task(MeshLoad* load, core::TaskQueue*) {
+    auto s = utils::scope_start("Upload Mesh"_hs);
+    defer { utils::scope_end(s); };
+    if (load->cancelled) {
+      return core::TaskReturn::Stop;
     }
 
-    if (node->children_count > stack[depth]) {
-      upload_node(cmd, cmdtok, node->children[stack[depth]], depth + 1);
+    if (load->next_primitive == load->primitives.size) {
+      load->mesh_loader->mesh_job_infos[load->mesh_token].expect("mesh info does not exist?!").staging_done = true;
+      LOG_INFO("mesh done!");
+      return core::TaskReturn::Stop;
     }
 
-    if (stack_depth == depth + 1) {
-      stack[depth]++;
-      if (node->children_count <= stack[depth]) {
-        stack_depth--;
-      }
+    if (load->upload_primitive(load->primitives[load->next_primitive])) {
+      load->next_primitive++;
     }
+    return core::TaskReturn::Yield;
   }
 
-  core::TaskReturn upload_mesh(
-      VkCommandBuffer cmd,
-      CommandBufferToken cmdtok,
-      cgltf_mesh& mesh,
-      const math::Mat4& transform
-  ) {
+  // At most one texture upload, returns false if it has to be tried again
+  bool upload_primitive(Primitive& p) {
     const usize TEXEL_SIZE      = 4 * sizeof(u8);
     const VkFormat TEXEL_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
 
+    auto cmdtok = mesh_loader->command_buffers.insert(
+        core::get_named_allocator(core::AllocatorName::General), CommandBuffer::init(device, mesh_loader->pool)
+    );
+    CommandBuffer command_buffer = mesh_loader->command_buffers.get(cmdtok).expect("idk why");
+    VkCommandBuffer cmd          = command_buffer.cmd;
+    VkCommandBufferBeginInfo begin_info{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    };
+    vkBeginCommandBuffer(cmd, &begin_info);
+    defer {
+      vkEndCommandBuffer(cmd);
+      command_buffer.submit(device.omni_queue);
+    };
+
     // --- ESTIMATE MEMORY NEEDED ---
     usize staging_buffer_size{};
-    for (auto& primitive : core::storage{mesh.primitives_count, mesh.primitives}.iter()) {
-      staging_buffer_size = ALIGN_UP(staging_buffer_size, TEXEL_SIZE);
-
-      // === Materials ===
-      if (primitive.material != nullptr) {
-        auto& material = *primitive.material;
-        if (material.has_pbr_metallic_roughness &&
-            material.pbr_metallic_roughness.base_color_texture.texture != nullptr) {
-
-          auto image_index = cgltf_image_index(data, material.pbr_metallic_roughness.base_color_texture.texture->image);
-          if (tex_cache->entry({.src = "GLTF"_s, .texture_index = usize(image_index)}).is_empty()) {
-
-            auto buf_view = data->images[image_index].buffer_view;
-            int x, y, comp;
-            stbi_info_from_memory(
-                (const stbi_uc*)buf_view->buffer->data + buf_view->offset, (int)buf_view->size, &x, &y, &comp
-            );
-
-            staging_buffer_size += TEXEL_SIZE * usize(x) * usize(y);
-          }
-        }
-      }
+    if (p.image.is_some() && tex_cache->entry({.src = "GLTF"_s, .texture_index = *p.image}).is_empty()) {
+      auto& image         = images[*p.image];
+      staging_buffer_size = TEXEL_SIZE * usize(image.width) * usize(image.height);
     }
 
     // Note that if size == 0, there is no need for a command buffer Maybe do somthing about that
@@ -158,7 +325,7 @@ struct LoadMeshTask {
     }
     if (staging_.is_none()) {
       LOG_WARNING("can't get a staging buffer, probably not enough memory");
-      return core::TaskReturn::Yield;
+      return false;
     }
 
     auto staging_buffer_token = mesh_loader->inflight_staging_buffers.insert(
@@ -166,182 +333,113 @@ struct LoadMeshTask {
     );
     RefCountedStagingBuffer& staging = mesh_loader->inflight_staging_buffers[staging_buffer_token].value();
 
-    for (auto& primitive : core::storage{mesh.primitives_count, mesh.primitives}.iter()) {
-      ASSERT(primitive.type == cgltf_primitive_type_triangles);
-
-      auto tmp_arena            = arena->make_temp();
-      core::Allocator tmp_alloc = tmp_arena;
-
-      GpuMesh gpu_mesh{.transform = transform};
-      {
-        // === Index buffer ===
+    GpuMesh gpu_mesh{.transform = p.transform};
+    {
+      // === Index buffer ===
+      VkBufferCreateInfo index_buf_create_info{
+          .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+          .size                  = p.indices.size,
+          .usage                 = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 1,
+          .pQueueFamilyIndices   = &device.omni_queue_family_index
+      };
+      VmaAllocationCreateInfo alloc_create_info{
+          .flags         = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+          .usage         = VMA_MEMORY_USAGE_AUTO,
+          .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      };
+      vmaCreateBuffer(
+          device.allocator, &index_buf_create_info, &alloc_create_info, &gpu_mesh.index_buffer,
+          &gpu_mesh.index_buf_allocation, nullptr
+      );
+      vmaCopyMemoryToAllocation(device.allocator, p.indices.data, gpu_mesh.index_buf_allocation, 0, p.indices.size);
+      gpu_mesh.indice_count = (u32)(p.indices.size / p.index_size);
+      gpu_mesh.huge_indices = p.index_size == sizeof(u32);
+    }
 
-        core::LayoutInfo component_layout;
-        switch (primitive.indices->component_type) {
-        case cgltf_component_type_r_16u:
-          component_layout = core::default_layout_of<u16>();
-          break;
-        case cgltf_component_type_r_32u:
-          component_layout = core::default_layout_of<u32>();
-          break;
-        default:
-          ASSERTM(false, "Component type not supported");
-        }
-        auto indices = tmp_alloc.allocate_array(component_layout, primitive.indices->count);
-
-        ASSERT(cgltf_accessor_unpack_indices(primitive.indices, indices.data, component_layout.size, indices.size));
-        VkBufferCreateInfo index_buf_create_info{
-            .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-            .size                  = indices.into_bytes().size,
-            .usage                 = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
-            .queueFamilyIndexCount = 1,
-            .pQueueFamilyIndices   = &device.omni_queue_family_index
-        };
-        VmaAllocationCreateInfo alloc_create_info{
-            .flags         = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-            .usage         = VMA_MEMORY_USAGE_AUTO,
-            .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
-        vmaCreateBuffer(
-            device.allocator, &index_buf_create_info, &alloc_create_info, &gpu_mesh.index_buffer,
-            &gpu_mesh.index_buf_allocation, nullptr
-        );
-        vmaCopyMemoryToAllocation(
-            device.allocator, indices.data, gpu_mesh.index_buf_allocation, 0, indices.into_bytes().size
-        );
-        gpu_mesh.indice_count = (u32)indices.size / component_layout.size;
-        gpu_mesh.huge_indices = primitive.indices->component_type == cgltf_component_type_r_32u;
-      }
+    {
+      // === Vertex buffer ===
+      usize vertex_size = p.vertices.size * sizeof(Vertex);
+
+      VkBufferCreateInfo vertex_buf_create_info{
+          .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+          .size                  = vertex_size,
+          .usage                 = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+          .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+          .queueFamilyIndexCount = 1,
+          .pQueueFamilyIndices   = &device.omni_queue_family_index
+      };
+      VmaAllocationCreateInfo alloc_create_info{
+          .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+          .usage = VMA_MEMORY_USAGE_AUTO,
+      };
+      vmaCreateBuffer(
+          device.allocator, &vertex_buf_create_info, &alloc_create_info, &gpu_mesh.vertex_buffer,
+          &gpu_mesh.vertex_buf_allocation, nullptr
+      );
+      // copies and flushes
+      VK_ASSERT(vmaCopyMemoryToAllocation(
+          device.allocator, p.vertices.data, gpu_mesh.vertex_buf_allocation, 0, vertex_size
+      ));
+    }
 
-      {
-        // === Vertex buffer ===
-        usize vertex_size = primitive.attributes[0].data->count * sizeof(Vertex);
-
-        VkBufferCreateInfo vertex_buf_create_info{
-            .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-            .size                  = vertex_size,
-            .usage                 = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
-            .queueFamilyIndexCount = 1,
-            .pQueueFamilyIndices   = &device.omni_queue_family_index
-        };
-        VmaAllocationCreateInfo alloc_create_info{
-            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-            .usage = VMA_MEMORY_USAGE_AUTO,
-        };
-        vmaCreateBuffer(
-            device.allocator, &vertex_buf_create_info, &alloc_create_info, &gpu_mesh.vertex_buffer,
-            &gpu_mesh.vertex_buf_allocation, nullptr
-        );
-
-        void* dst_data = nullptr;
-        VK_ASSERT(vmaMapMemory(device.allocator, gpu_mesh.vertex_buf_allocation, &dst_data));
-
-        auto vertices = core::storage<Vertex>{primitive.attributes[0].data->count, (Vertex*)dst_data};
-        for (auto i : core::range{0zu, primitive.attributes[0].data->count}.iter()) {
-          for (auto& attribute : core::storage{primitive.attributes_count, primitive.attributes}.iter()) {
-            ASSERT(primitive.attributes[0].data->count == attribute.data->count);
-
-            switch (attribute.type) {
-            case cgltf_attribute_type_position:
-              ASSERT(cgltf_accessor_read_float(attribute.data, i, &vertices[i].x, 3));
-              break;
-            case cgltf_attribute_type_normal:
-              ASSERT(cgltf_accessor_read_float(attribute.data, i, &vertices[i].nx, 3));
-              break;
-            case cgltf_attribute_type_texcoord:
-              if (attribute.index == 0) {
-                ASSERT(cgltf_accessor_read_float(attribute.data, i, &vertices[i].u, 2));
-              }
-              break;
-            case cgltf_attribute_type_tangent:
-              LOG_WARNING("tangent attribute type not supported");
-              break;
-            case cgltf_attribute_type_color:
-              LOG_WARNING("color attribute type not supported");
-              break;
-            default:
-              LOG_WARNING("<unknown> attribute type not supported");
-              break;
-            }
-          }
-        }
+    // === Materials ===
+    if (p.image.is_some()) {
+      gpu_mesh.base_color_texture_idx =
+          tex_cache->entry({.src = "GLTF"_s, /* TODO: use path? */ .texture_index = *p.image})
+              .or_create([&]() {
+                auto& decoded_image = images[*p.image];
+                u32 x = (u32)decoded_image.width, y = (u32)decoded_image.height;
+
+                LOG_INFO("upload image index %zu of size %uX%u", *p.image, x, y);
+                vk::image2D::ConfigExtentValues config_extent_values{};
+                auto image = vk::image2D::create(
+                    device, config_extent_values,
+                    vk::image2D::Config{
+                        .format            = TEXEL_FORMAT,
+                        .extent            = {.constant{.width = x, .height = y}},
+                        .tiling            = VK_IMAGE_TILING_OPTIMAL,
+                        .usage             = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                        .alloc_create_info = {.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE},
+                    },
+                    {}
+                );
+
+                vk::pipeline_barrier(cmd, image.sync_to({VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL}));
+                staging.buffer.cmdCopyMemoryToImage(device, cmd, decoded_image.pixels, image, TEXEL_SIZE, {}, x, y);
+                vk::pipeline_barrier(cmd, image.sync_to({VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}));
+                stbi_image_free(decoded_image.pixels);
+                decoded_image.pixels = nullptr;
+
+                return image;
+              });
+    }
 
-        {
-          vmaUnmapMemory(device.allocator, gpu_mesh.vertex_buf_allocation);
-          usize local_offset = 0;
-          VK_ASSERT(
-              vmaFlushAllocations(device.allocator, 1, &gpu_mesh.vertex_buf_allocation, &local_offset, &vertex_size)
-          );
+    mesh_loader->mesh_job_infos[mesh_token].expect("mesh info does not exist?!").inflight += 1;
+    staging.inflight++;
+    mesh_loader->jobs.push_back(
+        core::get_named_allocator(core::AllocatorName::General),
+        Job{
+            mesh_token,
+            staging_buffer_token,
+            gpu_mesh,
+            cmdtok,
         }
-      }
+    );
+    return true;
+  }
 
-      // === Materials ===
-      if (primitive.material != nullptr) {
-        auto& material = *primitive.material;
-        if (material.has_pbr_metallic_roughness &&
-            material.pbr_metallic_roughness.base_color_texture.texture != nullptr) {
-
-          auto image_index = cgltf_image_index(data, material.pbr_metallic_roughness.base_color_texture.texture->image);
-
-          gpu_mesh.base_color_texture_idx =
-              tex_cache->entry({.src = "GLTF"_s, /* TODO: use path? */ .texture_index = usize(image_index)})
-                  .or_create([&]() {
-                    auto buf_view = data->images[image_index].buffer_view;
-                    int x, y, channels;
-
-                    /// This seems to be the slowest part now
-                    u8* mem = stbi_load_from_memory(
-                        (const stbi_uc*)buf_view->buffer->data + buf_view->offset, (int)buf_view->size, &x, &y,
-                        &channels, 4
-                    );
-
-                    ASSERTM(mem != 0, "can't load texture: %s", stbi_failure_reason());
-
-                    LOG_INFO("decode image index %zu of size %dX%d", image_index, x, y);
-                    vk::image2D::ConfigExtentValues config_extent_values{};
-                    auto image = vk::image2D::create(
-                        device, config_extent_values,
-                        vk::image2D::Config{
-                            .format            = TEXEL_FORMAT,
-                            .extent            = {.constant{.width = (u32)x, .height = (u32)y}},
-                            .tiling            = VK_IMAGE_TILING_OPTIMAL,
-                            .usage             = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                            .alloc_create_info = {.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE},
-                        },
-                        {}
-                    );
-
-                    vk::pipeline_barrier(cmd, image.sync_to({VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL}));
-                    staging.buffer.cmdCopyMemoryToImage(device, cmd, mem, image, TEXEL_SIZE, {}, (u32)x, (u32)y);
-                    vk::pipeline_barrier(cmd, image.sync_to({VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}));
-                    stbi_image_free(mem);
-
-                    return image;
-                  });
-        }
+  ~MeshLoad() {
+    for (auto& image : images.iter()) {
+      if (image.pixels != nullptr) {
+        stbi_image_free(image.pixels);
       }
-
-      mesh_loader->mesh_job_infos[mesh_token].expect("mesh info does not exist?!").inflight += 1;
-      staging.inflight++;
-      mesh_loader->jobs.push(
-          core::get_named_allocator(core::AllocatorName::General),
-          Job{
-              mesh_token,
-              staging_buffer_token,
-              gpu_mesh,
-              cmdtok,
-          }
-      );
     }
-
-    return core::TaskReturn::Yield;
-  }
-
-  ~LoadMeshTask() {
-    cgltf_free(data);
+    if (data != nullptr) {
+      cgltf_free(data);
+    }
     core::arena_dealloc(*arena);
   }
 };
@@ -349,54 +447,31 @@ struct LoadMeshTask {
 MeshToken MeshLoader::queue_mesh(vk::Device& device, core::str8 src, TextureCache& texture_cache) {
   LOG2_INFO("loading mesh from ", src);
   auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  auto queue = core::default_task_queue();
 
-  auto& arena                 = core::arena_alloc();
+  // the whole file goes through this arena, commit in big chunks
+  auto& arena                 = core::arena_alloc(DEFAULT_ARENA_CAPACITY, {.max_commit = MB(64zu), .huge_pages = true});
   core::Allocator arena_alloc = arena;
 
   MeshToken mesh_token  = mesh_job_infos.insert(alloc, {});
   MeshJobInfo& mesh_job = mesh_job_infos.get(mesh_token).expect("?");
 
-  const char* path      = fs::resolve_path(arena_alloc, src).expect("can't find mesh").cstring(arena_alloc);
-  cgltf_options options = {
-      .type   = cgltf_file_type_glb,
-      .memory = {
-          .alloc_func =
-              [](void* arena, usize size) {
-                core::Allocator alloc = *(core::Arena*)arena;
-                return alloc.allocate(size);
-              },
-          .free_func =
-              [](void* arena, void* ptr) {
-                core::Allocator alloc = *(core::Arena*)arena;
-                return alloc.deallocate(ptr, 0);
-              },
-          .user_data = &arena,
-      },
+  const char* path = fs::resolve_path(arena_alloc, src).expect("can't find mesh").cstring(arena_alloc);
+  auto* load       = new (arena_alloc.allocate<MeshLoad>()) MeshLoad{
+      &arena, device, path, mesh_token, this, &texture_cache,
   };
+  mesh_job.load = load;
 
-  LOG2_TRACE("loading into memory ", src);
-  cgltf_data* data    = NULL;
-  cgltf_result result = cgltf_parse_file(&options, path, &data);
-  if (result != cgltf_result_success) {
-    core::panic("can't load gltf: %u", result);
-  }
-  result = cgltf_load_buffers(&options, data, path);
-  if (result != cgltf_result_success) {
-    core::panic("can't load gltf: %u", result);
-  }
-
-  mesh_job.task  = core::default_task_queue()->allocate_job();
-  *mesh_job.task = core::Task::from(
-      [](LoadMeshTask* async_mesh_loader, core::TaskQueue* q) { return (*async_mesh_loader)(q); },
-      new (arena_alloc.allocate<LoadMeshTask>()) LoadMeshTask{
-          &arena,
-          device,
-          data,
-          mesh_token,
-          this,
-          &texture_cache,
-      }
+  load->parse.init(
+      core::Task::from(MeshLoad::parse_task, load, core::TaskAffinity::Worker, core::TaskPriority::Background),
+      &load->ready
+  );
+  load->upload.init(
+      core::Task::from(MeshLoad::upload_task, load, core::TaskAffinity::Main, core::TaskPriority::Background)
   );
+  load->upload.depends_on(load->ready);
+  queue->launch(load->parse);
+  queue->launch(load->upload);
 
   LOG2_INFO("loading of mesh ", src, " has been launched");
   return mesh_token;
@@ -408,35 +483,37 @@ void MeshLoader::work(vk::Device& device, OnPrimitiveLoaded callback, void* user
       continue;
     }
 
-    for (auto [idx, job] : core::enumerate_rev{jobs.iter_rev(), jobs.size() - 1}) {
-      if (job->command_buffer_token == command_buffer_token) {
-        // check if mesh is done after this job
-        auto& infos = mesh_job_infos[job->mesh_token].expect("counter does not exist!");
-        infos.inflight--;
+    // One pass over the queue: the jobs of this command buffer complete, the others are pushed back in the same order
+    for (usize remaining = jobs.size(); remaining > 0; remaining--) {
+      auto job = jobs.pop_front();
+      if (job.command_buffer_token != command_buffer_token) {
+        jobs.push_back(core::noalloc, job);
+        continue;
+      }
 
-        bool mesh_fully_loaded = infos.staging_done && infos.inflight == 0;
+      // check if mesh is done after this job
+      auto& infos = mesh_job_infos[job.mesh_token].expect("counter does not exist!");
+      infos.inflight--;
 
-        callback(userdata, device, job->mesh_token, job->mesh, mesh_fully_loaded);
+      bool mesh_fully_loaded = infos.staging_done && infos.inflight == 0;
 
-        if (mesh_fully_loaded) {
-          auto& load_task = *static_cast<LoadMeshTask*>(infos.task->data);
-          load_task.~LoadMeshTask();
-          core::default_task_queue()->deallocate_job(infos.task);
-          mesh_job_infos.destroy(job->mesh_token);
-        }
+      callback(userdata, device, job.mesh_token, job.mesh, mesh_fully_loaded);
 
-        auto job             = jobs.swap_last_pop(idx);
-        auto& staging_buffer = inflight_staging_buffers.get(job.staging_buffer_token).expect("huhu");
-        staging_buffer.inflight--;
-        if (staging_buffer.inflight == 0) {
-          if (staging_buffer.buffer.size > 0 && staging_buffers.size() < staging_buffers.capacity()) {
-            staging_buffers.push(core::noalloc, staging_buffer.buffer);
-          } else {
-            staging_buffer.buffer.uninit(device);
-          }
-          inflight_staging_buffers.destroy(job.staging_buffer_token);
-        };
+      if (mesh_fully_loaded) {
+        infos.load->~MeshLoad();
+        mesh_job_infos.destroy(job.mesh_token);
       }
+
+      auto& staging_buffer = inflight_staging_buffers.get(job.staging_buffer_token).expect("huhu");
+      staging_buffer.inflight--;
+      if (staging_buffer.inflight == 0) {
+        if (staging_buffer.buffer.size > 0 && staging_buffers.size() < staging_buffers.capacity()) {
+          staging_buffers.push(core::noalloc, staging_buffer.buffer);
+        } else {
+          staging_buffer.buffer.uninit(device);
+        }
+        inflight_staging_buffers.destroy(job.staging_buffer_token);
+      };
     }
 
     buffer->uninit(device, pool);
@@ -474,10 +551,13 @@ void MeshLoader::uninit(subsystem::video& v) {
   }
   staging_buffers.reset(core::noalloc);
 
+  // the loads still running finish their decodes and conversions, their upload stops right away
+  for (auto mesh_job_info : mesh_job_infos.iter()) {
+    mesh_job_info.load->cancelled = true;
+  }
   for (auto mesh_job_info : mesh_job_infos.iter()) {
-    auto& load_task = *static_cast<LoadMeshTask*>(mesh_job_info.task->data);
-    load_task.~LoadMeshTask();
-    core::default_task_queue()->deallocate_job(mesh_job_info.task);
+    core::default_task_queue()->wait(mesh_job_info.load->upload.done);
+    mesh_job_info.load->~MeshLoad();
   }
   mesh_job_infos.reset(core::get_named_allocator(core::AllocatorName::General));
 
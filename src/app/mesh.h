@@ -3,7 +3,9 @@
 
 #include "core/core.h"
 #include "core/core/sched.h"
+#include <core/containers/deque.h>
 #include <core/containers/handle_map.h>
+#include <core/containers/small_vec.h>
 #include <core/containers/vec.h>
 #include <core/math/math.h>
 #include <engine/graphics/subsystem.h>
@@ -214,6 +216,7 @@ struct RefCountedStagingBuffer {
 };
 
 struct TextureCache;
+struct MeshLoad;
 
 class MeshLoader {
 public:
@@ -229,16 +232,16 @@ private:
   struct MeshJobInfo {
     usize inflight    = 0;
     bool staging_done = false;
-    core::Task* task;
+    MeshLoad* load;
   };
   VkCommandPool pool;
-  core::vec<Job> jobs;
+  // in submission order
+  core::deque<Job> jobs;
   core::handle_map<MeshJobInfo, MeshToken> mesh_job_infos{};
   core::handle_map<CommandBuffer, CommandBufferToken> command_buffers{};
   core::handle_map<RefCountedStagingBuffer, StagingBufferToken> inflight_staging_buffers{};
-  core::array<StagingBuffer, 1> staging_buffers_storage{};
-  core::vec<StagingBuffer> staging_buffers{core::clear, staging_buffers_storage.storage()};
-  friend struct LoadMeshTask;
+  core::small_vec<StagingBuffer, 1> staging_buffers{};
+  friend struct MeshLoad;
 };
 
 #endif // INCLUDE_APP_MESH_LOADER_H_
@@ -1,5 +1,8 @@
+#include <core/containers/deque.h>
 #include <core/core.h>
+#include <core/core/memory_tracker.h>
 #include <core/math.h>
+#include <core/os/memory.h>
 #include <core/os/time.h>
 #include <engine/utils/time.h>
 
@@ -40,9 +43,10 @@ ImVec2 to_ImVec2(Vec2 v) {
   return ImVec2(v.x, v.y);
 }
 
+// offset frames are skipped from the back of frame_data, the newest frame
 void render_profiling_graph(
     core::Arena& arena_,
-    core::storage<frame_datum> frame_data,
+    const core::deque<frame_datum>& frame_data,
     usize offset,
     f32& max,
     f32 dt,
@@ -70,11 +74,17 @@ void render_profiling_graph(
   const Vec2 graph_right_for_frame =
       graph_pos + graph_size - graph_horizontal_margins - config.frame_margin_horizontal * Vec2::X;
 
+  const usize frame_drawn = frame_data.size() > offset ? MIN(max_frame_drawn, frame_data.size() - offset) : 0;
+  if (frame_drawn == 0) {
+    ImGui::Dummy(ImVec2(config.graph_width + config.legend_width, config.height));
+    return;
+  }
+  const usize newest_idx = frame_data.size() - 1 - offset;
+
   f32 max_s = {};
   {
-    for (usize idx = 0; idx < max_frame_drawn; idx++) {
-      const usize frame_idx   = (2 * frame_data.size - idx + offset) % frame_data.size;
-      const auto& frame_datum = frame_data[frame_idx];
+    for (usize idx = 0; idx < frame_drawn; idx++) {
+      const auto& frame_datum = frame_data[newest_idx - idx];
 
       max_s =
           MAX(max_s, (f32)frame_datum.sum.ns * 1e-9f * config.height /
@@ -93,9 +103,8 @@ void render_profiling_graph(
   drawList->AddRect(to_ImVec2(graph_pos), to_ImVec2(graph_pos + graph_size), Color{0x5F, 0x5F, 0x5F});
 
   // Draw graph
-  for (usize idx = 0; idx < max_frame_drawn; idx++) {
-    const usize frame_idx   = (2 * frame_data.size - idx + offset) % frame_data.size;
-    const auto& frame_datum = frame_data[frame_idx];
+  for (usize idx = 0; idx < frame_drawn; idx++) {
+    const auto& frame_datum = frame_data[newest_idx - idx];
     const Vec2 frame_left   = graph_right_for_frame - f32(idx) * (frame_width + frame_padding_horizontal) - frame_width;
 
     f32 cur_height = config.margin_vertical;
@@ -115,8 +124,7 @@ void render_profiling_graph(
   {
     const Vec2 legend_pos = graph_pos + graph_size + config.legend_horizontal_margin * Vec2::X;
 
-    const usize frame_idx   = (2 * frame_data.size + offset) % frame_data.size;
-    const auto& frame_datum = frame_data[frame_idx];
+    const auto& frame_datum = frame_data[newest_idx];
     const f32 textHeight    = config.height / (f32)frame_datum.as.size;
     const Vec2 textSizeY{0, ImGui::CalcTextSize("Text").y};
 
@@ -153,24 +161,51 @@ void render_profiling_graph(
 }
 
 #define PROFILER_MAX_FRAME 150
-#define PROFILER_MAX_FRAME_ENTRY 150
 
-static frame_datum::entry cpu_frame_data_entries[PROFILER_MAX_FRAME][PROFILER_MAX_FRAME_ENTRY]{};
-static frame_datum cpu_frame_data[PROFILER_MAX_FRAME]{};
+// The last PROFILER_MAX_FRAME frames, oldest first
+static core::deque<frame_datum> cpu_frame_data{};
 static f32 cpu_max = 0;
 
-static frame_datum::entry gpu_frame_data_entries[PROFILER_MAX_FRAME][PROFILER_MAX_FRAME_ENTRY]{};
-static frame_datum gpu_frame_data[PROFILER_MAX_FRAME]{};
+static core::deque<frame_datum> gpu_frame_data{};
 static f32 gpu_max = 0;
 
-static usize cur_frame_idx = 0;
-static bool freeze         = false;
-static int frame_offset    = 0;
+static bool freeze      = false;
+static int frame_offset = 0;
+
+// commit / decommit churn of the last frame
+static os::MemStats last_mem_stats{};
+static os::MemStats frame_mem_churn{};
 static core::array color_map{
     Color{0x84, 0x5e, 0xc2}, Color{0xd6, 0x5d, 0xb1}, Color{0xff, 0x6f, 0x91},
     Color{0xff, 0x96, 0x71}, Color{0xff, 0xc7, 0x5f},
 };
 
+// The entries of the dropped frame are reused when the entry count did not change
+static void push_frame(core::deque<frame_datum>& frame_data, const utils::timing_infos& frame_timing_infos) {
+  auto alloc                           = core::get_named_allocator(core::AllocatorName::General);
+  core::storage<frame_datum::entry> as = {};
+  if (frame_data.size() == PROFILER_MAX_FRAME) {
+    as = frame_data.pop_front().as;
+  }
+  if (as.size != frame_timing_infos.timings.size()) {
+    if (as.data != nullptr) {
+      alloc.deallocate(as.data, as.size * sizeof(frame_datum::entry));
+    }
+    as = frame_timing_infos.timings.size() > 0
+             ? alloc.allocate_array_uninit<frame_datum::entry>(frame_timing_infos.timings.size())
+             : core::storage<frame_datum::entry>{};
+  }
+
+  os::time sum{};
+  for (auto [entry_idx, timing_info] : core::enumerate{frame_timing_infos.timings.iter()}) {
+    as[entry_idx] = {
+        .name = timing_info->name, .t = timing_info->time, .color = color_map[entry_idx % color_map.size()]
+    };
+    sum = sum + timing_info->time;
+  }
+  frame_data.push_back(alloc, {.as = as, .sum = sum});
+}
+
 void profiling_window() {
   auto frame_report_scope = utils::scope_start("frame report"_hs);
   defer { utils::scope_end(frame_report_scope); };
@@ -178,43 +213,28 @@ void profiling_window() {
   auto scratch            = core::scratch_get();
   auto frame_timing_infos = utils::get_last_frame_timing_infos(*scratch, utils::scope_category::CPU);
 
+  auto mem_stats = os::mem_stats();
   if (!freeze) {
-    cur_frame_idx = (cur_frame_idx + 1) % PROFILER_MAX_FRAME;
-    {
-      os::time sum{};
-      for (auto [entry_idx, timing_info] : core::enumerate{frame_timing_infos.timings.iter()}) {
-        cpu_frame_data_entries[cur_frame_idx][entry_idx] = {
-            .name = timing_info->name, .t = timing_info->time, .color = color_map[entry_idx % color_map.size()]
-        };
-        sum = sum + timing_info->time;
-      }
-      cpu_frame_data[cur_frame_idx] = {
-          .as  = {frame_timing_infos.timings.size(), cpu_frame_data_entries[cur_frame_idx]},
-          .sum = sum,
-      };
-    }
+    frame_mem_churn = {
+        .commit_count   = mem_stats.commit_count - last_mem_stats.commit_count,
+        .decommit_count = mem_stats.decommit_count - last_mem_stats.decommit_count,
+        .commit_bytes   = mem_stats.commit_bytes - last_mem_stats.commit_bytes,
+        .decommit_bytes = mem_stats.decommit_bytes - last_mem_stats.decommit_bytes,
+        .page_faults    = mem_stats.page_faults - last_mem_stats.page_faults,
+    };
+  }
+  last_mem_stats = mem_stats;
 
-    {
-      auto frame_timing_infos = utils::get_last_frame_timing_infos(*scratch, utils::scope_category::GPU);
-      os::time sum{};
-      for (auto [entry_idx, timing_info] : core::enumerate{frame_timing_infos.timings.iter()}) {
-        gpu_frame_data_entries[cur_frame_idx][entry_idx] = {
-            .name = timing_info->name, .t = timing_info->time, .color = color_map[entry_idx % color_map.size()]
-        };
-        sum = sum + timing_info->time;
-      }
-      gpu_frame_data[cur_frame_idx] = {
-          .as  = {frame_timing_infos.timings.size(), gpu_frame_data_entries[cur_frame_idx]},
-          .sum = sum,
-      };
-    }
+  if (!freeze) {
+    push_frame(cpu_frame_data, frame_timing_infos);
+    push_frame(gpu_frame_data, utils::get_last_frame_timing_infos(*scratch, utils::scope_category::GPU));
   }
 
   if (ImGui::Begin("profiling")) {
     auto duration = os::duration_info::from_time(frame_timing_infos.stats.mean_frame_time);
     ImGui::Checkbox("Freeze", &freeze);
     ImGui::SameLine();
-    ImGui::DragInt("Offset", &frame_offset);
+    ImGui::DragInt("Offset", &frame_offset, 1.f, 0, PROFILER_MAX_FRAME - 1);
 
     render_profiling_config config{};
 
@@ -235,22 +255,99 @@ void profiling_window() {
         frame_timing_infos.stats.low_99.hz()
     );
 
+    ImGui::Text(
+        "MEM: commit %3zu (%6zu KB) | decommit %3zu (%6zu KB) | %4zu page faults", frame_mem_churn.commit_count,
+        frame_mem_churn.commit_bytes / 1024, frame_mem_churn.decommit_count, frame_mem_churn.decommit_bytes / 1024,
+        frame_mem_churn.page_faults
+    );
+
     ImVec2 v           = ImGui::GetContentRegionAvail();
     config.graph_width = v.x - config.legend_width;
     config.height      = v.y / 2 - 10;
     if (config.graph_width > 10 && config.height > 25) {
       f32 dt = (f32)frame_timing_infos.stats.raw_frame_time.ns * 1e-9f;
-      render_profiling_graph(
-          *scratch, cpu_frame_data,
-          (usize(int(ARRAY_SIZE(cpu_frame_data)) - frame_offset) + cur_frame_idx) % ARRAY_SIZE(cpu_frame_data), cpu_max,
-          dt, config
-      );
+      render_profiling_graph(*scratch, cpu_frame_data, (usize)MAX(frame_offset, 0), cpu_max, dt, config);
       ImGui::Text("GPU: ");
-      render_profiling_graph(
-          *scratch, gpu_frame_data,
-          (usize(int(ARRAY_SIZE(gpu_frame_data)) - frame_offset) + cur_frame_idx) % ARRAY_SIZE(gpu_frame_data), gpu_max,
-          dt, config
-      );
+      render_profiling_graph(*scratch, gpu_frame_data, (usize)MAX(frame_offset, 0), gpu_max, dt, config);
+    }
+  }
+  ImGui::End();
+}
+
+void memory_window() {
+  if (ImGui::Begin("memory")) {
+    bool tracking = core::mem_tracking_enabled();
+    if (ImGui::Checkbox("Track allocations", &tracking)) {
+      core::mem_tracking_enable(tracking);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Dump")) {
+      core::mem_tracking_dump("memory_dump.txt");
+    }
+
+    auto scratch  = core::scratch_get();
+    auto snapshot = core::mem_tracking_snapshot(*scratch);
+
+    auto scratch_stats = core::scratch_stats();
+    ImGui::Text(
+        "Scratch (main thread): %zu arenas | %zu gets, %zu shared | %zu live at most | peak %zu KB",
+        scratch_stats.arena_count, scratch_stats.get_count, scratch_stats.shared_count, scratch_stats.max_live_count,
+        scratch_stats.peak_bytes / 1024
+    );
+
+    if (ImGui::BeginTable("arenas", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("arena");
+      ImGui::TableSetupColumn("used");
+      ImGui::TableSetupColumn("committed");
+      ImGui::TableSetupColumn("reserved");
+      ImGui::TableSetupColumn("blocks");
+      ImGui::TableHeadersRow();
+      for (auto& a : snapshot.arenas.iter()) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(a.name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%zu KB", a.used / 1024);
+        ImGui::TableNextColumn();
+        ImGui::Text("%zu KB", a.committed / 1024);
+        ImGui::TableNextColumn();
+        ImGui::Text("%zu MB", a.reserved / (1024 * 1024));
+        ImGui::TableNextColumn();
+        ImGui::Text("%zu", a.blocks);
+      }
+      ImGui::EndTable();
+    }
+
+    for (auto& t : snapshot.trackers.iter()) {
+      if (!ImGui::TreeNode(
+              t.name, "%s: %zu KB live in %zu allocations (high water %zu KB)", t.name, t.live_bytes / 1024,
+              t.live_count, t.high_water / 1024
+          )) {
+        continue;
+      }
+      if (ImGui::BeginTable("tags", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("tag");
+        ImGui::TableSetupColumn("live");
+        ImGui::TableSetupColumn("count");
+        ImGui::TableSetupColumn("high water");
+        ImGui::TableSetupColumn("total");
+        ImGui::TableHeadersRow();
+        for (auto& tag : t.tags.iter()) {
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::TextUnformatted(tag.tag);
+          ImGui::TableNextColumn();
+          ImGui::Text("%zu KB", tag.live_bytes / 1024);
+          ImGui::TableNextColumn();
+          ImGui::Text("%zu", tag.live_count);
+          ImGui::TableNextColumn();
+          ImGui::Text("%zu KB", tag.high_water / 1024);
+          ImGui::TableNextColumn();
+          ImGui::Text("%zu", tag.total_count);
+        }
+        ImGui::EndTable();
+      }
+      ImGui::TreePop();
     }
   }
   ImGui::End();
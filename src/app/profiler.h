@@ -4,5 +4,6 @@
 #include <core/core.h>
 #include <imgui.h>
 void profiling_window();
+void memory_window();
 
 #endif // INCLUDE_APP_PROFILER_H_
@@ -207,7 +207,7 @@ Renderer::Renderer(core::Allocator alloc, GPUDataStorage& gpu_data, subsystem::v
   VK_ASSERT(vkAllocateCommandBuffers(v.device, &command_pool_allocate_info, &cmd));
 
   {
-    auto scratch = core::scratch_get();
+    auto scratch = core::scratch_get(alloc);
     auto deps    = main_renderer.file_deps(*scratch);
     for (auto f : deps.iter()) {
       auto handle = fs::register_modified_file_callback(
@@ -274,7 +274,7 @@ void Renderer::render(AppState* app_state, subsystem::video& v, vk::image2D& swa
         v.device,
         [](void* data, vk::Device& device, MeshToken, GpuMesh mesh, bool) {
           auto& env = *static_cast<MeshLoaderWorkEnv*>(data);
-          env.gpu_data.meshes.push(core::get_named_allocator(core::AllocatorName::General), mesh);
+          env.gpu_data.meshes.push(mesh);
           env.should_update_texture_descriptor = true;
         },
         &env
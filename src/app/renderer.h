@@ -8,11 +8,12 @@
 #include "imgui_renderer.h"
 #include "mesh.h"
 
+#include <core/containers/hash_map.h>
+#include <core/containers/small_vec.h>
 #include <core/fs/fs.h>
 #include <engine/graphics/vulkan/image.h>
 #include <loader/app_loader.h>
 #include <type_traits>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -24,9 +25,8 @@ struct TextureKey {
 };
 
 template <>
-class std::hash<TextureKey> {
-public:
-  std::size_t operator()(const TextureKey& k) const noexcept {
+struct core::hash_fn<TextureKey> {
+  u64 operator()(const TextureKey& k) const {
     core::hasher h{};
     h.hash(k.src.data, k.src.len);
     h.hash(k.texture_index);
@@ -37,7 +37,7 @@ public:
 struct TextureCache {
   // TODO: Roll my own
   std::vector<vk::image2D> textures{};
-  std::unordered_map<TextureKey, usize> textures_idx{};
+  core::hash_map<TextureKey, usize> textures_idx{};
 
   union entry_t {
     enum class Tag { Occupied, Empty } tag;
@@ -60,7 +60,7 @@ struct TextureCache {
       case Tag::Empty:
         empty.self->textures.push_back(f());
         usize idx = empty.self->textures.size() - 1;
-        empty.self->textures_idx.emplace(empty.key, idx);
+        empty.self->textures_idx.insert(core::get_named_allocator(core::AllocatorName::General), empty.key, idx);
         return idx;
       }
     }
@@ -69,9 +69,9 @@ struct TextureCache {
     }
   };
   entry_t entry(TextureKey key) {
-    auto it = textures_idx.find(key);
-    if (it != textures_idx.end()) {
-      return entry_t{.occupied = {.entry = it->second}};
+    auto it = textures_idx.get(key);
+    if (it.is_some()) {
+      return entry_t{.occupied = {.entry = *it}};
     } else {
       return entry_t{.empty = {.self = *this, .key = key}};
     }
@@ -80,7 +80,7 @@ struct TextureCache {
     for (auto& v : textures) {
       v.destroy(device);
     }
-    textures_idx.clear();
+    textures_idx.reset(core::get_named_allocator(core::AllocatorName::General));
     textures.clear();
   }
 
@@ -117,7 +117,7 @@ struct Renderer {
 
   MainRenderer main_renderer;
 
-  core::vec<fs::on_file_modified_handle> on_file_modified_handles;
+  core::small_vec<fs::on_file_modified_handle, 8> on_file_modified_handles;
 
   Renderer(core::Allocator alloc, GPUDataStorage& gpu_data, subsystem::video& v);
   void uninit(subsystem::video& v);
@@ -0,0 +1,91 @@
+#include "bench.h"
+
+#include <core/core.h>
+#include <core/os/memory.h>
+#include <mutex>
+
+// Every thread does small allocations from one shared arena
+// The ConcurrentArena does a CAS per allocation, the baseline puts a mutex around a plain Arena
+
+static const usize ALLOC_COUNT = 1 << 22;
+static const usize ALLOC_SIZE  = 48;
+
+BENCH(concurrent arena contention) {
+  for (usize thread_count = 1; thread_count <= bench_hardware_threads(); thread_count *= 2) {
+    auto& arena = core::concurrent_arena_alloc();
+    defer { core::concurrent_arena_dealloc(arena); };
+
+    usize alloc_per_thread = ALLOC_COUNT / thread_count;
+
+    auto t = bench_parallel(thread_count, [&](usize) {
+      core::Allocator alloc = arena;
+      for (usize i = 0; i < alloc_per_thread; i++) {
+        void* p = alloc.allocate(ALLOC_SIZE, 16);
+        core::blackbox(p);
+      }
+    });
+
+    auto scratch = core::scratch_get();
+    auto name    = core::string_builder{}.pushf(*scratch, "ConcurrentArena %zu threads", thread_count).commit(*scratch);
+    bench_report(name.cstring(*scratch), thread_count * alloc_per_thread, t);
+  }
+}
+
+BENCH(mutex arena contention) {
+  for (usize thread_count = 1; thread_count <= bench_hardware_threads(); thread_count *= 2) {
+    auto& arena = core::arena_alloc();
+    defer { core::arena_dealloc(arena); };
+    std::mutex m;
+
+    usize alloc_per_thread = ALLOC_COUNT / thread_count;
+
+    auto t = bench_parallel(thread_count, [&](usize) {
+      for (usize i = 0; i < alloc_per_thread; i++) {
+        std::lock_guard lock{m};
+        void* p = arena.allocate(ALLOC_SIZE, 16, "bench");
+        core::blackbox(p);
+      }
+    });
+
+    auto scratch = core::scratch_get();
+    auto name    = core::string_builder{}.pushf(*scratch, "Arena + mutex %zu threads", thread_count).commit(*scratch);
+    bench_report(name.cstring(*scratch), thread_count * alloc_per_thread, t);
+  }
+}
+
+// Fills a 1GB arena with 4KB allocations, counts the commit syscalls and the page faults
+// The page policy is what arenas did before commit policies existed
+BENCH(arena commit policy) {
+  struct {
+    const char* name;
+    core::ArenaCommitPolicy policy;
+  } policies[]{
+      {"page", {.min_commit = 0, .max_commit = 0}},
+      {"default", {}},
+      {"huge pages", {.huge_pages = true}},
+      {"prefault", {.prefault = true}},
+      {"huge pages + prefault", {.huge_pages = true, .prefault = true}},
+  };
+
+  const usize total = GB(1zu);
+  const usize size  = KB(4zu);
+  for (auto& [name, policy] : policies) {
+    auto& arena = core::arena_alloc(total + MB(4zu), policy);
+    defer { core::arena_dealloc(arena); };
+
+    auto before = os::mem_stats();
+    auto t      = bench_time([&] {
+      for (usize i = 0; i < total / size; i++) {
+        void* p = arena.allocate(size, 1, "bench");
+        core::blackbox(p);
+      }
+    });
+    auto after = os::mem_stats();
+
+    bench_report(name, total / size, t);
+    LOG_INFO(
+        "%-48s %10zu commits/GB %10zu page faults/GB", name, after.commit_count - before.commit_count,
+        after.page_faults - before.page_faults
+    );
+  }
+}
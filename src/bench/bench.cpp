@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "core/containers/vec.h"
+#include "core/core.h"
+
+#include <cstdio>
+#include <thread>
+
+struct bench {
+  const char* name;
+  void (*bench)();
+};
+
+static core::Arena* arena{};
+static core::vec<bench>& get_all_benches() {
+  static core::vec<bench> all_benches;
+  return all_benches;
+};
+
+void register_bench(const char* name, void (*bench)()) {
+  if (arena == nullptr) {
+    arena = &core::arena_alloc();
+  }
+
+  get_all_benches().push(*arena, {name, bench});
+}
+
+void bench_report(const char* name, usize op_count, os::time t) {
+  f64 ns_per_op = (f64)t.ns / (f64)op_count;
+  LOG_INFO(
+      "%-48s %10zu ops in %9.3f ms: %8.2f ns/op, %8.2f Mop/s", name, op_count, (f64)t.ns * 1e-6, ns_per_op,
+      1e3 / ns_per_op
+  );
+}
+
+usize bench_hardware_threads() {
+  return MAX(1zu, (usize)std::thread::hardware_concurrency());
+}
+
+// usage: benchcore [filter]
+// only the benches whose name contains filter are run
+int main(int argc, char* argv[]) {
+  core::setup_crash_handler();
+  log_register_global_formatter(core::log_timed_formatter, nullptr);
+  log_set_global_level(core::LogLevel::Info);
+
+  const char* filter = argc > 1 ? argv[1] : nullptr;
+  for (auto& bench : get_all_benches().iter()) {
+    if (filter != nullptr && strstr(bench.name, filter) == nullptr) {
+      continue;
+    }
+    LOG_INFO("RUNNING bench %s", bench.name);
+    bench.bench();
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef INCLUDE_BENCH_BENCH_H_
+#define INCLUDE_BENCH_BENCH_H_
+
+#include <core/core.h>
+#include <core/os/time.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+void register_bench(const char* name, void (*)());
+
+struct _register_bench {
+  template <class F>
+  _register_bench(const char* name, F f) {
+    register_bench(name, f);
+  }
+};
+
+#define BENCH__(v, name)                                  \
+  static void _bench_func_##v();                          \
+  const auto v = _register_bench{#name, _bench_func_##v}; \
+  static void _bench_func_##v()
+#define BENCH_(v, name) BENCH__(v, name)
+#define BENCH(name) BENCH_(CONCAT(_bench, __COUNTER__), name)
+
+// Logs the time per operation and the throughput
+void bench_report(const char* name, usize op_count, os::time t);
+
+usize bench_hardware_threads();
+
+template <class F>
+os::time bench_time(F&& f) {
+  auto start = os::time_monotonic();
+  f();
+  return os::time_monotonic().since(start);
+}
+
+// Runs f(thread_idx) on thread_count threads, all released at the same time
+// Returns the wall time between the release and the last thread finishing
+template <class F>
+os::time bench_parallel(usize thread_count, F&& f) {
+  std::atomic<bool> go{};
+  std::atomic<usize> ready{};
+
+  auto* threads = (std::thread*)calloc(thread_count, sizeof(std::thread));
+  defer { free(threads); };
+  for (usize idx = 0; idx < thread_count; idx++) {
+    new (&threads[idx]) std::thread([&, idx] {
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      f(idx);
+    });
+  }
+  while (ready.load() != thread_count) {
+  }
+
+  return bench_time([&] {
+    go.store(true, std::memory_order_release);
+    for (usize idx = 0; idx < thread_count; idx++) {
+      threads[idx].join();
+      threads[idx].~thread();
+    }
+  });
+}
+
+#endif // INCLUDE_BENCH_BENCH_H_
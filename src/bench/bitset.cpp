@@ -0,0 +1,62 @@
+#include "bench.h"
+
+#include <core/containers/bitset.h>
+#include <core/core.h>
+
+// A sparse visibility mask: 1 bit out of 64 is set
+// Going through the set bits with the bitset iterator vs testing a byte per entry
+
+static const usize BIT_COUNT  = 1 << 20;
+static const usize PASS_COUNT = 16;
+
+BENCH(bitset iterate) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::dyn_bitset bits;
+  bits.resize(alloc, BIT_COUNT);
+  auto bools = alloc.allocate_array<u8>(BIT_COUNT);
+  defer {
+    bits.reset(alloc);
+    alloc.deallocate(bools.data, BIT_COUNT);
+  };
+  for (usize i = 0; i < BIT_COUNT; i += 64) {
+    bits.set(i + (i / 64) % 64);
+    bools[i + (i / 64) % 64] = 1;
+  }
+
+  auto t = bench_time([&] {
+    usize sum = 0;
+    for (usize pass = 0; pass < PASS_COUNT; pass++) {
+      for (usize i = 0; i < BIT_COUNT; i++) {
+        if (bools[i]) {
+          sum += i;
+        }
+      }
+    }
+    core::blackbox(sum);
+  });
+  bench_report("byte array", BIT_COUNT * PASS_COUNT, t);
+
+  t = bench_time([&] {
+    usize sum = 0;
+    for (usize pass = 0; pass < PASS_COUNT; pass++) {
+      for (auto i : bits.iter()) {
+        sum += i;
+      }
+    }
+    core::blackbox(sum);
+  });
+  bench_report("bitset iter", BIT_COUNT * PASS_COUNT, t);
+
+  t = bench_time([&] {
+    core::dyn_bitset other;
+    other.resize(alloc, BIT_COUNT);
+    defer { other.reset(alloc); };
+    for (usize pass = 0; pass < PASS_COUNT; pass++) {
+      other.set_all();
+      other &= bits;
+    }
+    usize count = other.count();
+    core::blackbox(count);
+  });
+  bench_report("bitset set_all + and", BIT_COUNT * PASS_COUNT, t);
+}
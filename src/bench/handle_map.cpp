@@ -0,0 +1,58 @@
+#include "bench.h"
+
+#include <core/containers/handle_map.h>
+#include <core/containers/handle_soa_map.h>
+#include <core/core.h>
+
+// Sums one field of every element
+// handle_map stores whole structs, handle_soa_map only reads the column of the field
+
+static const usize ELEMENT_COUNT = 1 << 20;
+static const usize PASS_COUNT    = 16;
+
+struct transform {
+  f32 m[16];
+};
+struct object {
+  transform t;
+  f32 radius;
+  u32 flags;
+};
+
+BENCH(handle_map column sum) {
+  core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  core::handle_map<object> aos;
+  core::handle_soa_map<transform, f32, u32> soa;
+  for (usize i = 0; i < ELEMENT_COUNT; i++) {
+    aos.insert(alloc, object{{}, (f32)i, 0});
+    soa.insert(alloc, {}, (f32)i, 0);
+  }
+  defer {
+    aos.reset(alloc);
+    soa.reset(alloc);
+  };
+
+  auto t = bench_time([&] {
+    f32 sum = 0;
+    for (usize pass = 0; pass < PASS_COUNT; pass++) {
+      for (auto& o : aos.iter()) {
+        sum += o.radius;
+      }
+    }
+    core::blackbox(sum);
+  });
+  bench_report("handle_map", ELEMENT_COUNT * PASS_COUNT, t);
+
+  t = bench_time([&] {
+    f32 sum = 0;
+    for (usize pass = 0; pass < PASS_COUNT; pass++) {
+      auto radii = soa.column<1>();
+      for (usize i = 0; i < radii.size; i++) {
+        sum += radii[i];
+      }
+    }
+    core::blackbox(sum);
+  });
+  bench_report("handle_soa_map column", ELEMENT_COUNT * PASS_COUNT, t);
+}
@@ -0,0 +1,85 @@
+#include "bench.h"
+
+#include <core/containers/hash_map.h>
+#include <core/core.h>
+
+#include <unordered_map>
+
+// Random u64 keys: inserts, then lookups that hit, lookups that miss and removes
+
+static const usize KEY_COUNT = 1 << 20;
+
+static core::storage<u64> random_keys(core::Allocator alloc, u64 seed) {
+  auto keys = alloc.allocate_array_uninit<u64>(KEY_COUNT);
+  for (auto& k : keys.iter()) {
+    seed = seed * 6364136223846793005 + 1442695040888963407;
+    k    = seed ^ (seed >> 29);
+  }
+  return keys;
+}
+
+BENCH(hash map) {
+  auto scratch = core::scratch_get();
+  auto keys    = random_keys(*scratch, 1);
+  auto misses  = random_keys(*scratch, 2);
+
+  {
+    core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+    core::hash_map<u64, u64> m;
+
+    bench_report("hash_map insert", KEY_COUNT, bench_time([&] {
+                   for (auto& k : keys.iter()) {
+                     m.insert(alloc, k, k);
+                   }
+                 }));
+    bench_report("hash_map lookup hit", KEY_COUNT, bench_time([&] {
+                   u64 sum = 0;
+                   for (auto& k : keys.iter()) {
+                     sum += *m.get(k);
+                   }
+                   core::blackbox(sum);
+                 }));
+    bench_report("hash_map lookup miss", KEY_COUNT, bench_time([&] {
+                   usize found = 0;
+                   for (auto& k : misses.iter()) {
+                     found += m.contains(k);
+                   }
+                   core::blackbox(found);
+                 }));
+    bench_report("hash_map remove", KEY_COUNT, bench_time([&] {
+                   for (auto& k : keys.iter()) {
+                     m.remove(k);
+                   }
+                 }));
+    m.reset(alloc);
+  }
+
+  {
+    std::unordered_map<u64, u64> m;
+
+    bench_report("std::unordered_map insert", KEY_COUNT, bench_time([&] {
+                   for (auto& k : keys.iter()) {
+                     m.insert({k, k});
+                   }
+                 }));
+    bench_report("std::unordered_map lookup hit", KEY_COUNT, bench_time([&] {
+                   u64 sum = 0;
+                   for (auto& k : keys.iter()) {
+                     sum += m.find(k)->second;
+                   }
+                   core::blackbox(sum);
+                 }));
+    bench_report("std::unordered_map lookup miss", KEY_COUNT, bench_time([&] {
+                   usize found = 0;
+                   for (auto& k : misses.iter()) {
+                     found += m.contains(k);
+                   }
+                   core::blackbox(found);
+                 }));
+    bench_report("std::unordered_map remove", KEY_COUNT, bench_time([&] {
+                   for (auto& k : keys.iter()) {
+                     m.erase(k);
+                   }
+                 }));
+  }
+}
@@ -0,0 +1,39 @@
+#include "bench.h"
+
+#include <core/core.h>
+
+// Alloc / free pairs of mixed small sizes, the General heap against plain calloc / free
+
+static const usize ROUND_COUNT = 1 << 10;
+static const usize BATCH       = 1 << 10;
+
+static void heap_churn(const char* name, core::Allocator alloc) {
+  for (usize thread_count = 1; thread_count <= bench_hardware_threads(); thread_count *= 2) {
+    usize round_per_thread = ROUND_COUNT / thread_count;
+
+    auto t = bench_parallel(thread_count, [&](usize) {
+      void* ptrs[BATCH];
+      for (usize round = 0; round < round_per_thread; round++) {
+        for (usize i = 0; i < BATCH; i++) {
+          ptrs[i] = alloc.allocate(16 + (i * 40) % 512);
+          core::blackbox(ptrs[i]);
+        }
+        for (usize i = 0; i < BATCH; i++) {
+          alloc.deallocate(ptrs[i], 16 + (i * 40) % 512);
+        }
+      }
+    });
+
+    auto scratch = core::scratch_get();
+    auto label   = core::string_builder{}.pushf(*scratch, "%s %zu threads", name, thread_count).commit(*scratch);
+    bench_report(label.cstring(*scratch), thread_count * round_per_thread * BATCH, t);
+  }
+}
+
+BENCH(heap churn) {
+  heap_churn("General heap", {nullptr, &core::HeapVtable});
+}
+
+BENCH(malloc churn) {
+  heap_churn("malloc", {nullptr, &core::MallocVtable});
+}
@@ -0,0 +1,129 @@
+#include "bench.h"
+
+#include <core/core.h>
+#include <core/core/parallel.h>
+#include <core/core/sched.h>
+
+// The loops of a mesh load: unpacking vertices, reducing bounds, prefix sums of index counts
+// Serial, then on 1, 2, 4... threads: the default task queue gets thread_count - 1 workers, the caller is the last one
+
+static const usize VERTEX_COUNT = 1 << 21;
+static const usize GRAIN        = 4096;
+
+struct vertex {
+  f32 x, y, z;
+  f32 nx, ny, nz;
+  f32 u, v;
+};
+
+static void unpack(core::storage<vertex> chunk, usize first) {
+  for (usize i = 0; i < chunk.size; i++) {
+    f32 f       = (f32)(first + i);
+    vertex& out = chunk[i];
+    out.x       = f * 0.5f + 1.f;
+    out.y       = f * 0.25f - 2.f;
+    out.z       = f * 0.125f;
+    f32 n       = 1.f / (1.f + f * f);
+    out.nx      = n;
+    out.ny      = 1.f - n;
+    out.nz      = n * 0.5f;
+    out.u       = f / (f32)VERTEX_COUNT;
+    out.v       = 1.f - out.u;
+  }
+}
+
+static f32 max_x(core::storage<vertex> chunk) {
+  f32 m = 0;
+  for (auto& v : chunk.iter()) {
+    m = MAX(m, v.x);
+  }
+  return m;
+}
+
+template <class F>
+static void for_thread_counts(F&& f) {
+  auto* queue = core::default_task_queue();
+  for (usize thread_count = 1; thread_count <= bench_hardware_threads(); thread_count *= 2) {
+    if (thread_count > 1) {
+      queue->start_workers(thread_count - 1);
+    }
+    auto scratch = core::scratch_get();
+    f(core::string_builder{}.pushf(*scratch, "%zu threads", thread_count).commit(*scratch).cstring(*scratch));
+    queue->stop_workers();
+  }
+}
+
+BENCH(parallel_for vertex unpack) {
+  auto alloc    = core::get_named_allocator(core::AllocatorName::General);
+  auto vertices = alloc.allocate_array<vertex>(VERTEX_COUNT);
+  defer { alloc.deallocate(vertices.data, vertices.size * sizeof(vertex)); };
+  // fault the pages in first
+  unpack(vertices, 0);
+
+  auto t = bench_time([&] { unpack(vertices, 0); });
+  bench_report("serial", VERTEX_COUNT, t);
+
+  for_thread_counts([&](const char* name) {
+    auto t = bench_time([&] {
+      core::parallel_for(vertices, GRAIN, [](core::storage<vertex> chunk, usize first, core::Arena&) {
+        unpack(chunk, first);
+      });
+    });
+    bench_report(name, VERTEX_COUNT, t);
+  });
+}
+
+BENCH(parallel_reduce bounds) {
+  auto alloc    = core::get_named_allocator(core::AllocatorName::General);
+  auto vertices = alloc.allocate_array<vertex>(VERTEX_COUNT);
+  defer { alloc.deallocate(vertices.data, vertices.size * sizeof(vertex)); };
+  unpack(vertices, 0);
+
+  f32 m;
+  auto t = bench_time([&] { m = max_x(vertices); });
+  core::blackbox(m);
+  bench_report("serial", VERTEX_COUNT, t);
+
+  for_thread_counts([&](const char* name) {
+    auto t = bench_time([&] {
+      m = core::parallel_reduce(
+          vertices, GRAIN, 0.f, [](core::storage<vertex> chunk, usize, core::Arena&) { return max_x(chunk); },
+          [](f32 a, f32 b) { return MAX(a, b); }
+      );
+    });
+    core::blackbox(m);
+    bench_report(name, VERTEX_COUNT, t);
+  });
+}
+
+BENCH(parallel_scan index offsets) {
+  const usize count = 1 << 23;
+  auto alloc        = core::get_named_allocator(core::AllocatorName::General);
+  auto counts       = alloc.allocate_array<u32>(count);
+  auto offsets      = alloc.allocate_array<u32>(count);
+  defer {
+    alloc.deallocate(counts.data, counts.size * sizeof(u32));
+    alloc.deallocate(offsets.data, offsets.size * sizeof(u32));
+  };
+  for (usize i = 0; i < count; i++) {
+    counts[i] = (u32)(i % 7);
+  }
+
+  auto t = bench_time([&] {
+    u32 acc = 0;
+    for (usize i = 0; i < count; i++) {
+      acc        += counts[i];
+      offsets[i]  = acc;
+    }
+  });
+  bench_report("serial", count, t);
+
+  for_thread_counts([&](const char* name) {
+    auto t = bench_time([&] {
+      core::parallel_scan(core::storage<const u32>{counts.size, counts.data}, offsets, 4 * GRAIN, 0u, [](u32 a, u32 b) {
+        return a + b;
+      });
+    });
+    bench_report(name, count, t);
+  });
+}
@@ -0,0 +1,63 @@
+#include "bench.h"
+
+#include <core/core.h>
+#include <core/core/sched.h>
+#include <core/core/sort.h>
+
+#include <algorithm>
+
+// A draw list: a u64 sort key and the index of the draw
+
+static const usize DRAW_COUNT = 1 << 20;
+
+struct draw {
+  u64 key;
+  u32 idx;
+};
+
+static void fill_keys(core::storage<u64> keys, core::storage<u32> idx) {
+  u64 state = 0x9E3779B97F4A7C15;
+  for (usize i = 0; i < keys.size; i++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    // pipeline, texture, mesh
+    keys[i] = core::sort_key{}.push(state % 8, 8).push((state >> 8) % 1024, 16).push(i, 32).finish();
+    idx[i]  = (u32)i;
+  }
+}
+
+BENCH(sort draw keys) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  auto keys  = alloc.allocate_array<u64>(DRAW_COUNT);
+  auto idx   = alloc.allocate_array<u32>(DRAW_COUNT);
+  auto draws = alloc.allocate_array<draw>(DRAW_COUNT);
+  defer {
+    alloc.deallocate(keys.data, keys.size * sizeof(u64));
+    alloc.deallocate(idx.data, idx.size * sizeof(u32));
+    alloc.deallocate(draws.data, draws.size * sizeof(draw));
+  };
+
+  fill_keys(keys, idx);
+  for (usize i = 0; i < DRAW_COUNT; i++) {
+    draws[i] = {keys[i], idx[i]};
+  }
+  auto t = bench_time([&] {
+    std::sort(draws.data, draws.data + draws.size, [](const draw& a, const draw& b) { return a.key < b.key; });
+  });
+  bench_report("std::sort", DRAW_COUNT, t);
+
+  fill_keys(keys, idx);
+  t = bench_time([&] { core::radix_sort(keys, idx); });
+  bench_report("radix_sort", DRAW_COUNT, t);
+
+  // every hardware thread, the caller is the last one
+  auto* queue = core::default_task_queue();
+  if (bench_hardware_threads() > 1) {
+    queue->start_workers(bench_hardware_threads() - 1);
+  }
+  fill_keys(keys, idx);
+  t = bench_time([&] { core::radix_sort_parallel(keys, idx); });
+  bench_report("radix_sort_parallel", DRAW_COUNT, t);
+  queue->stop_workers();
+}
@@ -0,0 +1,149 @@
+#include "bench.h"
+
+#include <core/containers/sync.h>
+#include <core/core.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+static const usize ITEM_COUNT     = 1 << 22;
+static const usize QUEUE_CAPACITY = 1024;
+
+// Throughput: producers push ITEM_COUNT items in total, consumers pop them
+// Threads yield when the queue is full / empty, so that the benches still progress with fewer cores than threads
+
+BENCH(spsc queue throughput) {
+  auto scratch = core::scratch_get();
+  core::sync::spsc_queue<usize> q;
+  q.init(*scratch, QUEUE_CAPACITY);
+
+  auto t = bench_parallel(2, [&](usize idx) {
+    if (idx == 0) {
+      for (usize i = 0; i < ITEM_COUNT; i++) {
+        while (!q.try_push(i)) {
+          std::this_thread::yield();
+        }
+      }
+    } else {
+      for (usize i = 0; i < ITEM_COUNT;) {
+        if (q.try_pop().is_some()) {
+          i++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+  });
+  bench_report("spsc_queue 1 -> 1", ITEM_COUNT, t);
+}
+
+BENCH(mpmc queue throughput) {
+  for (usize pair_count = 1; pair_count <= MAX(1zu, bench_hardware_threads() / 2); pair_count *= 2) {
+    auto scratch = core::scratch_get();
+    core::sync::mpmc_queue<usize> q;
+    q.init(*scratch, QUEUE_CAPACITY);
+
+    usize per_thread = ITEM_COUNT / pair_count;
+    auto t           = bench_parallel(2 * pair_count, [&](usize idx) {
+      if (idx % 2 == 0) {
+        for (usize i = 0; i < per_thread; i++) {
+          while (!q.try_push(i)) {
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        for (usize i = 0; i < per_thread;) {
+          if (q.try_pop().is_some()) {
+          i++;
+        } else {
+          std::this_thread::yield();
+        }
+        }
+      }
+    });
+
+    auto name = core::string_builder{}.pushf(*scratch, "mpmc_queue %zu -> %zu", pair_count, pair_count).commit(*scratch);
+    bench_report(name.cstring(*scratch), pair_count * per_thread, t);
+  }
+}
+
+BENCH(mutex queue throughput) {
+  // baseline: a ring buffer behind a mutex
+  for (usize pair_count = 1; pair_count <= MAX(1zu, bench_hardware_threads() / 2); pair_count *= 2) {
+    auto scratch = core::scratch_get();
+    std::mutex m;
+    usize buffer[QUEUE_CAPACITY];
+    usize head = 0, tail = 0;
+
+    usize per_thread = ITEM_COUNT / pair_count;
+    auto t           = bench_parallel(2 * pair_count, [&](usize idx) {
+      if (idx % 2 == 0) {
+        for (usize i = 0; i < per_thread;) {
+          m.lock();
+          bool pushed = tail - head < QUEUE_CAPACITY;
+          if (pushed) {
+            buffer[tail++ % QUEUE_CAPACITY] = i++;
+          }
+          m.unlock();
+          if (!pushed) {
+            std::this_thread::yield();
+          }
+        }
+      } else {
+        for (usize i = 0; i < per_thread;) {
+          m.lock();
+          bool popped = head != tail;
+          if (popped) {
+            core::blackbox(buffer[head++ % QUEUE_CAPACITY]);
+            i++;
+          }
+          m.unlock();
+          if (!popped) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+
+    auto name = core::string_builder{}.pushf(*scratch, "mutex queue %zu -> %zu", pair_count, pair_count).commit(*scratch);
+    bench_report(name.cstring(*scratch), pair_count * per_thread, t);
+  }
+}
+
+// Latency: a token goes back and forth between two threads through two queues
+// The reported time per op is a round trip
+
+static const usize ROUND_TRIPS = 1 << 18;
+
+template <class Queue>
+static void bench_round_trip(const char* name) {
+  auto scratch = core::scratch_get();
+  Queue ping, pong;
+  ping.init(*scratch, QUEUE_CAPACITY);
+  pong.init(*scratch, QUEUE_CAPACITY);
+
+  auto t = bench_parallel(2, [&](usize idx) {
+    auto& in  = idx == 0 ? pong : ping;
+    auto& out = idx == 0 ? ping : pong;
+    if (idx == 0) {
+      out.try_push(0);
+    }
+    for (usize i = 0; i < ROUND_TRIPS; i++) {
+      core::Maybe<usize> v;
+      while ((v = in.try_pop()).is_none()) {
+        std::this_thread::yield();
+      }
+      if (idx == 0 && i + 1 == ROUND_TRIPS) {
+        break;
+      }
+      out.try_push(*v + 1);
+    }
+  });
+  bench_report(name, ROUND_TRIPS, t);
+}
+
+BENCH(queue latency) {
+  bench_round_trip<core::sync::spsc_queue<usize>>("spsc_queue round trip");
+  bench_round_trip<core::sync::mpmc_queue<usize>>("mpmc_queue round trip");
+}
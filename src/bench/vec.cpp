@@ -0,0 +1,141 @@
+#include "bench.h"
+
+#include <core/containers/small_vec.h>
+#include <core/containers/stable_vec.h>
+#include <core/containers/vec.h>
+#include <core/containers/vm_vec.h>
+#include <core/core.h>
+#include <core/os/memory.h>
+
+// Pushes PUSH_COUNT elements one by one then reads them back
+// vec grows by try_resize then copy, stable_vec chains blocks, vm_vec commits pages in place
+
+static const usize PUSH_COUNT = 1 << 24;
+
+struct elem {
+  u64 a, b;
+};
+
+template <class F>
+static void bench_push(const char* name, F&& f) {
+  auto before = os::mem_stats();
+  auto t      = bench_time(f);
+  auto after  = os::mem_stats();
+
+  bench_report(name, PUSH_COUNT, t);
+  LOG_INFO(
+      "  %zu commits, %zu page faults", after.commit_count - before.commit_count,
+      after.page_faults - before.page_faults
+  );
+}
+
+BENCH(vec push) {
+  bench_push("vec + heap", [] {
+    core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+    core::vec<elem> v;
+    for (usize i = 0; i < PUSH_COUNT; i++) {
+      v.push(alloc, {i, i});
+    }
+    u64 sum = 0;
+    for (auto& e : v.iter()) {
+      sum += e.a;
+    }
+    core::blackbox(sum);
+    v.reset(alloc);
+  });
+
+  bench_push("vec + arena", [] {
+    auto& arena = core::arena_alloc(GB(4zu));
+    defer { core::arena_dealloc(arena); };
+    core::vec<elem> v;
+    for (usize i = 0; i < PUSH_COUNT; i++) {
+      v.push(arena, {i, i});
+    }
+    u64 sum = 0;
+    for (auto& e : v.iter()) {
+      sum += e.a;
+    }
+    core::blackbox(sum);
+  });
+
+  bench_push("vec + arena, interleaved", [] {
+    // another allocation sits after the vec, try_resize fails and every growth copies
+    auto& arena = core::arena_alloc(GB(4zu));
+    defer { core::arena_dealloc(arena); };
+    core::vec<elem> v;
+    for (usize i = 0; i < PUSH_COUNT; i++) {
+      if (v.size() == v.capacity()) {
+        arena.allocate(16, 8, "bench");
+      }
+      v.push(arena, {i, i});
+    }
+    u64 sum = 0;
+    for (auto& e : v.iter()) {
+      sum += e.a;
+    }
+    core::blackbox(sum);
+  });
+
+  bench_push("stable_vec + arena", [] {
+    auto& arena = core::arena_alloc(GB(4zu));
+    defer { core::arena_dealloc(arena); };
+    core::stable_vec<elem, KB(64)> v;
+    for (usize i = 0; i < PUSH_COUNT; i++) {
+      v.push(arena, {i, i});
+    }
+    u64 sum = 0;
+    for (auto& e : v.iter()) {
+      sum += e.a;
+    }
+    core::blackbox(sum);
+  });
+
+  bench_push("vm_vec", [] {
+    core::vm_vec<elem> v;
+    defer { v.deallocate(); };
+    for (usize i = 0; i < PUSH_COUNT; i++) {
+      v.push({i, i});
+    }
+    u64 sum = 0;
+    for (auto& e : v.iter()) {
+      sum += e.a;
+    }
+    core::blackbox(sum);
+  });
+}
+
+// Short lived lists of a few elements, the common case small_vec is for
+static const usize SHORT_LIST_COUNT = 1 << 20;
+static const usize SHORT_LIST_SIZE  = 6;
+
+BENCH(vec short lists) {
+  auto t = bench_time([] {
+    core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+    u64 sum               = 0;
+    for (usize i = 0; i < SHORT_LIST_COUNT; i++) {
+      core::vec<elem> v;
+      for (usize j = 0; j < SHORT_LIST_SIZE; j++) {
+        v.push(alloc, {i, j});
+      }
+      sum += v[SHORT_LIST_SIZE - 1].b;
+      v.reset(alloc);
+    }
+    core::blackbox(sum);
+  });
+  bench_report("vec + heap", SHORT_LIST_COUNT, t);
+
+  t = bench_time([] {
+    core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+    u64 sum               = 0;
+    for (usize i = 0; i < SHORT_LIST_COUNT; i++) {
+      core::small_vec<elem, 8> v;
+      for (usize j = 0; j < SHORT_LIST_SIZE; j++) {
+        v.push(alloc, {i, j});
+      }
+      sum += v[SHORT_LIST_SIZE - 1].b;
+      v.reset(alloc);
+    }
+    core::blackbox(sum);
+  });
+  bench_report("small_vec<8>", SHORT_LIST_COUNT, t);
+}
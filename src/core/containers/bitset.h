@@ -0,0 +1,301 @@
+#ifndef INCLUDE_CONTAINERS_BITSET_H_
+#define INCLUDE_CONTAINERS_BITSET_H_
+
+#include "../core/fwd.h"
+#include "../core/memory.h"
+#include "core/core.h"
+
+#include <bit>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace core {
+
+// Word level operations shared by bitset and dyn_bitset
+//
+// Bits are stored in u64 words, bit i is bit i % 64 of word i / 64
+// The bits past the size are always 0, so counting and scanning never look at the size except for the unset bits
+// The bulk operations go through SSE2, two words per instruction, find_* skip 128 bits of zeros (or ones) at a time
+namespace bitset_words {
+inline void op_and(u64* dst, const u64* src, usize word_count) {
+  usize i = 0;
+  for (; i + 2 <= word_count; i += 2) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(a, b));
+  }
+  for (; i < word_count; i++) {
+    dst[i] &= src[i];
+  }
+}
+inline void op_or(u64* dst, const u64* src, usize word_count) {
+  usize i = 0;
+  for (; i + 2 <= word_count; i += 2) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(a, b));
+  }
+  for (; i < word_count; i++) {
+    dst[i] |= src[i];
+  }
+}
+// dst = dst & ~src
+inline void op_andnot(u64* dst, const u64* src, usize word_count) {
+  usize i = 0;
+  for (; i + 2 <= word_count; i += 2) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_andnot_si128(b, a));
+  }
+  for (; i < word_count; i++) {
+    dst[i] &= ~src[i];
+  }
+}
+
+inline usize popcount(const u64* words, usize word_count) {
+  usize count = 0;
+  for (usize i = 0; i < word_count; i++) {
+    count += (usize)std::popcount(words[i]);
+  }
+  return count;
+}
+
+// First word from start that is not equal to skip (0 or ~0), word_count if there is none
+inline usize find_word_not(const u64* words, usize start, usize word_count, u64 skip) {
+  usize i           = start;
+  const __m128i pat = _mm_set1_epi32((int)(u32)skip);
+  for (; i + 2 <= word_count; i += 2) {
+    __m128i w = _mm_loadu_si128((const __m128i*)(words + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(w, pat)) != 0xFFFF) {
+      break;
+    }
+  }
+  for (; i < word_count; i++) {
+    if (words[i] != skip) {
+      return i;
+    }
+  }
+  return word_count;
+}
+
+inline Maybe<usize> find_first_set(const u64* words, usize word_count, usize from) {
+  usize w = from / 64;
+  if (w >= word_count) {
+    return {};
+  }
+  u64 first = words[w] & (~0ull << (from % 64));
+  if (first != 0) {
+    return w * 64 + (usize)std::countr_zero(first);
+  }
+
+  w = find_word_not(words, w + 1, word_count, 0);
+  if (w == word_count) {
+    return {};
+  }
+  return w * 64 + (usize)std::countr_zero(words[w]);
+}
+
+inline Maybe<usize> find_first_unset(const u64* words, usize word_count, usize size, usize from) {
+  usize w = from / 64;
+  if (from >= size) {
+    return {};
+  }
+  u64 first = ~words[w] & (~0ull << (from % 64));
+  usize idx;
+  if (first != 0) {
+    idx = w * 64 + (usize)std::countr_zero(first);
+  } else {
+    w = find_word_not(words, w + 1, word_count, ~0ull);
+    if (w == word_count) {
+      return {};
+    }
+    idx = w * 64 + (usize)std::countr_zero(~words[w]);
+  }
+  // the bits past the size are 0, they look unset
+  return idx < size ? Maybe<usize>{idx} : Maybe<usize>{};
+}
+
+// Iterates the indices of the set bits, in increasing order
+struct set_bit_iterator : cpp_iter<usize, set_bit_iterator> {
+  using Item = usize;
+  const u64* words;
+  usize word_count;
+  usize word_idx;
+  u64 cur;
+
+  set_bit_iterator(const u64* words, usize word_count)
+      : words(words)
+      , word_count(word_count)
+      , word_idx(0)
+      , cur(word_count > 0 ? words[0] : 0) {}
+
+  Maybe<usize> next() {
+    while (cur == 0) {
+      if (++word_idx >= word_count) {
+        return {};
+      }
+      cur = words[word_idx];
+    }
+    usize idx  = word_idx * 64 + (usize)std::countr_zero(cur);
+    cur       &= cur - 1;
+    return idx;
+  }
+};
+} // namespace bitset_words
+
+// The operations, Self gives words(), word_count() and size()
+template <class Self>
+struct bitset_ops {
+  bool test(usize i) const {
+    ASSERT(i < self().size());
+    return (self().words()[i / 64] >> (i % 64)) & 1;
+  }
+  void set(usize i) {
+    ASSERT(i < self().size());
+    self().words()[i / 64] |= 1ull << (i % 64);
+  }
+  void unset(usize i) {
+    ASSERT(i < self().size());
+    self().words()[i / 64] &= ~(1ull << (i % 64));
+  }
+  void assign(usize i, bool value) {
+    value ? set(i) : unset(i);
+  }
+
+  void set_all() {
+    usize size = self().size();
+    memset(self().words(), 0xFF, size / 64 * sizeof(u64));
+    if (size % 64 != 0) {
+      self().words()[size / 64] = (1ull << (size % 64)) - 1;
+    }
+  }
+  void unset_all() {
+    memset(self().words(), 0, self().word_count() * sizeof(u64));
+  }
+
+  usize count() const {
+    return bitset_words::popcount(self().words(), self().word_count());
+  }
+  bool any() const {
+    return bitset_words::find_word_not(self().words(), 0, self().word_count(), 0) != self().word_count();
+  }
+  bool none() const {
+    return !any();
+  }
+
+  Maybe<usize> find_first_set(usize from = 0) const {
+    return bitset_words::find_first_set(self().words(), self().word_count(), from);
+  }
+  Maybe<usize> find_first_unset(usize from = 0) const {
+    return bitset_words::find_first_unset(self().words(), self().word_count(), self().size(), from);
+  }
+
+  // Both sides must have the same size
+  template <class Other>
+  Self& operator&=(const bitset_ops<Other>& other) {
+    ASSERT(self().size() == other.self().size());
+    bitset_words::op_and(self().words(), other.self().words(), self().word_count());
+    return self();
+  }
+  template <class Other>
+  Self& operator|=(const bitset_ops<Other>& other) {
+    ASSERT(self().size() == other.self().size());
+    bitset_words::op_or(self().words(), other.self().words(), self().word_count());
+    return self();
+  }
+  // Unsets the bits set in other
+  template <class Other>
+  Self& andnot(const bitset_ops<Other>& other) {
+    ASSERT(self().size() == other.self().size());
+    bitset_words::op_andnot(self().words(), other.self().words(), self().word_count());
+    return self();
+  }
+
+  auto iter() const {
+    return bitset_words::set_bit_iterator{self().words(), self().word_count()};
+  }
+
+  Self& self() {
+    return static_cast<Self&>(*this);
+  }
+  const Self& self() const {
+    return static_cast<const Self&>(*this);
+  }
+};
+
+// N bits, inline
+template <usize N>
+struct bitset : bitset_ops<bitset<N>> {
+  static constexpr usize WORD_COUNT = (N + 63) / 64;
+  u64 words_[WORD_COUNT]{};
+
+  constexpr usize size() const {
+    return N;
+  }
+  constexpr usize word_count() const {
+    return WORD_COUNT;
+  }
+  u64* words() {
+    return words_;
+  }
+  const u64* words() const {
+    return words_;
+  }
+};
+
+// A bitset sized at runtime
+// Like vec, the allocator is given to the operations that may allocate
+struct dyn_bitset : bitset_ops<dyn_bitset> {
+  u64* words_{};
+  usize size_{};
+  usize word_capacity_{};
+
+  // The new bits are unset
+  void resize(Allocator alloc, usize new_size) {
+    usize new_word_count = (new_size + 63) / 64;
+    if (new_word_count > word_capacity_) {
+      usize capacity = MAX(new_word_count, 2 * word_capacity_);
+      auto* words    = alloc.allocate_array_uninit<u64>(capacity, "dyn_bitset").data;
+      memcpy(words, words_, word_count() * sizeof(u64));
+      memset(words + word_count(), 0, (capacity - word_count()) * sizeof(u64));
+      if (word_capacity_ != 0) {
+        alloc.deallocate(words_, word_capacity_ * sizeof(u64), "dyn_bitset");
+      }
+      words_         = words;
+      word_capacity_ = capacity;
+    }
+
+    if (new_size < size_) {
+      // keep the bits past the size unset
+      if (new_size % 64 != 0) {
+        words_[new_size / 64] &= (1ull << (new_size % 64)) - 1;
+      }
+      memset(words_ + new_word_count, 0, (word_count() - new_word_count) * sizeof(u64));
+    }
+    size_ = new_size;
+  }
+
+  void reset(Allocator alloc) {
+    if (word_capacity_ != 0) {
+      alloc.deallocate(words_, word_capacity_ * sizeof(u64), "dyn_bitset");
+    }
+    *this = {};
+  }
+
+  constexpr usize size() const {
+    return size_;
+  }
+  constexpr usize word_count() const {
+    return (size_ + 63) / 64;
+  }
+  u64* words() {
+    return words_;
+  }
+  const u64* words() const {
+    return words_;
+  }
+};
+
+} // namespace core
+
+#endif // INCLUDE_CONTAINERS_BITSET_H_
@@ -1,8 +1,171 @@
 #ifndef INCLUDE_CONTAINERS_DEQUE_H_
 #define INCLUDE_CONTAINERS_DEQUE_H_
 
+#include "../core/fwd.h"
+#include "../core/memory.h"
+#include "core/core.h"
+
+#include <bit>
+#include <cstring>
+
 namespace core {
-struct deque {};
+// Growable ring buffer, push and pop at both ends
+//
+// The capacity is a power of two, an index into the ring is masked instead of wrapped
+// The elements are in at most two contiguous runs, as_slices() gives them in order for bulk copies
+// Like vec, the allocator is given to the operations that may allocate and the elements are memcpy'ed around
+template <class T>
+struct deque {
+  T* data_{};
+  usize capacity_{};
+  usize head_{}; // ring index of the front element
+  usize size_{};
+
+  constexpr void push_back(noalloc_t, T t) {
+    ASSERT(size() < capacity());
+    data_[(head_ + size_) & (capacity_ - 1)]  = t;
+    size_                                    += 1;
+  }
+  constexpr void push_back(Allocator alloc, T t) {
+    if (size() >= capacity()) {
+      set_capacity(alloc, MAX(4zu, 2 * capacity()));
+    }
+    push_back(noalloc, t);
+  }
+
+  constexpr void push_front(noalloc_t, T t) {
+    ASSERT(size() < capacity());
+    head_         = (head_ - 1) & (capacity_ - 1);
+    data_[head_]  = t;
+    size_        += 1;
+  }
+  constexpr void push_front(Allocator alloc, T t) {
+    if (size() >= capacity()) {
+      set_capacity(alloc, MAX(4zu, 2 * capacity()));
+    }
+    push_front(noalloc, t);
+  }
+
+  constexpr T pop_front() {
+    if (size_ == 0) {
+      panic("Trying to pop empty deque");
+    }
+
+    T t   = data_[head_];
+    head_ = (head_ + 1) & (capacity_ - 1);
+    size_--;
+    return t;
+  }
+  constexpr T pop_back() {
+    if (size_ == 0) {
+      panic("Trying to pop empty deque");
+    }
+
+    size_--;
+    return data_[(head_ + size_) & (capacity_ - 1)];
+  }
+
+  // Makes room for count elements
+  void reserve(Allocator alloc, usize count) {
+    if (count > capacity()) {
+      set_capacity(alloc, std::bit_ceil(count));
+    }
+  }
+
+  // Moves the elements to the start of a new buffer, new_capacity must be a power of two
+  void set_capacity(Allocator alloc, usize new_capacity) {
+    ASSERT(new_capacity >= size() && (new_capacity == 0 || std::has_single_bit(new_capacity)));
+    T* new_data = nullptr;
+    if (new_capacity != 0) {
+      new_data = alloc.allocate_array_uninit<T>(new_capacity, "deque::resize").data;
+      auto s   = as_slices();
+      memcpy((void*)new_data, s.first.data, s.first.size * sizeof(T));
+      memcpy((void*)(new_data + s.first.size), s.second.data, s.second.size * sizeof(T));
+    }
+    if (capacity_ != 0) {
+      alloc.deallocate((void*)data_, capacity_ * sizeof(T));
+    }
+
+    data_     = new_data;
+    capacity_ = new_capacity;
+    head_     = 0;
+  }
+
+  void reset(noalloc_t) {
+    head_ = 0;
+    size_ = 0;
+  }
+  void reset(Allocator alloc) {
+    reset(noalloc);
+    set_capacity(alloc, 0);
+  }
+
+  constexpr usize capacity() const {
+    return capacity_;
+  }
+  constexpr usize size() const {
+    return size_;
+  }
+
+  // i-th element from the front
+  constexpr const T& operator[](usize i) const {
+    ASSERT(i < size());
+    return data_[(head_ + i) & (capacity_ - 1)];
+  }
+  constexpr T& operator[](usize i) {
+    ASSERT(i < size());
+    return data_[(head_ + i) & (capacity_ - 1)];
+  }
+
+  Maybe<T&> front() {
+    return size() > 0 ? (*this)[0] : core::None<T&>();
+  }
+  Maybe<T&> back() {
+    return size() > 0 ? (*this)[size() - 1] : core::None<T&>();
+  }
+
+  template <class S>
+  struct slices {
+    storage<S> first;
+    storage<S> second;
+  };
+  // The elements from front to back, first then second
+  slices<T> as_slices() {
+    usize first = MIN(size_, capacity_ - head_);
+    return {{first, data_ + head_}, {size_ - first, data_}};
+  }
+  slices<const T> as_slices() const {
+    usize first = MIN(size_, capacity_ - head_);
+    return {{first, data_ + head_}, {size_ - first, data_}};
+  }
+
+  auto indices() const {
+    return range{0zu, size()};
+  }
+
+  struct iterator : cpp_iter<T&, iterator> {
+    using Item = T&;
+    deque* d;
+    usize idx;
+
+    iterator(deque* d)
+        : d(d)
+        , idx(0) {}
+
+    Maybe<T&> next() {
+      if (idx >= d->size()) {
+        return {};
+      }
+      return (*d)[idx++];
+    }
+  };
+
+  // Front to back
+  auto iter() {
+    return iterator{this};
+  }
+};
+
 } // namespace core
 
 #endif // INCLUDE_CONTAINERS_DEQUE_H_
@@ -0,0 +1,227 @@
+#ifndef INCLUDE_CONTAINERS_HANDLE_SOA_MAP_H_
+#define INCLUDE_CONTAINERS_HANDLE_SOA_MAP_H_
+
+#include "../core/fwd.h"
+#include "../core/memory.h"
+#include "core/containers/vec.h"
+#include "core/core.h"
+
+#include <cstring>
+#include <type_traits>
+
+#ifndef HANDLE_SOA_COLUMN_ALIGN
+  #define HANDLE_SOA_COLUMN_ALIGN 64
+#endif
+
+namespace core {
+
+// How a handle_soa_map splits its handles: the low index_bits are the slot, the other bits are the generation
+// A slot can be reused 2^generation_bits times before a stale handle may resolve again
+template <class Handle = core::handle_t<void, u64>, u32 index_bits = 32>
+struct handle_soa_layout {
+  using handle     = Handle;
+  using underlying = std::underlying_type_t<Handle>;
+
+  static constexpr u32 INDEX_BITS      = index_bits;
+  static constexpr u32 GENERATION_BITS = 8 * sizeof(underlying) - index_bits;
+  static_assert(INDEX_BITS > 0 && INDEX_BITS <= 32 && GENERATION_BITS > 0);
+
+  static constexpr underlying INDEX_MASK      = (underlying(1) << INDEX_BITS) - 1;
+  static constexpr underlying GENERATION_MASK = underlying(~underlying(0)) >> INDEX_BITS;
+
+  static constexpr handle make(underlying generation, underlying index) {
+    return static_cast<handle>((generation & GENERATION_MASK) << INDEX_BITS | index);
+  }
+  static constexpr underlying index(handle h) {
+    return static_cast<underlying>(h) & INDEX_MASK;
+  }
+  static constexpr underlying generation(handle h) {
+    return static_cast<underlying>(h) >> INDEX_BITS;
+  }
+};
+
+// A handle_map whose elements are split in columns, one per type of Columns
+// insertion: O(1)
+// deletion: O(1), the last row is moved into the hole of every column
+// access: O(1), a slot lookup then one load per column read
+//
+// Each column is contiguous and aligned on HANDLE_SOA_COLUMN_ALIGN: a loop over column<I>() only pulls the bytes
+// it reads through the cache, and the start of a column is aligned for SIMD loads
+// Like vec, the allocator is given to the operations that may allocate and the elements are memcpy'ed around
+// Not ordered, deletion and insertion invalidate the columns
+template <class Layout, class... Columns>
+struct basic_handle_soa_map {
+  using handle     = Layout::handle;
+  using underlying = Layout::underlying;
+  template <usize I>
+  using column_type = std::remove_reference_t<decltype(*core::get<I>(std::declval<tuple<Columns*...>&>()))>;
+
+  static constexpr usize COLUMN_COUNT = sizeof...(Columns);
+  static_assert(COLUMN_COUNT > 0);
+  static_assert((std::is_trivially_copyable_v<Columns> && ...));
+
+  // An index into slots, the handles of the rows are stored as one more column
+  struct slot {
+    underlying generation;
+    underlying index; // row when alive, next free slot otherwise
+  };
+  static constexpr underlying NO_SLOT = Layout::INDEX_MASK;
+
+  tuple<Columns*...> columns{};
+  handle* handles_{};
+  usize size_{};
+  usize capacity_{};
+
+  core::vec<slot> slots{};
+  underlying free_head = NO_SLOT;
+
+  handle insert(Allocator alloc, Columns... values) {
+    if (size_ == capacity_) {
+      set_capacity(alloc, MAX(16zu, 2 * capacity_));
+    }
+
+    underlying slot_idx;
+    if (free_head != NO_SLOT) {
+      slot_idx  = free_head;
+      free_head = slots[slot_idx].index;
+    } else {
+      ASSERTM(slots.size() < NO_SLOT, "handle_soa_map: too many slots (max supported is %zu)", (usize)NO_SLOT);
+      slot_idx = (underlying)slots.size();
+      slots.push(alloc, {0, 0});
+    }
+
+    usize row             = size_++;
+    slots[slot_idx].index = (underlying)row;
+    handle h              = Layout::make(slots[slot_idx].generation, slot_idx);
+    handles_[row]         = h;
+    write_row(row, std::make_index_sequence<COLUMN_COUNT>{}, values...);
+    return h;
+  }
+
+  // The row of h, none if h has been destroyed
+  Maybe<usize> row_of(handle h) const {
+    underlying slot_idx = Layout::index(h);
+    ASSERTM(slot_idx < slots.size(), "corrupt handle detected");
+    const slot& s = slots[slot_idx];
+    if (s.generation != Layout::generation(h)) {
+      return {};
+    }
+    return (usize)s.index;
+  }
+  bool contains(handle h) const {
+    return row_of(h).is_some();
+  }
+
+  template <usize I>
+  Maybe<column_type<I>&> get(handle h) {
+    auto row = row_of(h);
+    if (row.is_none()) {
+      return {};
+    }
+    return column<I>()[*row];
+  }
+  template <usize I>
+  Maybe<const column_type<I>&> get(handle h) const {
+    auto row = row_of(h);
+    if (row.is_none()) {
+      return {};
+    }
+    return column<I>()[*row];
+  }
+
+  void destroy(handle h) {
+    usize row = row_of(h).expect("trying to destroy an invalid handle");
+
+    underlying slot_idx        = Layout::index(h);
+    slots[slot_idx].generation = (slots[slot_idx].generation + 1) & Layout::GENERATION_MASK;
+    slots[slot_idx].index      = free_head;
+    free_head                  = slot_idx;
+
+    usize last = --size_;
+    if (row != last) {
+      handles_[row]                             = handles_[last];
+      slots[Layout::index(handles_[row])].index = (underlying)row;
+      ListOfTypes<Columns...>::foreach([&]<class T, usize I>(TYindex<T, I>) {
+        T* c = core::get<I>(columns);
+        memcpy((void*)&c[row], &c[last], sizeof(T));
+      });
+    }
+  }
+
+  // The whole column I, in row order
+  template <usize I>
+  storage<column_type<I>> column() {
+    return {size_, core::get<I>(columns)};
+  }
+  template <usize I>
+  storage<const column_type<I>> column() const {
+    return {size_, core::get<I>(columns)};
+  }
+  // The handle of each row
+  storage<const handle> handles() const {
+    return {size_, handles_};
+  }
+
+  // Iterates rows through the columns Is, the items are tuples of references
+  template <usize... Is>
+  auto iter() {
+    return core::zipiter{column<Is>().iter()...};
+  }
+
+  void reserve(Allocator alloc, usize count) {
+    if (count > capacity_) {
+      set_capacity(alloc, count);
+    }
+  }
+
+  void reset(Allocator alloc) {
+    size_ = 0;
+    set_capacity(alloc, 0);
+    slots.reset(alloc);
+    free_head = NO_SLOT;
+  }
+
+  constexpr usize size() const {
+    return size_;
+  }
+  constexpr usize capacity() const {
+    return capacity_;
+  }
+
+  // INTERNAL
+
+  template <usize... Is>
+  void write_row(usize row, std::index_sequence<Is...>, const Columns&... values) {
+    ((core::get<Is>(columns)[row] = values), ...);
+  }
+
+  static usize column_align(usize align) {
+    return MAX(align, (usize)HANDLE_SOA_COLUMN_ALIGN);
+  }
+
+  void set_capacity(Allocator alloc, usize new_capacity) {
+    ASSERT(new_capacity >= size_);
+    auto move_column = [&]<class T>(T*& c) {
+      T* new_c = nullptr;
+      if (new_capacity != 0) {
+        new_c = (T*)alloc.allocate_uninit(new_capacity * sizeof(T), column_align(alignof(T)), "handle_soa_map");
+        memcpy((void*)new_c, c, size_ * sizeof(T));
+      }
+      if (capacity_ != 0) {
+        alloc.deallocate((void*)c, capacity_ * sizeof(T), "handle_soa_map");
+      }
+      c = new_c;
+    };
+    move_column(handles_);
+    ListOfTypes<Columns...>::foreach([&]<class T, usize I>(TYindex<T, I>) { move_column(core::get<I>(columns)); });
+
+    capacity_ = new_capacity;
+  }
+};
+
+template <class... Columns>
+using handle_soa_map = basic_handle_soa_map<handle_soa_layout<>, Columns...>;
+
+} // namespace core
+
+#endif // INCLUDE_CONTAINERS_HANDLE_SOA_MAP_H_
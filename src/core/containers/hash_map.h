@@ -0,0 +1,316 @@
+#ifndef INCLUDE_CONTAINERS_HASH_MAP_H_
+#define INCLUDE_CONTAINERS_HASH_MAP_H_
+
+#include "../core/fwd.h"
+#include "../core/memory.h"
+#include "core/core.h"
+
+#include <bit>
+#include <cstring>
+#include <emmintrin.h>
+#include <type_traits>
+
+namespace core {
+
+// Hash of a key, hash_map mixes it again so it does not need to be well distributed
+template <class K>
+struct hash_fn;
+
+template <class K>
+  requires std::is_integral_v<K> || std::is_enum_v<K> || std::is_pointer_v<K>
+struct hash_fn<K> {
+  u64 operator()(K k) const {
+    if constexpr (std::is_pointer_v<K>) {
+      return (u64)(uptr)k;
+    } else {
+      return (u64)k;
+    }
+  }
+};
+
+template <>
+struct hash_fn<hstr8> {
+  u64 operator()(const hstr8& s) const {
+    return s.hash;
+  }
+};
+
+template <>
+struct hash_fn<str8> {
+  u64 operator()(const str8& s) const {
+    return s.hash().hash;
+  }
+};
+
+// Open addressing hash map, Swiss table style
+//
+// Each slot has a control byte: EMPTY or the 7 low bits of the hash of its key
+// Lookups compare 16 control bytes at once (SSE2) and only compare the keys of the matching bytes
+// Probing is linear, so deletion shifts the following entries back instead of leaving tombstones
+//
+// Like vec, the allocator is given to the operations that may allocate
+// Keys and values are memcpy'ed around
+// Iteration is in slot order, inserting or removing invalidates the iterators and the references
+template <class K, class V, class Hash = hash_fn<K>>
+struct hash_map {
+  static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>);
+
+  struct entry {
+    K key;
+    V value;
+  };
+
+  static constexpr usize GROUP_WIDTH = 16;
+  static constexpr u8 EMPTY          = 0x80;
+
+  u8* ctrl_{};
+  entry* slots_{};
+  usize capacity_{};
+  usize size_{};
+
+  Maybe<V&> get(const K& key) {
+    usize idx = find(key);
+    return idx != capacity_ ? slots_[idx].value : None<V&>();
+  }
+  Maybe<const V&> get(const K& key) const {
+    usize idx = find(key);
+    return idx != capacity_ ? slots_[idx].value : None<const V&>();
+  }
+  bool contains(const K& key) const {
+    return find(key) != capacity_;
+  }
+
+  // Inserts value if key is not in the map, returns the value in the map
+  V& get_or_insert(Allocator alloc, const K& key, V value = {}) {
+    u64 h     = hash_of(key);
+    usize idx = find(key, h);
+    if (idx != capacity_) {
+      return slots_[idx].value;
+    }
+
+    if (size_ + 1 > max_load()) {
+      rehash(alloc, MAX(GROUP_WIDTH, 2 * capacity_));
+    }
+    idx = insert_new(key, value, h);
+    return slots_[idx].value;
+  }
+
+  // Inserts or overwrites
+  V& insert(Allocator alloc, const K& key, V value) {
+    V& v = get_or_insert(alloc, key, value);
+    v    = value;
+    return v;
+  }
+
+  Maybe<V> remove(const K& key) {
+    usize idx = find(key);
+    if (idx == capacity_) {
+      return {};
+    }
+
+    V value = slots_[idx].value;
+    erase(idx);
+    return value;
+  }
+
+  // Removes the entries for which pred(key, value) is true, pred may see an entry twice
+  template <class F>
+  void remove_if(F&& pred) {
+    for (usize idx = 0; idx < capacity_;) {
+      if (ctrl_[idx] != EMPTY && pred(slots_[idx].key, slots_[idx].value)) {
+        // the next entry may be shifted into idx
+        erase(idx);
+      } else {
+        idx++;
+      }
+    }
+  }
+
+  // Makes room for count entries
+  void reserve(Allocator alloc, usize count) {
+    usize capacity = MAX(GROUP_WIDTH, capacity_);
+    while (count > capacity / 8 * 7) {
+      capacity *= 2;
+    }
+    if (capacity != capacity_) {
+      rehash(alloc, capacity);
+    }
+  }
+
+  void clear() {
+    if (capacity_ != 0) {
+      memset(ctrl_, EMPTY, capacity_ + GROUP_WIDTH - 1);
+    }
+    size_ = 0;
+  }
+
+  void reset(Allocator alloc) {
+    if (capacity_ != 0) {
+      alloc.deallocate(slots_, allocation_size(capacity_), "hash_map");
+    }
+    *this = {};
+  }
+
+  constexpr usize size() const {
+    return size_;
+  }
+  constexpr usize capacity() const {
+    return capacity_;
+  }
+
+  struct iterator : cpp_iter<entry&, iterator> {
+    using Item = entry&;
+    hash_map* map;
+    usize idx;
+
+    iterator(hash_map* map)
+        : map(map)
+        , idx(0) {}
+
+    Maybe<entry&> next() {
+      while (idx < map->capacity_) {
+        usize cur = idx++;
+        if (map->ctrl_[cur] != EMPTY) {
+          return map->slots_[cur];
+        }
+      }
+      return {};
+    }
+  };
+
+  auto iter() {
+    return iterator{this};
+  }
+
+  // INTERNAL
+
+  static u64 hash_of(const K& key) {
+    // murmur3 finalizer
+    u64 h  = Hash{}(key);
+    h     ^= h >> 33;
+    h     *= 0xff51afd7ed558ccd;
+    h     ^= h >> 33;
+    h     *= 0xc4ceb9fe1a85ec53;
+    h     ^= h >> 33;
+    return h;
+  }
+  static u8 h2(u64 h) {
+    return (u8)(h & 0x7F);
+  }
+  usize home(u64 h) const {
+    return (h >> 7) & (capacity_ - 1);
+  }
+
+  usize max_load() const {
+    return capacity_ / 8 * 7;
+  }
+  static usize allocation_size(usize capacity) {
+    return capacity * sizeof(entry) + capacity + GROUP_WIDTH - 1;
+  }
+
+  // The first GROUP_WIDTH - 1 control bytes are mirrored after the last one, groups can be loaded at any slot
+  void set_ctrl(usize idx, u8 c) {
+    ctrl_[idx] = c;
+    if (idx < GROUP_WIDTH - 1) {
+      ctrl_[capacity_ + idx] = c;
+    }
+  }
+
+  u32 match(usize pos, u8 c) const {
+    __m128i group = _mm_loadu_si128((const __m128i*)(ctrl_ + pos));
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)c)));
+  }
+  // EMPTY is the only control byte with the high bit set
+  u32 match_empty(usize pos) const {
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(ctrl_ + pos)));
+  }
+
+  // Returns capacity_ when the key is not there
+  usize find(const K& key) const {
+    return find(key, hash_of(key));
+  }
+  usize find(const K& key, u64 h) const {
+    if (capacity_ == 0) {
+      return capacity_;
+    }
+
+    usize mask = capacity_ - 1;
+    usize pos  = home(h);
+    while (true) {
+      for (u32 m = match(pos, h2(h)); m != 0; m &= m - 1) {
+        usize idx = (pos + (usize)std::countr_zero(m)) & mask;
+        if (slots_[idx].key == key) {
+          return idx;
+        }
+      }
+      // Linear probing: an entry is never stored past an empty slot of its probe sequence
+      if (match_empty(pos) != 0) {
+        return capacity_;
+      }
+      pos = (pos + GROUP_WIDTH) & mask;
+    }
+  }
+
+  usize insert_new(const K& key, const V& value, u64 h) {
+    usize mask = capacity_ - 1;
+    usize pos  = home(h);
+    u32 m      = match_empty(pos);
+    while (m == 0) {
+      pos = (pos + GROUP_WIDTH) & mask;
+      m   = match_empty(pos);
+    }
+
+    usize idx = (pos + (usize)std::countr_zero(m)) & mask;
+    set_ctrl(idx, h2(h));
+    memcpy((void*)&slots_[idx], &key, sizeof(K));
+    memcpy((void*)&slots_[idx].value, &value, sizeof(V));
+    size_++;
+    return idx;
+  }
+
+  // Backward shift deletion: the entries after the hole move into it if that does not put them before their home
+  void erase(usize hole) {
+    usize mask = capacity_ - 1;
+    set_ctrl(hole, EMPTY);
+    size_--;
+
+    for (usize idx = (hole + 1) & mask; ctrl_[idx] != EMPTY; idx = (idx + 1) & mask) {
+      usize h = home(hash_of(slots_[idx].key));
+      if (((idx - h) & mask) >= ((idx - hole) & mask)) {
+        memcpy((void*)&slots_[hole], &slots_[idx], sizeof(entry));
+        set_ctrl(hole, ctrl_[idx]);
+        set_ctrl(idx, EMPTY);
+        hole = idx;
+      }
+    }
+  }
+
+  void rehash(Allocator alloc, usize new_capacity) {
+    ASSERT(std::has_single_bit(new_capacity) && new_capacity >= GROUP_WIDTH);
+    u8* old_ctrl       = ctrl_;
+    entry* old_slots   = slots_;
+    usize old_capacity = capacity_;
+
+    // slots first, they have the stricter alignment
+    auto* mem = (u8*)alloc.allocate_uninit(allocation_size(new_capacity), alignof(entry), "hash_map");
+    slots_    = (entry*)mem;
+    ctrl_     = (u8*)(mem + new_capacity * sizeof(entry));
+    capacity_ = new_capacity;
+    size_     = 0;
+    memset(ctrl_, EMPTY, new_capacity + GROUP_WIDTH - 1);
+
+    for (usize idx = 0; idx < old_capacity; idx++) {
+      if (old_ctrl[idx] != EMPTY) {
+        insert_new(old_slots[idx].key, old_slots[idx].value, hash_of(old_slots[idx].key));
+      }
+    }
+
+    if (old_capacity != 0) {
+      alloc.deallocate(old_slots, allocation_size(old_capacity), "hash_map");
+    }
+  }
+};
+
+} // namespace core
+
+#endif // INCLUDE_CONTAINERS_HASH_MAP_H_
@@ -3,74 +3,130 @@
 
 #include <core/core.h>
 
+#include <bit>
+
 namespace core {
 
-// Meh, just a dummy double linked list
+// Slab pool: items live in chunks of 64 with an occupancy bitmap
+// - addresses are stable until the item is deallocated
+// - iteration scans the bitmaps chunk by chunk
+//   only the visited item may be deallocated while iterating, items allocated meanwhile may not be visited
+// - an empty chunk goes back to the allocator, unless it is the last one
+// - every slot points back to its chunk, deallocate is O(1)
 template <class T>
 struct pool {
+  static constexpr usize CHUNK_ITEMS = 64;
 
-  struct node {
-    T data;
-    node* next;
-    node* prev;
+  struct chunk;
+  struct slot {
+    // first, a T& is a slot&
+    T item;
+    chunk* owner;
   };
 
-  node* head = nullptr;
+  struct chunk {
+    u64 occupied;
+    chunk* next;
+    chunk* prev;
+    // chunks with a free slot
+    chunk* next_partial;
+    chunk* prev_partial;
+    alignas(slot) u8 slots[CHUNK_ITEMS * sizeof(slot)];
+
+    slot* slot_at(usize idx) {
+      return (slot*)slots + idx;
+    }
+    T* item(usize idx) {
+      return &slot_at(idx)->item;
+    }
+  };
 
-  // For those, prev is not maintained
-  node* freelist_head = nullptr;
+  chunk* head       = nullptr;
+  chunk* partial    = nullptr;
+  usize size_       = 0;
+  usize chunk_count = 0;
 
   T& allocate(core::Allocator alloc) {
-    node* n;
-    if (freelist_head != nullptr) {
-      n             = freelist_head;
-      freelist_head = n->next;
-    } else {
-      n = alloc.allocate<node>();
+    if (partial == nullptr) {
+      auto* c = alloc.allocate<chunk>();
+      for (usize i = 0; i < CHUNK_ITEMS; i++) {
+        c->slot_at(i)->owner = c;
+      }
+      c->next = head;
+      if (head != nullptr) {
+        head->prev = c;
+      }
+      head = c;
+      chunk_count++;
+      link_partial(c);
     }
 
-    n->next = head;
-    n->prev = nullptr;
-    if (head != nullptr) {
-      head->prev = n;
+    chunk* c     = partial;
+    usize idx    = (usize)std::countr_zero(~c->occupied);
+    c->occupied |= 1ull << idx;
+    if (c->occupied == ~0ull) {
+      unlink_partial(c);
     }
-    head = n;
-    return n->data;
+    size_++;
+    return *c->item(idx);
   }
 
   void deallocate(core::Allocator alloc, T& t) {
-    node* n = (node*)&t;
-
-    if (n->prev)
-      n->prev->next = n->next;
-    else
-      head = n->next;
-
-    if (n->next)
-      n->next->prev = n->prev;
-
-    // if (alloc.try_resize(n, sizeof(node), 0)) {
-    //   return;
-    // }
+    slot* sl = reinterpret_cast<slot*>(&t);
+    chunk* c = sl->owner;
+    DEBUG_ASSERT(c != nullptr);
+
+    usize idx = usize(sl - c->slot_at(0));
+    ASSERTM(idx < CHUNK_ITEMS && c->slot_at(idx) == sl, "trying to deallocate an item that is not in a pool");
+    ASSERTM(c->occupied & (1ull << idx), "double deallocation in a pool");
+    if (c->occupied == ~0ull) {
+      link_partial(c);
+    }
+    c->occupied &= ~(1ull << idx);
+    size_--;
+
+    if (c->occupied == 0 && chunk_count > 1) {
+      unlink_partial(c);
+      if (c->prev)
+        c->prev->next = c->next;
+      else
+        head = c->next;
+      if (c->next)
+        c->next->prev = c->prev;
+
+      alloc.deallocate(c);
+      chunk_count--;
+    }
+  }
 
-    n->next       = freelist_head;
-    freelist_head = n;
+  usize size() const {
+    return size_;
   }
 
   struct queue_iter : cpp_iter<T&, queue_iter> {
-    node* n;
+    chunk* c;
+    // read when entering a chunk: deallocating the visited item may release its chunk
+    chunk* next_chunk;
+    u64 bits;
 
-    queue_iter(node* n)
-        : n(n) {}
+    queue_iter(chunk* c)
+        : c(c)
+        , next_chunk(c != nullptr ? c->next : nullptr)
+        , bits(c != nullptr ? c->occupied : 0) {}
 
     Maybe<T&> next() {
-      if (n == nullptr) {
-        return Maybe<T&>::None();
+      while (bits == 0) {
+        if (next_chunk == nullptr) {
+          return Maybe<T&>::None();
+        }
+        c          = next_chunk;
+        next_chunk = c->next;
+        bits       = c->occupied;
       }
 
-      T& t = n->data;
-      n    = n->next;
-      return t;
+      usize idx  = (usize)std::countr_zero(bits);
+      bits      &= bits - 1;
+      return *c->item(idx);
     }
   };
 
@@ -79,21 +135,34 @@ struct pool {
   }
 
   void reset(core::Allocator alloc) {
-    node* ptr = head;
-    while (ptr != nullptr) {
-      auto tmp = ptr;
-      ptr      = ptr->next;
+    chunk* c = head;
+    while (c != nullptr) {
+      auto tmp = c;
+      c        = c->next;
       alloc.deallocate(tmp);
     }
 
-    ptr = freelist_head;
-    while (ptr != nullptr) {
-      auto tmp = ptr;
-      ptr      = ptr->next;
-      alloc.deallocate(tmp);
-    }
+    head  = partial = nullptr;
+    size_ = chunk_count = 0;
+  }
 
-    head = freelist_head = nullptr;
+  // INTERNAL
+  void link_partial(chunk* c) {
+    c->prev_partial = nullptr;
+    c->next_partial = partial;
+    if (partial != nullptr) {
+      partial->prev_partial = c;
+    }
+    partial = c;
+  }
+  void unlink_partial(chunk* c) {
+    if (c->prev_partial)
+      c->prev_partial->next_partial = c->next_partial;
+    else
+      partial = c->next_partial;
+    if (c->next_partial)
+      c->next_partial->prev_partial = c->prev_partial;
+    c->next_partial = c->prev_partial = nullptr;
   }
 };
 
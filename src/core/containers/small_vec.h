@@ -0,0 +1,178 @@
+#ifndef INCLUDE_CONTAINERS_SMALL_VEC_H_
+#define INCLUDE_CONTAINERS_SMALL_VEC_H_
+
+#include "../core/fwd.h"
+#include "../core/memory.h"
+#include "core/core.h"
+#include <cstring>
+#include <initializer_list>
+
+namespace core {
+// A vec that keeps its first N elements inline
+// It only goes to the allocator past N elements, and comes back inline when set_capacity shrinks it enough
+// The inline elements are not pointed to by the small_vec itself, it can be copied and moved around like a vec
+// but, like a vec, a copy shares the spilled elements
+template <class T, usize N>
+struct small_vec {
+  static_assert(N > 0);
+
+  T* heap_{}; // nullptr while the elements are inline
+  usize capacity_{N};
+  usize size_{};
+  alignas(T) u8 inline_[N * sizeof(T)];
+
+  small_vec() {}
+  small_vec(std::initializer_list<T> s) {
+    ASSERTM(s.size() <= N, "small_vec: an initializer list can't spill");
+    memcpy((void*)inline_, s.begin(), s.size() * sizeof(T));
+    size_ = s.size();
+  }
+
+  constexpr T pop(noalloc_t) {
+    if (size_ == 0) {
+      panic("Trying to pop empty small_vec");
+    }
+
+    size_--;
+    return data()[size_];
+  }
+
+  constexpr T pop(Allocator alloc) {
+    T t = pop(noalloc);
+    if (is_spilled() && capacity() > 2 * size()) {
+      set_capacity(alloc, size_);
+    }
+    return t;
+  }
+
+  constexpr void push(noalloc_t, T t) {
+    ASSERT(size() < capacity());
+    data()[size_]  = t;
+    size_         += 1;
+  }
+
+  constexpr void push(Allocator alloc, T t) {
+    if (size() >= capacity()) {
+      set_capacity(alloc, capacity() * 2);
+    }
+
+    push(noalloc, t);
+  }
+
+  void set_size(usize new_size) {
+    ASSERT(new_size <= capacity());
+    size_ = new_size;
+  }
+  // A capacity of N or less moves the elements back inline
+  void set_capacity(Allocator alloc, usize new_capacity, bool try_grow = true) {
+    ASSERT(new_capacity >= size());
+    if (new_capacity <= N) {
+      if (is_spilled()) {
+        memcpy((void*)inline_, heap_, size() * sizeof(T));
+        alloc.deallocate((void*)heap_, capacity_ * sizeof(T));
+        heap_     = nullptr;
+        capacity_ = N;
+      }
+      return;
+    }
+
+    if (try_grow && is_spilled() &&
+        alloc.try_resize((void*)heap_, capacity_ * sizeof(T), new_capacity * sizeof(T), "small_vec::resize")) {
+      capacity_ = new_capacity;
+      return;
+    }
+
+    T* new_heap = alloc.allocate_array_uninit<T>(new_capacity, "small_vec::resize").data;
+    memcpy((void*)new_heap, data(), size() * sizeof(T));
+    if (is_spilled()) {
+      alloc.deallocate((void*)heap_, capacity_ * sizeof(T));
+    }
+    heap_     = new_heap;
+    capacity_ = new_capacity;
+  }
+
+  void reset(noalloc_t) {
+    set_size(0);
+  }
+  void reset(Allocator alloc) {
+    reset(noalloc);
+    set_capacity(alloc, 0);
+  }
+
+  small_vec clone(Allocator alloc) {
+    small_vec copy = *this;
+    if (is_spilled()) {
+      copy.heap_ = alloc.allocate_array_uninit<T>(capacity_, "small_vec::clone").data;
+      memcpy((void*)copy.heap_, heap_, size() * sizeof(T));
+    }
+    return copy;
+  }
+
+  constexpr bool is_spilled() const {
+    return heap_ != nullptr;
+  }
+  constexpr usize capacity() const {
+    return capacity_;
+  }
+
+  constexpr usize size() const {
+    return size_;
+  }
+  constexpr T* data() {
+    return is_spilled() ? heap_ : (T*)inline_;
+  }
+  constexpr const T* data() const {
+    return is_spilled() ? heap_ : (const T*)inline_;
+  }
+
+  constexpr operator storage<T>() {
+    return {size(), data()};
+  }
+  constexpr operator storage<const T>() const {
+    return {size(), data()};
+  }
+
+  constexpr const T& operator[](usize i) const {
+    ASSERT(i < size());
+    return *(data() + i);
+  }
+  constexpr T& operator[](usize i) {
+    ASSERT(i < size());
+    return *(data() + i);
+  }
+
+  auto indices() const {
+    return range{0zu, size()};
+  }
+  auto iter() {
+    return storage<T>{*this}.iter();
+  }
+  auto iter() const {
+    return storage<const T>{*this}.iter();
+  }
+
+  // iterator is not invalidated when the current item is destroyed
+  auto iter_rev() {
+    return storage<T>{*this}.iter_rev();
+  }
+  auto iter_rev() const {
+    return storage<const T>{*this}.iter_rev();
+  }
+
+  Maybe<T&> last() {
+    return size() > 0 ? (*this)[size() - 1] : core::None<T&>();
+  }
+  Maybe<const T&> last() const {
+    return size() > 0 ? (*this)[size() - 1] : core::None<const T&>();
+  }
+
+  // Does not invalidate a reverse iterator!
+  T swap_last_pop(usize idx) {
+    SWAP((*this)[idx], (*this)[size() - 1]);
+    return pop(core::noalloc);
+  }
+};
+
+} // namespace core
+
+#endif // INCLUDE_CONTAINERS_SMALL_VEC_H_
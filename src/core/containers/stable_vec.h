@@ -1,5 +1,6 @@
 #ifndef INCLUDE_CONTAINERS_STABLE_VEC_H_
 #define INCLUDE_CONTAINERS_STABLE_VEC_H_
+#include "core/containers/vec.h"
 #include "core/core.h"
 #include "core/core/base.h"
 
@@ -9,75 +10,49 @@ namespace core {
 // the main advantages of a stable vec:
 // - pointer are preserved after an insert / delete
 // - data is not copied when there is not enough space <- does not fragment an arena
+// A directory of the blocks gives O(1) random access, only this array of pointers is ever copied
 template <class T, usize BlockSize = KB(1)>
 class stable_vec {
 public:
   void push(core::Allocator alloc, T t) {
-    if (head == nullptr) {
-      head = tail = alloc.allocate<Block>();
-    }
-
-    if (tail->header.size == Block::elem_per_block) {
-      auto* old_tail        = tail;
-      old_tail->header.next = tail = alloc.allocate<Block>();
-      tail->header.prev            = old_tail;
-    }
-
-    auto* block = tail;
-    while (block->header.size == 0 && block->header.prev != nullptr &&
-           block->header.prev->header.size != Block::elem_per_block) {
-      block = block->header.prev;
+    if (cursor == nullptr || cursor->header.size == Block::elem_per_block) {
+      cursor = (cursor != nullptr && cursor->header.next != nullptr) ? cursor->header.next : push_block(alloc);
     }
 
-    block->items[block->header.size]  = t;
-    block->header.size               += 1;
+    cursor->items[cursor->header.size]  = t;
+    cursor->header.size                += 1;
+    size_                              += 1;
   }
 
   T pop() {
-    ASSERTM(tail != nullptr, "trying to pop an empty vec");
+    ASSERTM(size_ != 0, "trying to pop an empty vec");
 
-    auto* block = tail;
-    while (block->header.size == 0 && block->header.prev != nullptr) {
-      block = block->header.prev;
+    auto* block         = cursor;
+    block->header.size -= 1;
+    size_              -= 1;
+    T t                 = block->items[block->header.size];
+    // cursor stays on the last non empty block
+    if (block->header.size == 0 && block->header.prev != nullptr) {
+      cursor = block->header.prev;
     }
+    return t;
+  }
 
-    ASSERTM(block->header.size != 0, "trying to pop an empty vec");
-
-    block->header.size -= 1;
-    return block->items[block->header.size];
+  usize size() const {
+    return size_;
   }
   usize capacity() const {
-    usize cap   = 0;
-    auto* block = head;
-    while (block != nullptr) {
-      cap   += Block::elem_per_block;
-      block  = block->header.next;
-    }
-    return cap;
+    return blocks.size() * Block::elem_per_block;
   }
 
   T& at(usize idx) {
-    Block* block = head;
-    while (idx >= Block::elem_per_block && block != nullptr) {
-      idx   -= Block::elem_per_block;
-      block  = block->header.next;
-    }
-
-    ASSERT(block != nullptr);
-
-    return block->items[idx];
+    ASSERT(idx / Block::elem_per_block < blocks.size());
+    return blocks[idx / Block::elem_per_block]->items[idx % Block::elem_per_block];
   }
 
   const T& at(usize idx) const {
-    Block* block = head;
-    while (idx >= Block::elem_per_block && block != nullptr) {
-      idx   -= Block::elem_per_block;
-      block  = block->header.next;
-    }
-
-    ASSERT(block != nullptr);
-
-    return block->items[idx];
+    ASSERT(idx / Block::elem_per_block < blocks.size());
+    return blocks[idx / Block::elem_per_block]->items[idx % Block::elem_per_block];
   }
 
   auto& operator[](usize idx) {
@@ -91,6 +66,11 @@ public:
     return iterator{head, 0};
   }
 
+  // Yields the elements block by block, every chunk but the last one is full
+  auto chunks() {
+    return chunk_iterator{head};
+  }
+
   void deallocate(Allocator alloc) {
     Block* block = head;
     while (block != nullptr) {
@@ -99,7 +79,9 @@ public:
       block = next;
     }
 
-    head = tail = nullptr;
+    blocks.reset(alloc);
+    head  = tail = cursor = nullptr;
+    size_ = 0;
   }
 
 private:
@@ -118,6 +100,24 @@ private:
 
   Block* head = nullptr;
   Block* tail = nullptr;
+  // last non empty block, or head
+  Block* cursor = nullptr;
+  usize size_   = 0;
+  // block directory, for O(1) at()
+  core::vec<Block*> blocks;
+
+  Block* push_block(core::Allocator alloc) {
+    auto* block = alloc.allocate<Block>();
+    if (head == nullptr) {
+      head = tail = block;
+    } else {
+      tail->header.next  = block;
+      block->header.prev = tail;
+      tail               = block;
+    }
+    blocks.push(alloc, block);
+    return block;
+  }
 
   struct iterator : cpp_iter<T&, iterator> {
     using Item = T&;
@@ -141,6 +141,24 @@ private:
       return b->items[block_idx++];
     }
   };
+
+  struct chunk_iterator : cpp_iter<storage<T>, chunk_iterator> {
+    using Item = storage<T>;
+    Block* b;
+
+    chunk_iterator(Block* b)
+        : b(b) {}
+
+    core::Maybe<storage<T>> next() {
+      if (b == nullptr || b->header.size == 0) {
+        return {};
+      }
+
+      storage<T> chunk{b->header.size, b->items.data};
+      b = b->header.next;
+      return chunk;
+    }
+  };
 };
 } // namespace core
 #endif // INCLUDE_CONTAINERS_STABLE_VEC_H_
@@ -1,3 +1,5 @@
+#include "sync.h"
+#include <core/containers/vec.h>
 #include <core/core.h>
 
 #include <atomic>
@@ -13,4 +15,180 @@ usize thread_id() {
   return thread_id_;
 }
 
+// === Epoch based reclamation ===
+//
+// The global epoch only moves from e to e + 1 when every thread inside a guard has seen e
+// A node retired during e can't be reached by a guard entered after e + 1 started, and the guards
+// entered before have left once the epoch reaches e + 2: each thread keeps one bag of retired nodes per epoch mod 3
+
+namespace {
+struct retired {
+  Allocator alloc;
+  void* ptr;
+  usize size;
+};
+
+struct bag {
+  u64 epoch;
+  vec<retired> nodes;
+};
+
+// Records are never freed: they go back to the list when their thread exits, with their bags
+struct epoch_record {
+  // epoch << 1 | inside a guard
+  std::atomic<u64> local;
+  std::atomic<bool> in_use;
+  epoch_record* next;
+
+  u32 nesting;
+  u32 retire_count;
+  bag bags[3];
+};
+
+// The bags use malloc: retiring must not depend on the allocators it gives memory back to
+Allocator bag_alloc{nullptr, &MallocVtable};
+
+std::atomic<u64> global_epoch{2};
+std::atomic<epoch_record*> records{};
+std::atomic<usize> retired_count{};
+std::atomic<usize> freed_count{};
+
+epoch_record* acquire_record() {
+  for (epoch_record* r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+    bool in_use = false;
+    if (!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(in_use, true)) {
+      return r;
+    }
+  }
+
+  auto* r = (epoch_record*)bag_alloc.allocate(sizeof(epoch_record), alignof(epoch_record));
+  new (r) epoch_record{};
+  r->in_use.store(true, std::memory_order_relaxed);
+
+  epoch_record* head = records.load(std::memory_order_relaxed);
+  do {
+    r->next = head;
+  } while (!records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+  return r;
+}
+
+usize free_bag(bag& b) {
+  usize count = b.nodes.size();
+  for (auto& n : b.nodes.iter()) {
+    n.alloc.deallocate(n.ptr, n.size, "epoch_retire");
+  }
+  b.nodes.reset(noalloc);
+  retired_count.fetch_sub(count, std::memory_order_relaxed);
+  freed_count.fetch_add(count, std::memory_order_relaxed);
+  return count;
+}
+
+// Frees the bags that are two epochs old
+usize free_safe_bags(epoch_record& r, u64 epoch) {
+  usize count = 0;
+  for (auto& b : r.bags) {
+    if (b.nodes.size() > 0 && b.epoch + 2 <= epoch) {
+      count += free_bag(b);
+    }
+  }
+  return count;
+}
+
+bool try_advance(u64 epoch) {
+  for (epoch_record* r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+    u64 local = r->local.load(std::memory_order_seq_cst);
+    if ((local & 1) && (local >> 1) != epoch) {
+      return false;
+    }
+  }
+  return global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+struct thread_record {
+  epoch_record* r = nullptr;
+
+  epoch_record& get() {
+    if (r == nullptr) {
+      r = acquire_record();
+    }
+    return *r;
+  }
+
+  ~thread_record() {
+    if (r != nullptr) {
+      r->local.store(0, std::memory_order_release);
+      r->nesting = 0;
+      r->in_use.store(false, std::memory_order_release);
+    }
+  }
+};
+thread_local thread_record thread_record_;
+} // namespace
+
+EXPORT void epoch_enter() {
+  auto& r = thread_record_.get();
+  if (r.nesting++ > 0) {
+    return;
+  }
+
+  r.local.store(global_epoch.load(std::memory_order_relaxed) << 1 | 1, std::memory_order_relaxed);
+  // the epoch must be published before any shared pointer is read
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EXPORT void epoch_exit() {
+  auto& r = thread_record_.get();
+  ASSERTM(r.nesting > 0, "epoch_exit without epoch_enter");
+  if (--r.nesting > 0) {
+    return;
+  }
+  r.local.store(r.local.load(std::memory_order_relaxed) & ~1ull, std::memory_order_release);
+}
+
+EXPORT void epoch_retire(Allocator alloc, void* ptr, usize size) {
+  auto& r   = thread_record_.get();
+  u64 epoch = global_epoch.load(std::memory_order_seq_cst);
+
+  auto& b = r.bags[epoch % 3];
+  if (b.epoch != epoch) {
+    // the bag is three epochs old, or empty
+    free_bag(b);
+    b.epoch = epoch;
+  }
+  b.nodes.push(bag_alloc, {alloc, ptr, size});
+  retired_count.fetch_add(1, std::memory_order_relaxed);
+
+  if (++r.retire_count % EPOCH_COLLECT_INTERVAL == 0) {
+    epoch_collect();
+  }
+}
+
+EXPORT usize epoch_collect() {
+  u64 epoch = global_epoch.load(std::memory_order_seq_cst);
+  if (try_advance(epoch)) {
+    epoch++;
+  }
+
+  auto& own   = thread_record_.get();
+  usize count = free_safe_bags(own, epoch);
+
+  // the bags left by threads that exited
+  for (epoch_record* r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+    bool in_use = false;
+    if (r != &own && !r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(in_use, true)) {
+      count += free_safe_bags(*r, epoch);
+      r->in_use.store(false, std::memory_order_release);
+    }
+  }
+  return count;
+}
+
+EXPORT EpochStats epoch_stats() {
+  return {
+      .epoch   = global_epoch.load(std::memory_order_relaxed),
+      .retired = retired_count.load(std::memory_order_relaxed),
+      .freed   = freed_count.load(std::memory_order_relaxed),
+  };
+}
+
 } // namespace core::sync
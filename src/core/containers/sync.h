@@ -4,12 +4,59 @@
 #define INCLUDE_CORE_SYNC_H_
 
 #include "../core/fwd.h"
+#include "../core/memory.h"
 #include <atomic>
+#include <bit>
+#include <new>
+#include <type_traits>
+
+#ifndef CACHE_LINE_SIZE
+  #define CACHE_LINE_SIZE 64
+#endif
 
 namespace core::sync {
 usize thread_id();
 
+// Epoch based reclamation
+//
+// Lock-free structures read nodes that another thread may be unlinking at the same time
+// Readers stay inside an epoch guard while they hold pointers to shared nodes
+// An unlinked node is retired instead of deallocated: it goes back to its allocator once every thread
+// that was inside a guard when it got retired has left it (the global epoch moved forward twice)
+//
+// Guards nest, retiring is done from any thread and does not need a guard
+// Every EPOCH_COLLECT_INTERVAL retirements, the retiring thread tries to move the epoch and frees what it can
+#ifndef EPOCH_COLLECT_INTERVAL
+  #define EPOCH_COLLECT_INTERVAL 64
+#endif
+
+void epoch_enter();
+void epoch_exit();
+struct epoch_guard {
+  epoch_guard() {
+    epoch_enter();
+  }
+  ~epoch_guard() {
+    epoch_exit();
+  }
+  epoch_guard(const epoch_guard&)            = delete;
+  epoch_guard& operator=(const epoch_guard&) = delete;
+};
+
+void epoch_retire(Allocator alloc, void* ptr, usize size);
+// Tries to move the global epoch forward and frees the retired nodes that are safe to free
+// Returns the number of nodes freed
+usize epoch_collect();
+
+struct EpochStats {
+  u64 epoch;
+  usize retired; // waiting to be freed, for every thread
+  usize freed;
+};
+EpochStats epoch_stats();
+
 // Treiber stack
+// pop is guarded by an epoch, a popped node must be retired (or pushed again), never deallocated directly
 template <class T, usize alignement = alignof(T)>
 struct stack {
   struct stack_node {
@@ -28,6 +75,8 @@ struct stack {
   }
 
   stack_node* pop() {
+    // cur_top may be popped and retired by another thread while its next is read
+    epoch_guard guard;
     tagged_ptr cur_top = top;
     stack_node* n;
     do {
@@ -43,6 +92,290 @@ struct stack {
   bool empty() {
     return top.load().ptr() == nullptr;
   }
+
+  static stack_node* allocate_node(Allocator alloc) {
+    return alloc.allocate<stack_node>();
+  }
+  static void retire_node(Allocator alloc, stack_node* node) {
+    epoch_retire(alloc, node, sizeof(stack_node));
+  }
+};
+
+// Bounded single producer single consumer ring buffer
+// Each side caches the counter of the other one and only reloads it when the queue looks full / empty
+template <class T>
+struct spsc_queue {
+  // the slots are raw storage, items are copied in and out and never destroyed
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  // consumer
+  alignas(CACHE_LINE_SIZE) std::atomic<usize> head{};
+  usize cached_tail{};
+  // producer
+  alignas(CACHE_LINE_SIZE) std::atomic<usize> tail{};
+  usize cached_head{};
+  // read only once initialized
+  alignas(CACHE_LINE_SIZE) T* buffer{};
+  usize mask{};
+
+  // capacity is rounded up to a power of two
+  void init(Allocator alloc, usize capacity) {
+    capacity = std::bit_ceil(MAX(capacity, 2zu));
+    buffer   = alloc.allocate_array_uninit<T>(capacity, "spsc_queue").data;
+    mask     = capacity - 1;
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    cached_head = cached_tail = 0;
+  }
+  void deallocate(Allocator alloc) {
+    alloc.deallocate(buffer, (mask + 1) * sizeof(T), "spsc_queue");
+    buffer = nullptr;
+  }
+
+  usize capacity() const {
+    return mask + 1;
+  }
+
+  // producer only
+  bool try_push(T t) {
+    usize pos = tail.load(std::memory_order_relaxed);
+    if (pos - cached_head > mask) {
+      cached_head = head.load(std::memory_order_acquire);
+      if (pos - cached_head > mask) {
+        return false;
+      }
+    }
+
+    buffer[pos & mask] = t;
+    tail.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer only
+  Maybe<T> try_pop() {
+    usize pos = head.load(std::memory_order_relaxed);
+    if (pos == cached_tail) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if (pos == cached_tail) {
+        return {};
+      }
+    }
+
+    T t = buffer[pos & mask];
+    head.store(pos + 1, std::memory_order_release);
+    return t;
+  }
+};
+
+// Bounded multi producer multi consumer queue (Dmitry Vyukov's)
+// Every cell has a sequence number telling whether it is ready to be written or to be read for the current lap,
+// producers and consumers only contend on their own counter
+template <class T>
+struct mpmc_queue {
+  // the cells are raw storage, items are copied in and out and never destroyed
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  struct cell {
+    std::atomic<usize> sequence;
+    T data;
+  };
+
+  alignas(CACHE_LINE_SIZE) std::atomic<usize> enqueue_pos{};
+  alignas(CACHE_LINE_SIZE) std::atomic<usize> dequeue_pos{};
+  // read only once initialized
+  alignas(CACHE_LINE_SIZE) cell* cells{};
+  usize mask{};
+
+  // capacity is rounded up to a power of two
+  void init(Allocator alloc, usize capacity) {
+    capacity = std::bit_ceil(MAX(capacity, 2zu));
+    cells    = (cell*)alloc.allocate_uninit(capacity * sizeof(cell), alignof(cell), "mpmc_queue");
+    mask     = capacity - 1;
+    for (usize i = 0; i < capacity; i++) {
+      new (&cells[i].sequence) std::atomic<usize>(i);
+    }
+    enqueue_pos.store(0, std::memory_order_relaxed);
+    dequeue_pos.store(0, std::memory_order_relaxed);
+  }
+  void deallocate(Allocator alloc) {
+    alloc.deallocate(cells, (mask + 1) * sizeof(cell), "mpmc_queue");
+    cells = nullptr;
+  }
+
+  usize capacity() const {
+    return mask + 1;
+  }
+
+  bool try_push(T t) {
+    usize pos = enqueue_pos.load(std::memory_order_relaxed);
+    cell* c;
+    while (true) {
+      c         = &cells[pos & mask];
+      usize seq = c->sequence.load(std::memory_order_acquire);
+      s64 diff  = (s64)seq - (s64)pos;
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // the cell still holds the item of the previous lap
+        return false;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    c->data = t;
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  Maybe<T> try_pop() {
+    usize pos = dequeue_pos.load(std::memory_order_relaxed);
+    cell* c;
+    while (true) {
+      c         = &cells[pos & mask];
+      usize seq = c->sequence.load(std::memory_order_acquire);
+      s64 diff  = (s64)seq - (s64)(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // the cell has not been written for this lap
+        return {};
+      } else {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+
+    T t = c->data;
+    c->sequence.store(pos + mask + 1, std::memory_order_release);
+    return t;
+  }
+};
+
+// Chase-Lev work stealing deque (the C11 version of Le, Pop, Cohen and Zappa Nardelli)
+// The owner pushes and pops at the bottom, LIFO, other threads steal from the top, FIFO
+// Only the last item is contended: the owner and the thieves race for it on top
+// The ring grows when it is full, the old ring is retired since a thief may still be reading it
+template <class T>
+struct ws_deque {
+  static_assert(std::is_trivially_copyable_v<T>);
+
+  struct ring {
+    usize mask;
+
+    std::atomic<T>* items() {
+      return (std::atomic<T>*)(this + 1);
+    }
+    static usize allocation_size(usize capacity) {
+      return sizeof(ring) + capacity * sizeof(std::atomic<T>);
+    }
+  };
+
+  alignas(CACHE_LINE_SIZE) std::atomic<s64> top{};
+  alignas(CACHE_LINE_SIZE) std::atomic<s64> bottom{};
+  std::atomic<ring*> buffer{};
+  Allocator alloc{};
+
+  // capacity is rounded up to a power of two
+  void init(Allocator alloc_, usize capacity) {
+    alloc = alloc_;
+    buffer.store(allocate_ring(std::bit_ceil(MAX(capacity, 2zu))), std::memory_order_relaxed);
+    top.store(0, std::memory_order_relaxed);
+    bottom.store(0, std::memory_order_relaxed);
+  }
+  // No thread may use the deque anymore
+  void deallocate() {
+    ring* r = buffer.load(std::memory_order_relaxed);
+    alloc.deallocate(r, ring::allocation_size(r->mask + 1), "ws_deque");
+    buffer.store(nullptr, std::memory_order_relaxed);
+  }
+
+  // owner only
+  void push(T t) {
+    s64 b   = bottom.load(std::memory_order_relaxed);
+    s64 tp  = top.load(std::memory_order_acquire);
+    ring* r = buffer.load(std::memory_order_relaxed);
+    if (b - tp > (s64)r->mask) {
+      r = grow(r, tp, b);
+    }
+    r->items()[(usize)b & r->mask].store(t, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // owner only
+  Maybe<T> pop() {
+    s64 b   = bottom.load(std::memory_order_relaxed) - 1;
+    ring* r = buffer.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 tp = top.load(std::memory_order_relaxed);
+
+    if (tp > b) {
+      // empty
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return {};
+    }
+
+    T t = r->items()[(usize)b & r->mask].load(std::memory_order_relaxed);
+    if (tp == b) {
+      // last item, a thief may be taking it
+      bool won = top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom.store(b + 1, std::memory_order_relaxed);
+      if (!won) {
+        return {};
+      }
+    }
+    return t;
+  }
+
+  // any thread, fails when the deque is empty or when another thread took the item first
+  Maybe<T> steal() {
+    epoch_guard guard;
+    s64 tp = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s64 b = bottom.load(std::memory_order_acquire);
+    if (tp >= b) {
+      return {};
+    }
+
+    ring* r = buffer.load(std::memory_order_acquire);
+    T t     = r->items()[(usize)tp & r->mask].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return {};
+    }
+    return t;
+  }
+
+  // a snapshot, only a hint when other threads are using the deque
+  usize size() const {
+    s64 b  = bottom.load(std::memory_order_relaxed);
+    s64 tp = top.load(std::memory_order_relaxed);
+    return b > tp ? (usize)(b - tp) : 0;
+  }
+
+  // INTERNAL
+
+  ring* allocate_ring(usize capacity) {
+    auto* r = (ring*)alloc.allocate_uninit(ring::allocation_size(capacity), alignof(ring), "ws_deque");
+    r->mask = capacity - 1;
+    return r;
+  }
+
+  ring* grow(ring* old, s64 tp, s64 b) {
+    ring* r = allocate_ring(2 * (old->mask + 1));
+    for (s64 i = tp; i < b; i++) {
+      r->items()[(usize)i & r->mask].store(
+          old->items()[(usize)i & old->mask].load(std::memory_order_relaxed), std::memory_order_relaxed
+      );
+    }
+    buffer.store(r, std::memory_order_release);
+    epoch_retire(alloc, old, ring::allocation_size(old->mask + 1));
+    return r;
+  }
 };
 
 } // namespace core::sync
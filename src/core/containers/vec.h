@@ -74,7 +74,7 @@ struct vec {
     size_ = new_size;
   }
   void set_capacity(Allocator alloc, usize new_capacity, bool try_grow = true) {
-    if (try_grow && alloc.try_resize((void*)store.data, store.size, new_capacity * sizeof(T), "vec::resize")) {
+    if (try_grow && alloc.try_resize((void*)store.data, store.size * sizeof(T), new_capacity * sizeof(T), "vec::resize")) {
       store.size = new_capacity;
       return;
     }
@@ -84,9 +84,9 @@ struct vec {
       return;
     }
 
-    auto new_store = alloc.allocate_array<T>(new_capacity, "vec::resize");
+    auto new_store = alloc.allocate_array_uninit<T>(new_capacity, "vec::resize");
     memcpy((void*)new_store.data, store.data, size() * sizeof(T));
-    alloc.deallocate((void*)store.data, store.size);
+    alloc.deallocate((void*)store.data, store.size * sizeof(T));
     store = new_store;
   }
 
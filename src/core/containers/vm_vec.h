@@ -0,0 +1,170 @@
+#ifndef INCLUDE_CONTAINERS_VM_VEC_H_
+#define INCLUDE_CONTAINERS_VM_VEC_H_
+
+#include "../core/fwd.h"
+#include "../os/memory.h"
+#include "core/core.h"
+
+#ifndef VM_VEC_DEFAULT_RESERVE
+  #define VM_VEC_DEFAULT_RESERVE GB(1zu)
+#endif
+#ifndef VM_VEC_MIN_COMMIT
+  #define VM_VEC_MIN_COMMIT KB(64zu)
+#endif
+
+namespace core {
+// Like a vec but backed by its own reserved virtual range
+// The range is reserved on the first push, pages are committed on demand
+// - growing never moves the elements, pointers are stable until they are popped
+// - no allocator is needed, shrink_to_fit and reset decommit, deallocate releases the range
+// - max_capacity() can't be exceeded, reserve generously: untouched address space is free
+template <class T>
+struct vm_vec {
+  T* data_{};
+  usize size_{};
+  usize committed_{}; // bytes
+  usize reserved_{};  // bytes
+
+  vm_vec() {}
+  explicit vm_vec(usize max_capacity)
+      : reserved_(ALIGN_UP(max_capacity * sizeof(T), os::mem_page_size())) {}
+
+  constexpr T pop() {
+    if (size_ == 0) {
+      panic("Trying to pop empty vm_vec");
+    }
+
+    size_--;
+    return data_[size_];
+  }
+
+  constexpr void push(T t) {
+    if (size() >= capacity()) {
+      grow(size() + 1);
+    }
+
+    data_[size_]  = t;
+    size_        += 1;
+  }
+
+  // Commits enough pages for new_capacity elements
+  void reserve(usize new_capacity) {
+    if (new_capacity > capacity()) {
+      grow(new_capacity);
+    }
+  }
+
+  void set_size(usize new_size) {
+    reserve(new_size);
+    size_ = new_size;
+  }
+
+  // Decommits the pages past the last element
+  void shrink_to_fit() {
+    usize keep = ALIGN_UP(size() * sizeof(T), VM_VEC_MIN_COMMIT);
+    if (keep >= committed_) {
+      return;
+    }
+
+    os::mem_deallocate((u8*)data_ + keep, committed_ - keep, os::MemDeallocationFlags::Decommit);
+    committed_ = keep;
+  }
+
+  void reset() {
+    size_ = 0;
+    shrink_to_fit();
+  }
+
+  void deallocate() {
+    if (data_ != nullptr) {
+      os::mem_deallocate(data_, reserved_, os::MemDeallocationFlags::Release);
+    }
+    data_      = nullptr;
+    size_      = 0;
+    committed_ = 0;
+  }
+
+  constexpr usize capacity() const {
+    return committed_ / sizeof(T);
+  }
+  constexpr usize max_capacity() const {
+    return (reserved_ == 0 ? VM_VEC_DEFAULT_RESERVE : reserved_) / sizeof(T);
+  }
+
+  constexpr usize size() const {
+    return size_;
+  }
+  constexpr T* data() {
+    return data_;
+  }
+  constexpr const T* data() const {
+    return data_;
+  }
+
+  constexpr operator storage<T>() {
+    return {size(), data()};
+  }
+  constexpr operator storage<const T>() const {
+    return {size(), data()};
+  }
+
+  constexpr const T& operator[](usize i) const {
+    ASSERT(i < size());
+    return *(data() + i);
+  }
+  constexpr T& operator[](usize i) {
+    ASSERT(i < size());
+    return *(data() + i);
+  }
+
+  auto indices() const {
+    return range{0zu, size()};
+  }
+  auto iter() {
+    return storage<T>{*this}.iter();
+  }
+  auto iter() const {
+    return storage<const T>{*this}.iter();
+  }
+
+  // iterator is not invalidated when the current item is destroyed
+  auto iter_rev() {
+    return storage<T>{*this}.iter_rev();
+  }
+  auto iter_rev() const {
+    return storage<const T>{*this}.iter_rev();
+  }
+
+  Maybe<T&> last() {
+    return size() > 0 ? (*this)[size() - 1] : core::None<T&>();
+  }
+  Maybe<const T&> last() const {
+    return size() > 0 ? (*this)[size() - 1] : core::None<const T&>();
+  }
+
+  // Does not invalidate a reverse iterator!
+  T swap_last_pop(usize idx) {
+    SWAP((*this)[idx], (*this)[size() - 1]);
+    return pop();
+  }
+
+  // INTERNAL
+  void grow(usize new_capacity) {
+    if (data_ == nullptr) {
+      reserved_ = reserved_ == 0 ? VM_VEC_DEFAULT_RESERVE : reserved_;
+      data_     = (T*)os::mem_allocate(nullptr, reserved_, os::MemAllocationFlags::Reserve);
+    }
+    ASSERTM(new_capacity <= max_capacity(), "vm_vec: %zu elements do not fit in the reserved range", new_capacity);
+
+    // Geometric growth, the commits are amortized like the copies of a vec would be
+    usize size = MAX(new_capacity * sizeof(T) - committed_, MAX(committed_, VM_VEC_MIN_COMMIT));
+    size       = MIN(ALIGN_UP(committed_ + size, VM_VEC_MIN_COMMIT), reserved_) - committed_;
+
+    os::mem_allocate((u8*)data_ + committed_, size, os::MemAllocationFlags::Commit);
+    committed_ += size;
+  }
+};
+
+} // namespace core
+
+#endif // INCLUDE_CONTAINERS_VM_VEC_H_
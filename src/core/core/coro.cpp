@@ -0,0 +1,108 @@
+#include "coro.h"
+#include <core/core.h>
+
+#include <mutex>
+
+#ifndef CORO_FRAME_MAX_CLASS
+  #define CORO_FRAME_MAX_CLASS KB(16zu)
+#endif
+
+namespace core {
+
+namespace {
+// Power of two size classes from 64 bytes to CORO_FRAME_MAX_CLASS, a freed frame goes on the free list of its class
+// The frames of a pipeline are about the same few sizes, they end up recycled without touching the heap
+// The bigger ones go to the General allocator
+constexpr usize FRAME_MIN_CLASS   = 64;
+constexpr usize FRAME_CLASS_COUNT = std::countr_zero(CORO_FRAME_MAX_CLASS) - std::countr_zero(FRAME_MIN_CLASS) + 1;
+
+struct free_frame {
+  free_frame* next;
+};
+
+struct {
+  std::mutex lock;
+  Arena* arena;
+  free_frame* free_lists[FRAME_CLASS_COUNT];
+} frames;
+
+usize frame_class(usize size) {
+  return (usize)std::countr_zero(std::bit_ceil(MAX(size, FRAME_MIN_CLASS))) - std::countr_zero(FRAME_MIN_CLASS);
+}
+
+void* frame_allocate(void*, usize size, usize alignement, const char* src) {
+  ASSERT(alignement <= alignof(std::max_align_t));
+  if (size > CORO_FRAME_MAX_CLASS) {
+    return get_named_allocator(AllocatorName::General).allocate_uninit(size, alignement, src);
+  }
+
+  usize c = frame_class(size);
+  std::lock_guard lock(frames.lock);
+  if (free_frame* f = frames.free_lists[c]) {
+    frames.free_lists[c] = f->next;
+    return f;
+  }
+  if (frames.arena == nullptr) {
+    frames.arena = &arena_alloc();
+  }
+  return frames.arena->allocate_uninit(FRAME_MIN_CLASS << c, alignof(std::max_align_t), src);
+}
+
+void frame_deallocate(void*, void* ptr, usize size, const char* src) {
+  if (size > CORO_FRAME_MAX_CLASS) {
+    return get_named_allocator(AllocatorName::General).deallocate(ptr, size, src);
+  }
+
+  usize c = frame_class(size);
+  std::lock_guard lock(frames.lock);
+  auto* f              = (free_frame*)ptr;
+  f->next              = frames.free_lists[c];
+  frames.free_lists[c] = f;
+}
+
+const AllocatorVTable frame_vtable{
+    .allocate        = frame_allocate,
+    .allocate_uninit = frame_allocate,
+    .deallocate      = frame_deallocate,
+    .try_resize      = [](void*, void*, usize, usize, const char*) { return false; },
+    .owns            = [](void*, void* ptr) { return frames.arena != nullptr && frames.arena->owns(ptr); },
+};
+
+struct coro_root {
+  coro_driver driver;
+  task<> t;
+};
+
+TaskReturn coro_step(coro_root* root, TaskQueue*) {
+  auto& d = root->driver;
+  if (d.poll != nullptr) {
+    if (!d.poll(d.poll_data)) {
+      return TaskReturn::Yield;
+    }
+    d.poll = nullptr;
+  }
+
+  d.leaf.resume();
+  if (!root->t.done()) {
+    return TaskReturn::Yield;
+  }
+
+  root->~coro_root();
+  get_named_allocator(AllocatorName::General).deallocate(root, sizeof(coro_root), "coroutine");
+  return TaskReturn::Stop;
+}
+} // namespace
+
+EXPORT Allocator coro_frame_allocator() {
+  return {nullptr, &frame_vtable};
+}
+
+EXPORT Task* spawn(TaskQueue& queue, task<> t, TaskAffinity affinity, TaskPriority priority) {
+  auto* root   = new (get_named_allocator(AllocatorName::General).allocate<coro_root>()) coro_root{};
+  root->t      = std::move(t);
+  root->driver = {root->t.handle, nullptr, nullptr};
+  root->t.handle.promise().driver = &root->driver;
+  return queue.spawn(Task::from(coro_step, root, affinity, priority));
+}
+
+} // namespace core
@@ -0,0 +1,230 @@
+#ifndef INCLUDE_CORE_CORO_H_
+#define INCLUDE_CORE_CORO_H_
+
+#include "base.h"
+#include "memory.h"
+#include "sched.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <utility>
+
+namespace core {
+
+// === Coroutine tasks ===
+//
+// task<T> is a lazy coroutine: it starts when it is awaited, or when it is spawned on a TaskQueue
+//   core::task<u32> count_nodes(core::Allocator alloc, cgltf_node* node);
+//   core::task<> load(core::Allocator alloc, ...) {
+//     auto bytes = co_await fs::read_file(alloc, path);
+//     co_await vk::fence_signaled(device, fence);
+//     u32 count  = co_await count_nodes(alloc, root);
+//   }
+//   core::spawn(*queue, load(arena, ...));
+//
+// Awaiting a task transfers to it directly and it transfers back when it returns
+// The other awaitables are polled: a coroutine waiting on one is resumed by the first tick that sees it ready
+// Nothing is polled more than once per tick and nothing blocks
+//
+// Frames are allocated from the Allocator given as first parameter of the coroutine (second for a member function)
+// when there is one, for instance an arena the frames are reset with
+// The other frames come from an arena of size classes that recycles them, not from the heap
+
+// INTERNAL
+// The coroutine a spawned task is suspended in, and what it waits for
+struct coro_driver {
+  std::coroutine_handle<> leaf;
+  bool (*poll)(void*);
+  void* poll_data;
+};
+
+// INTERNAL
+struct alignas(std::max_align_t) coro_frame_header {
+  Allocator alloc;
+  usize size;
+};
+
+// The frames of the coroutines without an Allocator parameter
+Allocator coro_frame_allocator();
+
+struct coro_promise_base {
+  coro_driver* driver = nullptr;
+  std::coroutine_handle<> continuation;
+
+  struct final_awaiter {
+    bool await_ready() noexcept {
+      return false;
+    }
+    template <class P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+      auto continuation = h.promise().continuation;
+      if (continuation) {
+        h.promise().driver->leaf = continuation;
+        return continuation;
+      }
+      return std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept {
+    return {};
+  }
+  final_awaiter final_suspend() noexcept {
+    return {};
+  }
+  void unhandled_exception() {
+    panic("unhandled exception in a coroutine");
+  }
+
+  static void* allocate_frame(Allocator alloc, usize size) {
+    usize total = sizeof(coro_frame_header) + size;
+    auto* h     = (coro_frame_header*)alloc.allocate_uninit(total, alignof(std::max_align_t), "coroutine frame");
+    h->alloc    = alloc;
+    h->size     = total;
+    return h + 1;
+  }
+
+  template <class... Args>
+  static void* operator new(usize size, Allocator alloc, Args&...) {
+    return allocate_frame(alloc, size);
+  }
+  template <class This, class... Args>
+    requires(!std::is_convertible_v<This&, Allocator>)
+  static void* operator new(usize size, This&, Allocator alloc, Args&...) {
+    return allocate_frame(alloc, size);
+  }
+  static void* operator new(usize size) {
+    return allocate_frame(coro_frame_allocator(), size);
+  }
+  static void operator delete(void* ptr) {
+    auto* h = (coro_frame_header*)ptr - 1;
+    h->alloc.deallocate(h, h->size, "coroutine frame");
+  }
+  // the header knows the allocator, these only match the operator new above
+  template <class... Args>
+  static void operator delete(void* ptr, Allocator, Args&...) {
+    operator delete(ptr);
+  }
+  template <class This, class... Args>
+    requires(!std::is_convertible_v<This&, Allocator>)
+  static void operator delete(void* ptr, This&, Allocator, Args&...) {
+    operator delete(ptr);
+  }
+};
+
+template <class T>
+struct coro_promise_value : coro_promise_base {
+  Maybe<T> value;
+
+  void return_value(T v) {
+    value = std::move(v);
+  }
+  T result() {
+    return std::move(*value);
+  }
+};
+
+template <>
+struct coro_promise_value<void> : coro_promise_base {
+  void return_void() {}
+  void result() {}
+};
+
+template <class T = void>
+struct [[nodiscard]] task {
+  struct promise_type : coro_promise_value<T> {
+    task get_return_object() {
+      return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+
+  task() = default;
+  explicit task(std::coroutine_handle<promise_type> handle)
+      : handle(handle) {}
+  task(task&& other)
+      : handle(std::exchange(other.handle, nullptr)) {}
+  task& operator=(task&& other) {
+    SWAP(handle, other.handle);
+    return *this;
+  }
+  task(const task&) = delete;
+  ~task() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+
+  bool done() const {
+    return handle.done();
+  }
+
+  // Runs the task until its first suspension
+  bool await_ready() {
+    return false;
+  }
+  template <class P>
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<P> parent) {
+    handle.promise().continuation = parent;
+    handle.promise().driver       = parent.promise().driver;
+    handle.promise().driver->leaf = handle;
+    return handle;
+  }
+  T await_resume() {
+    return handle.promise().result();
+  }
+};
+
+// An awaitable checked once when awaited then once per tick, Self gives bool poll() and await_resume()
+template <class Self>
+struct poll_awaiter {
+  bool await_ready() {
+    return static_cast<Self*>(this)->poll();
+  }
+  template <class P>
+  void await_suspend(std::coroutine_handle<P> h) {
+    coro_driver* driver = h.promise().driver;
+    driver->leaf        = h;
+    driver->poll        = [](void* self) { return static_cast<Self*>(self)->poll(); };
+    driver->poll_data   = static_cast<Self*>(this);
+  }
+};
+
+// Resumes on the next tick
+struct next_tick : poll_awaiter<next_tick> {
+  bool polled = false;
+
+  bool poll() {
+    return std::exchange(polled, true);
+  }
+  void await_resume() {}
+};
+
+// Resumes once the counter reached 0, for instance the done counter of a child job
+struct counter_awaiter : poll_awaiter<counter_awaiter> {
+  JobCounter* counter;
+
+  bool poll() {
+    return counter->is_zero();
+  }
+  void await_resume() {}
+};
+
+inline counter_awaiter job_done(JobCounter& counter) {
+  return {{}, &counter};
+}
+
+// Runs t on queue, one step per tick, from the main thread or from the workers depending on the affinity
+// The frames are destroyed when it returns, the Task is Stopped then and can be deallocated
+Task* spawn(
+    TaskQueue& queue,
+    task<> t,
+    TaskAffinity affinity = TaskAffinity::Main,
+    TaskPriority priority = TaskPriority::Interactive
+);
+
+} // namespace core
+
+#endif // INCLUDE_CORE_CORO_H_
@@ -0,0 +1,544 @@
+#include "../os/memory.h"
+
+#include <core/core.h>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+// General purpose allocator, this is what AllocatorName::General gives
+//
+// The heap reserves one big range of virtual memory and cuts it into slabs of SLAB_SIZE bytes
+// - small allocations (<= SMALL_MAX) are served from slabs dedicated to one size class
+// - large allocations get a run of contiguous slabs, committed on demand so they can grow in place
+// A table with one entry per slab lives in front of the slabs: any pointer can be mapped back to its
+// slab, deallocate and owns don't need the size
+//
+// Each thread caches free blocks per size class, the global pools are only locked to refill or
+// flush a cache. Blocks carved from a fresh slab are known to be zero and are not cleared again
+//
+// Small slabs are never given back to the os, large runs are decommitted on free, merged with the free runs
+// around them and reused
+
+namespace core {
+namespace {
+
+const usize SLAB_SIZE   = KB(64zu);
+const usize SMALL_MAX   = KB(32zu);
+const usize CLASS_COUNT = 40;
+const u32 NO_RUN        = u32(-1);
+
+// 16 bytes steps up to 128, then 4 classes for each power of two
+constexpr usize size_class_of(usize size) {
+  if (size <= 128) {
+    return size == 0 ? 0 : (size - 1) / 16;
+  }
+
+  usize s     = size - 1;
+  usize b     = (usize)std::bit_width(s);
+  usize shift = b - 3;
+  return 8 + (b - 8) * 4 + ((s >> shift) - 4);
+}
+
+constexpr usize class_size(usize size_class) {
+  if (size_class < 8) {
+    return (size_class + 1) * 16;
+  }
+
+  usize k    = size_class - 8;
+  usize step = 1zu << (k / 4 + 5);
+  return (k % 4 + 5) * step;
+}
+
+static_assert(size_class_of(SMALL_MAX) == CLASS_COUNT - 1);
+static_assert(class_size(size_class_of(SMALL_MAX)) == SMALL_MAX);
+static_assert(class_size(size_class_of(129)) == 160);
+static_assert(class_size(size_class_of(4096)) == 4096);
+
+constexpr usize cache_limit(usize size_class) {
+  return MIN(256zu, MAX(2zu, KB(32zu) / class_size(size_class)));
+}
+
+struct free_block {
+  free_block* next;
+};
+
+struct slab_entry {
+  enum class Kind : u8 { Unused, Small, Large, LargeTail, FreeRun, FreeRunTail } kind;
+  u8 size_class;
+  // Large and FreeRun: length of the run in slabs
+  u32 slab_count;
+  // FreeRun: links of the free run list
+  u32 next_free_run;
+  u32 prev_free_run;
+  // LargeTail and FreeRunTail: first slab of the run, a freed run finds the free run before it from its last slab
+  u32 head;
+  // Large: bytes committed from the start of the run
+  usize committed;
+};
+
+struct class_pool {
+  std::mutex lock;
+  free_block* free;
+  usize count;
+
+  // never touched blocks of the current slab
+  u8* fresh;
+  u8* fresh_end;
+};
+
+struct heap_state {
+  slab_entry* table;
+  u8* table_committed;
+  u8* slabs;
+  u32 slab_capacity;
+
+  // protects frontier, free_runs and the table entries
+  // frontier is only written under the lock, in_range reads it without
+  std::mutex lock;
+  std::atomic<u32> frontier;
+  u32 free_runs;
+
+  class_pool pools[CLASS_COUNT];
+
+  u32 slab_index(const void* ptr) const {
+    return u32(((const u8*)ptr - slabs) / SLAB_SIZE);
+  }
+  u8* slab_ptr(u32 idx) const {
+    return slabs + idx * SLAB_SIZE;
+  }
+  bool in_range(const void* ptr) const {
+    return ptr >= slabs && ptr < slab_ptr(frontier.load(std::memory_order_relaxed));
+  }
+};
+
+heap_state& heap() {
+  static heap_state* h = [] {
+    static heap_state state{};
+
+    const usize page_size  = os::mem_page_size();
+    state.slab_capacity    = u32(HEAP_CAPACITY / SLAB_SIZE);
+    const usize table_size = ALIGN_UP(state.slab_capacity * sizeof(slab_entry), page_size);
+
+    u8* memory = (u8*)os::mem_allocate(nullptr, table_size + SLAB_SIZE + HEAP_CAPACITY, os::MemAllocationFlags::Reserve);
+    ASSERT(memory != nullptr);
+
+    state.table           = (slab_entry*)memory;
+    state.table_committed = memory;
+    state.slabs           = ALIGN_UP(memory + table_size, SLAB_SIZE);
+    state.free_runs       = NO_RUN;
+    return &state;
+  }();
+  return *h;
+}
+
+// === Slab runs ===
+// All of those require the heap lock
+
+void mark_run(heap_state& h, u32 idx, u32 slab_count, slab_entry::Kind head, slab_entry::Kind tail) {
+  h.table[idx] = {.kind = head, .slab_count = slab_count, .next_free_run = NO_RUN, .prev_free_run = NO_RUN};
+  for (u32 i = idx + 1; i < idx + slab_count; i++) {
+    h.table[i] = {.kind = tail, .head = idx};
+  }
+}
+
+void push_free_run(heap_state& h, u32 idx, u32 slab_count) {
+  mark_run(h, idx, slab_count, slab_entry::Kind::FreeRun, slab_entry::Kind::FreeRunTail);
+  h.table[idx].next_free_run = h.free_runs;
+  if (h.free_runs != NO_RUN) {
+    h.table[h.free_runs].prev_free_run = idx;
+  }
+  h.free_runs = idx;
+}
+
+void unlink_free_run(heap_state& h, u32 idx) {
+  auto& entry = h.table[idx];
+  if (entry.prev_free_run == NO_RUN) {
+    h.free_runs = entry.next_free_run;
+  } else {
+    h.table[entry.prev_free_run].next_free_run = entry.next_free_run;
+  }
+  if (entry.next_free_run != NO_RUN) {
+    h.table[entry.next_free_run].prev_free_run = entry.prev_free_run;
+  }
+}
+
+void grow_frontier(heap_state& h, u32 slab_count) {
+  u32 frontier = h.frontier.load(std::memory_order_relaxed) + slab_count;
+  ASSERTM(frontier <= h.slab_capacity, "Heap: out of address space, bump HEAP_CAPACITY");
+
+  u8* table_end = (u8*)(h.table + frontier);
+  if (table_end > h.table_committed) {
+    usize size = usize(ALIGN_UP(table_end, os::mem_page_size()) - h.table_committed);
+    os::mem_allocate(h.table_committed, size, os::MemAllocationFlags::Commit);
+    h.table_committed += size;
+  }
+  h.frontier.store(frontier, std::memory_order_relaxed);
+}
+
+// First fit in the free runs, the frontier otherwise
+u32 take_run(heap_state& h, u32 slab_count) {
+  for (u32 idx = h.free_runs; idx != NO_RUN; idx = h.table[idx].next_free_run) {
+    u32 run_count = h.table[idx].slab_count;
+    if (run_count < slab_count) {
+      continue;
+    }
+
+    unlink_free_run(h, idx);
+    if (run_count > slab_count) {
+      push_free_run(h, idx + slab_count, run_count - slab_count);
+    }
+    return idx;
+  }
+
+  u32 idx = h.frontier.load(std::memory_order_relaxed);
+  grow_frontier(h, slab_count);
+  return idx;
+}
+
+// Free runs are coalesced with their neighbours, so no two free runs are adjacent and none ends at the frontier
+void give_back_run(heap_state& h, u32 idx, u32 slab_count) {
+  u32 frontier = h.frontier.load(std::memory_order_relaxed);
+
+  u32 next = idx + slab_count;
+  if (next < frontier && h.table[next].kind == slab_entry::Kind::FreeRun) {
+    unlink_free_run(h, next);
+    slab_count += h.table[next].slab_count;
+  }
+
+  if (idx > 0) {
+    auto& before = h.table[idx - 1];
+    u32 head     = NO_RUN;
+    if (before.kind == slab_entry::Kind::FreeRun) {
+      head = idx - 1;
+    } else if (before.kind == slab_entry::Kind::FreeRunTail) {
+      head = before.head;
+    }
+    if (head != NO_RUN) {
+      unlink_free_run(h, head);
+      slab_count += idx - head;
+      idx = head;
+    }
+  }
+
+  if (idx + slab_count != frontier) {
+    push_free_run(h, idx, slab_count);
+    return;
+  }
+
+  // the frontier goes back, with the free run that ended where this one starts merged above
+  mark_run(h, idx, slab_count, slab_entry::Kind::Unused, slab_entry::Kind::Unused);
+  h.frontier.store(idx, std::memory_order_relaxed);
+}
+
+// === Small allocations ===
+
+struct thread_cache {
+  struct bin {
+    free_block* free;
+    usize count;
+    u8* fresh;
+    u8* fresh_end;
+  };
+  bin bins[CLASS_COUNT]{};
+
+  ~thread_cache();
+};
+thread_local thread_cache tcache;
+
+void pool_push(class_pool& pool, free_block* first, free_block* last, usize count) {
+  std::lock_guard lock{pool.lock};
+  last->next  = pool.free;
+  pool.free   = first;
+  pool.count += count;
+}
+
+void flush_bin(usize size_class, thread_cache::bin& bin, usize keep) {
+  auto& pool = heap().pools[size_class];
+
+  // fresh blocks that are left become regular free blocks
+  const usize csize = class_size(size_class);
+  for (; bin.fresh < bin.fresh_end; bin.fresh += csize) {
+    auto* b   = (free_block*)bin.fresh;
+    b->next   = bin.free;
+    bin.free  = b;
+    bin.count++;
+  }
+  bin.fresh = bin.fresh_end = nullptr;
+
+  if (bin.count <= keep) {
+    return;
+  }
+
+  usize count       = bin.count - keep;
+  free_block* first = bin.free;
+  free_block* last  = first;
+  for (usize i = 1; i < count; i++) {
+    last = last->next;
+  }
+
+  bin.free   = last->next;
+  bin.count -= count;
+  pool_push(pool, first, last, count);
+}
+
+thread_cache::~thread_cache() {
+  for (usize size_class = 0; size_class < CLASS_COUNT; size_class++) {
+    flush_bin(size_class, bins[size_class], 0);
+  }
+}
+
+void refill_bin(usize size_class, thread_cache::bin& bin) {
+  auto& h           = heap();
+  auto& pool        = h.pools[size_class];
+  const usize csize = class_size(size_class);
+  const usize batch = MAX(1zu, cache_limit(size_class) / 2);
+
+  std::lock_guard lock{pool.lock};
+  if (pool.free != nullptr) {
+    free_block* first = pool.free;
+    free_block* last  = first;
+    usize count       = 1;
+    while (count < batch && last->next != nullptr) {
+      last = last->next;
+      count++;
+    }
+
+    pool.free   = last->next;
+    pool.count -= count;
+    last->next  = bin.free;
+    bin.free    = first;
+    bin.count  += count;
+    return;
+  }
+
+  if (pool.fresh == pool.fresh_end) {
+    u32 idx;
+    {
+      std::lock_guard heap_lock{h.lock};
+      idx          = take_run(h, 1);
+      h.table[idx] = {
+          .kind          = slab_entry::Kind::Small,
+          .size_class    = u8(size_class),
+          .slab_count    = 1,
+          .next_free_run = NO_RUN,
+      };
+    }
+
+    // recycled runs have been decommitted, so the slab is zero either way
+    pool.fresh     = h.slab_ptr(idx);
+    pool.fresh_end = pool.fresh + (SLAB_SIZE / csize) * csize;
+    os::mem_allocate(pool.fresh, SLAB_SIZE, os::MemAllocationFlags::Commit);
+  }
+
+  bin.fresh     = pool.fresh;
+  bin.fresh_end = MIN(pool.fresh_end, pool.fresh + batch * csize);
+  pool.fresh    = bin.fresh_end;
+}
+
+void* small_allocate(usize size_class, usize size, bool zero) {
+  auto& bin = tcache.bins[size_class];
+
+  if (bin.fresh == bin.fresh_end && bin.free == nullptr) {
+    refill_bin(size_class, bin);
+  }
+
+  // recently freed blocks first, they are still in cache
+  if (bin.free != nullptr) {
+    free_block* b = bin.free;
+    bin.free      = b->next;
+    bin.count--;
+
+    if (zero) {
+      memset(b, 0, size);
+    }
+    return b;
+  }
+
+  void* ptr  = bin.fresh;
+  bin.fresh += class_size(size_class);
+  return ptr;
+}
+
+void small_deallocate(usize size_class, void* ptr) {
+  auto& bin = tcache.bins[size_class];
+  auto* b   = (free_block*)ptr;
+  b->next   = bin.free;
+  bin.free  = b;
+  bin.count++;
+
+  if (bin.count > cache_limit(size_class)) {
+    flush_bin(size_class, bin, cache_limit(size_class) / 2);
+  }
+}
+
+// === Large allocations ===
+
+void* large_allocate(usize size) {
+  auto& h          = heap();
+  u32 slab_count   = u32(ALIGN_UP(size, SLAB_SIZE) / SLAB_SIZE);
+  usize commit     = ALIGN_UP(size, os::mem_page_size());
+
+  u32 idx;
+  {
+    std::lock_guard lock{h.lock};
+    idx = take_run(h, slab_count);
+    mark_run(h, idx, slab_count, slab_entry::Kind::Large, slab_entry::Kind::LargeTail);
+    h.table[idx].committed = commit;
+  }
+
+  u8* ptr = h.slab_ptr(idx);
+  os::mem_allocate(ptr, commit, os::MemAllocationFlags::Commit);
+  return ptr;
+}
+
+void large_deallocate(heap_state& h, u32 idx) {
+  auto& entry = h.table[idx];
+  os::mem_deallocate(h.slab_ptr(idx), entry.committed, os::MemDeallocationFlags::Decommit);
+
+  std::lock_guard lock{h.lock};
+  give_back_run(h, idx, entry.slab_count);
+}
+
+bool large_try_grow(heap_state& h, u32 idx, usize cur_size, usize new_size) {
+  auto& entry = h.table[idx];
+  u8* ptr     = h.slab_ptr(idx);
+
+  if (new_size > entry.slab_count * SLAB_SIZE) {
+    // The run can only be extended if it is the last one
+    std::lock_guard lock{h.lock};
+    if (idx + entry.slab_count != h.frontier.load(std::memory_order_relaxed)) {
+      return false;
+    }
+
+    u32 slab_count = u32(ALIGN_UP(new_size, SLAB_SIZE) / SLAB_SIZE);
+    if (idx + slab_count > h.slab_capacity) {
+      return false;
+    }
+
+    grow_frontier(h, slab_count - entry.slab_count);
+    for (u32 i = idx + entry.slab_count; i < idx + slab_count; i++) {
+      h.table[i] = {.kind = slab_entry::Kind::LargeTail, .head = idx};
+    }
+    entry.slab_count = slab_count;
+  }
+
+  usize old_committed = entry.committed;
+  if (new_size > old_committed) {
+    usize commit = ALIGN_UP(new_size, os::mem_page_size());
+    os::mem_allocate(ptr + old_committed, commit - old_committed, os::MemAllocationFlags::Commit);
+    entry.committed = commit;
+  }
+
+  // freshly committed pages are zero, the rest may hold data from before a shrink
+  if (old_committed > cur_size) {
+    memset(ptr + cur_size, 0, MIN(new_size, old_committed) - cur_size);
+  }
+  return true;
+}
+
+// === Entry points ===
+
+void* heap_allocate(usize size, usize alignement, bool zero) {
+  DEBUG_ASSERT(std::popcount(alignement) == 1);
+  ASSERTM(alignement <= SLAB_SIZE, "Heap: alignement of %zu is not supported", alignement);
+
+  if (size == 0) {
+    return nullptr;
+  }
+
+  // Power of two classes are naturally aligned inside a slab
+  if (alignement > max_align && size <= SMALL_MAX) {
+    size = std::bit_ceil(MAX(size, alignement));
+  }
+
+  if (size <= SMALL_MAX) {
+    return small_allocate(size_class_of(size), size, zero);
+  }
+  return large_allocate(size);
+}
+
+void heap_deallocate(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  auto& h = heap();
+  ASSERTM(h.in_range(ptr), "Heap: trying to free a pointer that was not allocated by the heap");
+
+  u32 idx     = h.slab_index(ptr);
+  auto& entry = h.table[idx];
+  switch (entry.kind) {
+  case slab_entry::Kind::Small:
+    small_deallocate(entry.size_class, ptr);
+    break;
+  case slab_entry::Kind::Large:
+    ASSERTM(ptr == h.slab_ptr(idx), "Heap: trying to free a pointer in the middle of an allocation");
+    large_deallocate(h, idx);
+    break;
+  default:
+    panic("Heap: trying to free a pointer that is not allocated");
+  }
+}
+
+bool heap_try_resize(void* ptr, usize cur_size, usize new_size) {
+  auto& h = heap();
+  if (ptr == nullptr || !h.in_range(ptr)) {
+    return false;
+  }
+
+  if (new_size == 0) {
+    heap_deallocate(ptr);
+    return true;
+  }
+  if (new_size <= cur_size) {
+    return true;
+  }
+
+  u32 idx     = h.slab_index(ptr);
+  auto& entry = h.table[idx];
+  switch (entry.kind) {
+  case slab_entry::Kind::Small: {
+    if (new_size > class_size(entry.size_class)) {
+      return false;
+    }
+    memset((u8*)ptr + cur_size, 0, new_size - cur_size);
+    return true;
+  }
+  case slab_entry::Kind::Large:
+    return large_try_grow(h, idx, cur_size, new_size);
+  default:
+    return false;
+  }
+}
+
+bool heap_owns(void* ptr) {
+  auto& h = heap();
+  if (!h.in_range(ptr)) {
+    return false;
+  }
+
+  switch (h.table[h.slab_index(ptr)].kind) {
+  case slab_entry::Kind::Small:
+  case slab_entry::Kind::Large:
+  case slab_entry::Kind::LargeTail:
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+const AllocatorVTable HeapVtable{
+    .allocate        = [](void*, usize size, usize alignement, const char* src
+                ) { return heap_allocate(size, alignement, true); },
+    .allocate_uninit = [](void*, usize size, usize alignement, const char* src
+                       ) { return heap_allocate(size, alignement, false); },
+    .deallocate      = [](void*, void* alloc_base_ptr, usize size, const char* src) { heap_deallocate(alloc_base_ptr); },
+    .try_resize      = [](void*, void* ptr, usize cur_size, usize new_size, const char* src
+                  ) { return heap_try_resize(ptr, cur_size, new_size); },
+    .owns            = [](void*, void* ptr) { return heap_owns(ptr); },
+};
+
+} // namespace core
@@ -1,13 +1,12 @@
 #include "../os/memory.h"
+#include "memory_tracker.h"
 
 #include <core/core.h>
 #include <cstring>
 
 using namespace core::enum_helpers;
 
-#ifdef DEBUG
-  #include <bit>
-#endif
+#include <bit>
 
 #ifdef SCRATCH_DEBUG
   #include <stdio.h>
@@ -36,7 +35,15 @@ EXPORT usize arena_page_size() {
 }
 
 EXPORT bool Arena::owns(void* ptr) {
-  return ptr >= base && ptr < mem;
+  if (ptr >= base && ptr < mem) {
+    return true;
+  }
+  for (ArenaBlock* b = block; b != nullptr; b = b->block) {
+    if (ptr >= b->base && ptr < b->mem) {
+      return true;
+    }
+  }
+  return false;
 }
 EXPORT bool Arena::try_resize(void* ptr, usize cur_size, usize new_size, const char* src) {
   if (!owns(ptr)) {
@@ -47,6 +54,11 @@ EXPORT bool Arena::try_resize(void* ptr, usize cur_size, usize new_size, const c
     return false;
   }
 
+  // growing can't move to another block
+  if ((u8*)ptr + new_size > base + capacity) {
+    return false;
+  }
+
   if (new_size >= cur_size) {
     allocate(new_size - cur_size, 1, src);
   } else {
@@ -57,44 +69,75 @@ EXPORT bool Arena::try_resize(void* ptr, usize cur_size, usize new_size, const c
 }
 
 EXPORT void* Arena::allocate(usize size, usize alignement, const char* src) {
+  u8* known_zero;
+  u8* ptr = bump(size, alignement, src, known_zero);
+
+  // only what has already been handed out needs to be cleared
+  if (ptr != nullptr && ptr < known_zero) {
+    memset(ptr, 0, MIN(size, usize(known_zero - ptr)));
+  }
+  return ptr;
+}
+
+EXPORT void* Arena::allocate_uninit(usize size, usize alignement, const char* src) {
+  u8* known_zero;
+  return bump(size, alignement, src, known_zero);
+}
+
+EXPORT u8* Arena::bump(usize size, usize alignement, const char* src, u8*& known_zero) {
   ARENA_DEBUG_STMT(
       printf("Arena: trying to allocate %zu from %s, %zu available\n", size, src, capacity - (usize)(mem - base))
   );
   DEBUG_ASSERT(std::popcount(alignement) == 1);
 
+  known_zero = zeroed;
   if (size == 0) {
     return nullptr;
   }
 
   u8* aligned = ALIGN_UP(mem, alignement);
+  if (aligned + size > base + capacity) {
+    push_block(size, alignement);
+    aligned = ALIGN_UP(mem, alignement);
+    // the watermark of the block serving the allocation, a reused spare has its own
+    known_zero = zeroed;
+  }
   ARENA_DEBUG_STMT(
       printf("Arena: padding for %zu byte for alignement, alignement is %zu\n", (usize)(aligned - mem), alignement)
   );
 
-  ASSERTM(
-      base + capacity >= aligned + size, "Arena: out of memory! please implement the commit stuff of ask for more "
-                                         "memory"
-  );
-
-  mem = aligned + size;
+  mem  = aligned + size;
+  peak = MAX(peak, mem);
 
   ARENA_DEBUG_STMT(printf("Arena: allocated region [%p, %p)\n", aligned, mem));
 
-  if (mem > committed) {
-    ARENA_DEBUG_STMT(printf("Arena: Region need being committed!\n"));
-    usize page_size = arena_page_size();
-    usize size      = usize(ALIGN_UP(mem, page_size) - committed);
+  commit_until(mem);
+  zeroed = MAX(zeroed, mem);
 
-    os::mem_allocate(committed, size, os::MemAllocationFlags::Commit);
-    ARENA_DEBUG_STMT(printf("Arena: commited region [%p, %p)\n", committed, committed + size));
-    committed += size;
-  } else {
+  ASAN_UNPOISON_MEMORY_REGION(aligned, size);
+  return aligned;
+}
+
+EXPORT void Arena::commit_until(u8* end) {
+  if (end <= committed) {
     ARENA_DEBUG_STMT(printf("Arena: no need to commit region already committed until %p\n", committed));
+    return;
   }
 
-  ASAN_UNPOISON_MEMORY_REGION(aligned, size);
-  memset(aligned, 0, size);
-  return aligned;
+  // Geometric growth: commit as much as what is already committed, within the policy bounds
+  u8* arena_end = base + capacity;
+  usize chunk   = MIN(MAX(policy.min_commit, usize(committed - base)), policy.max_commit);
+  usize size    = MAX(usize(end - committed), chunk);
+  size          = MIN(ALIGN_UP(size, policy.min_commit), usize(arena_end - committed));
+
+  auto flags = os::MemAllocationFlags::Commit;
+  if (policy.prefault) {
+    flags |= os::MemAllocationFlags::Populate;
+  }
+
+  os::mem_allocate(committed, size, flags);
+  ARENA_DEBUG_STMT(printf("Arena: commited region [%p, %p)\n", committed, committed + size));
+  committed += size;
 }
 
 EXPORT void Arena::deallocate(usize size) {
@@ -102,42 +145,212 @@ EXPORT void Arena::deallocate(usize size) {
     return;
   }
 
-  ASSERT(pos() >= size);
+  ASSERT(usize(mem - base) >= size);
   mem -= size;
   ASAN_POISON_MEMORY_REGION(mem, capacity - usize(mem - base));
 
-  usize page_size = arena_page_size();
-  if (mem + page_size < committed) {
-    u8* aligned = ALIGN_UP(mem, page_size);
-    usize size  = ALIGN_DOWN(usize(committed - aligned), page_size);
+  // Pages above mem are kept up to policy.retain, the next allocations will want them back
+  // track_reset decommits them if they stay unused
+  decommit_from(ALIGN_UP(mem, policy.min_commit) + policy.retain);
+}
 
-    os::mem_deallocate(aligned, size, os::MemDeallocationFlags::Decommit);
-    committed = aligned;
+EXPORT void Arena::decommit_from(u8* keep) {
+  keep = MAX(keep, ALIGN_UP(mem, policy.min_commit) + policy.min_commit);
+  if (keep >= committed) {
+    return;
   }
+
+  ARENA_DEBUG_STMT(printf("Arena: decommiting region [%p, %p)\n", keep, committed));
+  os::mem_deallocate(keep, usize(committed - keep), os::MemDeallocationFlags::Decommit);
+  committed = keep;
+#ifndef MEM_USE_MALLOC
+  // pages come back zeroed from the os
+  zeroed = MIN(zeroed, keep);
+#endif
 }
 
-EXPORT Arena& arena_alloc(usize capacity) {
-  usize page_size        = arena_page_size();
-  const usize alloc_size = ALIGN_UP(sizeof(Arena) + capacity, page_size);
+EXPORT void Arena::track_reset() {
+  reset_count++;
 
-  u8* memory = (u8*)os::mem_allocate(nullptr, alloc_size, os::MemAllocationFlags::Reserve);
+  u8* needed = ALIGN_UP(peak, policy.min_commit) + policy.min_commit;
+  if (needed < committed) {
+    idle_peak = MAX(idle_peak, peak);
+    idle_count++;
+  } else {
+    idle_peak  = base;
+    idle_count = 0;
+  }
+  peak = mem;
+
+  if (idle_count >= policy.idle_resets) {
+    ARENA_DEBUG_STMT(printf("Arena: %u resets under %p, trimming\n", idle_count, idle_peak));
+    decommit_from(ALIGN_UP(idle_peak, policy.min_commit) + policy.min_commit);
+    idle_peak  = base;
+    idle_count = 0;
+  }
+
+  // the reset that popped the spare does not count, it needed it
+  if (spare != nullptr && spare_idle++ >= policy.idle_resets) {
+    ARENA_DEBUG_STMT(printf("Arena: spare block unused for %u resets\n", policy.idle_resets));
+    release_spare();
+  }
+}
+
+EXPORT void Arena::trim() {
+  decommit_from(mem);
+  peak       = mem;
+  idle_peak  = base;
+  idle_count = 0;
+  release_spare();
+}
+
+// Reserves alloc_size bytes and commits the first min_commit of them
+static u8* arena_reserve_block(usize alloc_size, const ArenaCommitPolicy& policy) {
+  auto reserve_flags = os::MemAllocationFlags::Reserve;
+  if (policy.huge_pages) {
+    reserve_flags |= os::MemAllocationFlags::HugePages;
+  }
+  u8* memory = (u8*)os::mem_allocate(nullptr, alloc_size, reserve_flags);
   ARENA_DEBUG_STMT(printf("Arena: got range [%p, %p)\n", memory, memory + alloc_size));
   ASSERT(memory != nullptr);
 
-  os::mem_allocate(memory, page_size, os::MemAllocationFlags::Commit);
+  os::mem_allocate(memory, policy.min_commit, os::MemAllocationFlags::Commit);
+  return memory;
+}
+
+EXPORT void Arena::push_block(usize size, usize alignement) {
+  ASSERTM(policy.chained, "Arena: out of memory! %zu bytes asked, use a chained arena or a bigger capacity", size);
+
+  if (spare != nullptr && spare->capacity < size + alignement) {
+    release_spare();
+  }
+
+  ArenaBlock next;
+  u8* memory;
+  if (spare != nullptr) {
+    memory = (u8*)spare;
+    next   = *spare;
+    spare  = nullptr;
+    ARENA_DEBUG_STMT(printf("Arena: reusing spare block [%p, %p)\n", next.base, next.base + next.capacity));
+  } else {
+    usize block_capacity   = MAX(2 * capacity, size + alignement);
+    const usize alloc_size = ALIGN_UP(sizeof(ArenaBlock) + block_capacity, policy.min_commit);
+    memory                 = arena_reserve_block(alloc_size, policy);
+
+    next = {
+        .base      = memory + sizeof(ArenaBlock),
+        .committed = memory + policy.min_commit,
+        .capacity  = alloc_size - sizeof(ArenaBlock),
+        .zeroed    = memory + sizeof(ArenaBlock),
+    };
+  }
+
+  auto* record = (ArenaBlock*)memory;
+  *record      = {
+      .base      = base,
+      .mem       = mem,
+      .committed = committed,
+      .capacity  = capacity,
+      .zeroed    = zeroed,
+      .peak      = peak,
+      .base_pos  = base_pos,
+      .block     = block,
+  };
+
+  base_pos  = pos();
+  block     = record;
+  mem       = base = next.base;
+  committed = next.committed;
+  capacity  = next.capacity;
+  zeroed    = next.zeroed;
+
+  peak = idle_peak = base;
+  idle_count       = 0;
+  ARENA_DEBUG_STMT(printf("Arena: chained block [%p, %p) at pos %zu\n", base, base + capacity, base_pos));
+
+  ASAN_POISON_MEMORY_REGION(base, capacity);
+}
+
+EXPORT void Arena::pop_block() {
+  DEBUG_ASSERT(block != nullptr);
+  ArenaBlock* record = block;
+  ARENA_DEBUG_STMT(printf("Arena: popping chained block [%p, %p)\n", base, base + capacity));
+
+  // the block becomes the spare, with what the policy retains committed
+  mem = base;
+  ASAN_POISON_MEMORY_REGION(base, capacity);
+  decommit_from(base + policy.retain);
+  ArenaBlock popped{
+      .base      = base,
+      .mem       = base,
+      .committed = committed,
+      .capacity  = capacity,
+      .zeroed    = zeroed,
+  };
+
+  base      = record->base;
+  mem       = record->mem;
+  committed = record->committed;
+  capacity  = record->capacity;
+  zeroed    = record->zeroed;
+  peak      = record->peak;
+  base_pos  = record->base_pos;
+  block     = record->block;
+
+  idle_peak  = base;
+  idle_count = 0;
+
+  release_spare();
+  *record    = popped;
+  spare      = record;
+  spare_idle = 0;
+}
+
+EXPORT void Arena::release_spare() {
+  if (spare == nullptr) {
+    return;
+  }
+  ARENA_DEBUG_STMT(printf("Arena: releasing spare block [%p, %p)\n", spare->base, spare->base + spare->capacity));
+  os::mem_deallocate(spare, sizeof(ArenaBlock) + spare->capacity, os::MemDeallocationFlags::Release);
+  spare = nullptr;
+}
+
+EXPORT Arena& arena_alloc(usize capacity, ArenaCommitPolicy policy) {
+  // commits are done in multiples of min_commit, so that they stay page aligned
+  usize page_size   = policy.huge_pages ? MAX(arena_page_size(), os::mem_huge_page_size()) : arena_page_size();
+  policy.min_commit = std::bit_ceil(MAX(policy.min_commit, page_size));
+  policy.max_commit = MAX(policy.max_commit, policy.min_commit);
+
+  const usize alloc_size = ALIGN_UP(sizeof(Arena) + capacity, policy.min_commit);
+  u8* memory             = arena_reserve_block(alloc_size, policy);
 
   capacity = alloc_size - sizeof(Arena);
 
   Arena* arena_ = (Arena*)memory;
   arena_->mem = arena_->base = memory + sizeof(Arena);
-  arena_->committed          = memory;
+  arena_->committed          = memory + policy.min_commit;
   arena_->capacity           = capacity;
+  arena_->policy             = policy;
+  arena_->zeroed             = arena_->base;
+
+  arena_->peak = arena_->idle_peak = arena_->base;
+  arena_->idle_count               = 0;
+  arena_->reset_count              = 0;
+  arena_->block                    = nullptr;
+  arena_->base_pos                 = 0;
+  arena_->spare                    = nullptr;
+  arena_->spare_idle               = 0;
 
   ASAN_POISON_MEMORY_REGION(arena_->mem, arena_->capacity);
   return *arena_;
 }
 
 EXPORT void arena_dealloc(Arena& arena_) {
+  untrack_arena(arena_);
+  while (arena_.block != nullptr) {
+    arena_.pop_block();
+  }
+  arena_.release_spare();
   const usize alloc_size = sizeof(Arena) + arena_.capacity;
 
   ARENA_DEBUG_STMT(printf("Arena: realeasing range [%p, %p)\n", &arena_, &arena_ + alloc_size));
@@ -145,12 +358,18 @@ EXPORT void arena_dealloc(Arena& arena_) {
 }
 
 EXPORT void Arena::pop_pos(u64 old_pos) {
-  auto cur_pos = pos();
-  ASSERT(cur_pos >= old_pos);
-  deallocate(cur_pos - old_pos);
+  ASSERT(pos() >= old_pos);
+  while (block != nullptr && old_pos <= base_pos) {
+    pop_block();
+  }
+  deallocate(pos() - old_pos);
+
+  if (old_pos == 0) {
+    track_reset();
+  }
 }
 EXPORT u64 Arena::pos() {
-  return (u64)(mem - base);
+  return base_pos + (u64)(mem - base);
 }
 EXPORT ArenaTemp Arena::make_temp() {
   return ArenaTemp{
@@ -159,6 +378,145 @@ EXPORT ArenaTemp Arena::make_temp() {
   };
 }
 
+EXPORT bool ConcurrentArena::owns(void* ptr) {
+  return ptr >= base && ptr < mem.load(std::memory_order_relaxed);
+}
+
+EXPORT void ConcurrentArena::commit_until(u8* end) {
+  u8* cur_committed = committed.load(std::memory_order_acquire);
+  if (end <= cur_committed) {
+    return;
+  }
+
+  u8* target = ALIGN_UP(end, arena_page_size());
+  // Several threads may commit overlapping ranges, committing twice is harmless
+  // The watermark is only moved forward, once a thread sees it past its region the region is committed
+  while (cur_committed < target) {
+    ARENA_DEBUG_STMT(printf("ConcurrentArena: commiting region [%p, %p)\n", cur_committed, target));
+    os::mem_allocate(cur_committed, usize(target - cur_committed), os::MemAllocationFlags::Commit);
+    if (committed.compare_exchange_weak(cur_committed, target, std::memory_order_release, std::memory_order_acquire)) {
+      break;
+    }
+  }
+}
+
+EXPORT void* ConcurrentArena::allocate(usize size, usize alignement, const char* src) {
+  void* ptr = allocate_uninit(size, alignement, src);
+  if (ptr != nullptr) {
+    memset(ptr, 0, size);
+  }
+  return ptr;
+}
+
+EXPORT void* ConcurrentArena::allocate_uninit(usize size, usize alignement, const char* src) {
+  DEBUG_ASSERT(std::popcount(alignement) == 1);
+
+  if (size == 0) {
+    return nullptr;
+  }
+
+  u8* cur = mem.load(std::memory_order_relaxed);
+  u8* aligned;
+  u8* end;
+  do {
+    aligned = ALIGN_UP(cur, alignement);
+    end     = aligned + size;
+    ASSERTM(base + capacity >= end, "ConcurrentArena: out of memory! (%s asked for %zu bytes)", src, size);
+  } while (!mem.compare_exchange_weak(cur, end, std::memory_order_relaxed));
+
+  ARENA_DEBUG_STMT(printf("ConcurrentArena: allocated region [%p, %p) for %s\n", aligned, end, src));
+  commit_until(end);
+
+  ASAN_UNPOISON_MEMORY_REGION(aligned, size);
+  return aligned;
+}
+
+EXPORT bool ConcurrentArena::try_resize(void* ptr, usize cur_size, usize new_size, const char* src) {
+  if (!owns(ptr)) {
+    return false;
+  }
+
+  u8* cur_end = (u8*)ptr + cur_size;
+  u8* new_end = (u8*)ptr + new_size;
+  if (new_end > base + capacity) {
+    return false;
+  }
+
+  // Only succeed if the allocation is still the last one, whoever wins the CAS owns the tail
+  if (!mem.compare_exchange_strong(cur_end, new_end, std::memory_order_relaxed)) {
+    return false;
+  }
+
+  if (new_size > cur_size) {
+    commit_until(new_end);
+    ASAN_UNPOISON_MEMORY_REGION((u8*)ptr + cur_size, new_size - cur_size);
+    memset((u8*)ptr + cur_size, 0, new_size - cur_size);
+  }
+  // Shrinking does not poison the memory: another thread may already have been handed it
+
+  return true;
+}
+
+EXPORT void ConcurrentArena::pop_pos(u64 old_pos) {
+  auto cur_pos = pos();
+  ASSERT(cur_pos >= old_pos);
+
+  u8* new_mem = base + old_pos;
+  mem.store(new_mem, std::memory_order_relaxed);
+  ASAN_POISON_MEMORY_REGION(new_mem, capacity - old_pos);
+
+  usize page_size   = arena_page_size();
+  u8* cur_committed = committed.load(std::memory_order_relaxed);
+  if (new_mem + page_size < cur_committed) {
+    u8* aligned = ALIGN_UP(new_mem, page_size);
+    usize size  = ALIGN_DOWN(usize(cur_committed - aligned), page_size);
+
+    os::mem_deallocate(aligned, size, os::MemDeallocationFlags::Decommit);
+    committed.store(aligned, std::memory_order_release);
+  }
+}
+
+EXPORT u64 ConcurrentArena::pos() {
+  return (u64)(mem.load(std::memory_order_relaxed) - base);
+}
+
+EXPORT ConcurrentArenaTemp ConcurrentArena::make_temp() {
+  return ConcurrentArenaTemp{
+      this,
+      pos(),
+  };
+}
+
+EXPORT ConcurrentArena& concurrent_arena_alloc(usize capacity) {
+  usize page_size        = arena_page_size();
+  const usize alloc_size = ALIGN_UP(sizeof(ConcurrentArena) + capacity, page_size);
+
+  u8* memory = (u8*)os::mem_allocate(nullptr, alloc_size, os::MemAllocationFlags::Reserve);
+  ARENA_DEBUG_STMT(printf("ConcurrentArena: got range [%p, %p)\n", memory, memory + alloc_size));
+  ASSERT(memory != nullptr);
+
+  os::mem_allocate(memory, page_size, os::MemAllocationFlags::Commit);
+
+  u8* base     = memory + sizeof(ConcurrentArena);
+  auto* arena_ = new (memory) ConcurrentArena{
+      .base      = base,
+      .mem       = base,
+      .committed = memory + page_size,
+      .capacity  = alloc_size - sizeof(ConcurrentArena),
+  };
+
+  ASAN_POISON_MEMORY_REGION(arena_->base, arena_->capacity);
+  return *arena_;
+}
+
+EXPORT void concurrent_arena_dealloc(ConcurrentArena& arena_) {
+  const usize alloc_size = sizeof(ConcurrentArena) + arena_.capacity;
+
+  ARENA_DEBUG_STMT(printf("ConcurrentArena: realeasing range [%p, %p)\n", &arena_, (u8*)&arena_ + alloc_size));
+  arena_.~ConcurrentArena();
+  os::mem_deallocate(&arena_, alloc_size, os::MemDeallocationFlags::Release);
+}
+
 // NOTES:
 // scratch_* are reentrant
 // The memory barrier part of the atomics are not needed (bc it's thread
@@ -172,80 +530,168 @@ EXPORT ArenaTemp Arena::make_temp() {
 //
 // I decided to remove all atomic access, it's easier and it wont be an issue
 
-thread_local bool scratch_init = false;
-thread_local Arena* scratch_storage[SCRATCH_ARENA_AMOUNT]{};
+// Arenas are only created when all the existing ones are in use (or conflict)
+struct scratch_pool {
+  Arena* arenas[SCRATCH_ARENA_AMOUNT];
+  // live scratches on each arena
+  u32 users[SCRATCH_ARENA_AMOUNT];
+  usize live_count;
+  ScratchStats stats;
+};
+thread_local scratch_pool scratch_pool_{};
 // This is not called, sometimes... it doesn't matter that much but it's annoying
 thread_local auto clear_arena_ = defer_builder + [] {
   SCRATCH_DEBUG_STMT(printf("Scratch: cleaning storage for thread %zu\n", sync::thread_id()));
   for (usize i = 0; i < SCRATCH_ARENA_AMOUNT; i++) {
-    if (scratch_storage[i] != nullptr) {
+    if (scratch_pool_.arenas[i] != nullptr) {
       SCRATCH_DEBUG_STMT(printf("Scratch: thread %zu is releasing scratch %zu\n", sync::thread_id(), i));
-      arena_dealloc(*scratch_storage[i]);
+      arena_dealloc(*scratch_pool_.arenas[i]);
+      scratch_pool_.arenas[i] = nullptr;
     }
   }
 };
 
+static Scratch scratch_acquire(usize idx) {
+  auto& pool = scratch_pool_;
+  if (pool.arenas[idx] == nullptr) {
+    SCRATCH_DEBUG_STMT(printf("Scratch: thread %zu, create scratch %zu\n", sync::thread_id(), idx));
+    pool.arenas[idx] = &arena_alloc(SCRATCH_ARENA_CAPACITY);
+    pool.stats.arena_count++;
+  }
+
+  Arena* arena = pool.arenas[idx];
+  SCRATCH_DEBUG_STMT(printf("Scratch: thread %zu, got scratch %zu at %p\n", sync::thread_id(), idx, arena->base));
+
+  pool.stats.get_count++;
+  pool.stats.shared_count += pool.users[idx] > 0;
+  pool.live_count++;
+  pool.stats.max_live_count = MAX(pool.stats.max_live_count, pool.live_count);
+  return {.arena_ = arena, .old_pos = arena->pos(), .depth = pool.users[idx]++};
+}
+
 EXPORT Scratch scratch_get() {
-  if (!scratch_init) {
-    scratch_init = true;
-    SCRATCH_DEBUG_STMT(printf("Scratch: initialize storage for thread %zu\n", sync::thread_id()));
-    for (usize i = 0; i < SCRATCH_ARENA_AMOUNT; i++) {
-      Arena* arena       = &arena_alloc();
-      scratch_storage[i] = arena;
+  for (usize i = 0; i < SCRATCH_ARENA_AMOUNT; i++) {
+    if (scratch_pool_.users[i] == 0) {
+      return scratch_acquire(i);
     }
   }
+  panic("no scratch arena available");
+}
 
+EXPORT Scratch scratch_get_avoiding(storage<const Allocator> conflicts) {
+  auto& pool       = scratch_pool_;
+  usize shared_idx = SCRATCH_ARENA_AMOUNT;
   for (usize i = 0; i < SCRATCH_ARENA_AMOUNT; i++) {
-    usize j      = SCRATCH_ARENA_AMOUNT - 1 - i;
-    Arena* arena = nullptr;
-    SWAP(scratch_storage[j], arena);
-
-    if (arena != nullptr) {
-      SCRATCH_DEBUG_STMT(printf("Scratch: thread %zu, got scratch %zu at %p\n", sync::thread_id(), j, arena->base));
+    Arena* arena = pool.arenas[i];
 
-      return {.arena_ = arena};
+    // through arena(): a tracked allocator of a scratch arena conflicts with it
+    bool conflicting = false;
+    for (auto& c : conflicts.iter()) {
+      conflicting |= arena != nullptr && c.arena() == arena;
+    }
+    if (conflicting) {
+      continue;
     }
+    if (pool.users[i] == 0) {
+      return scratch_acquire(i);
+    }
+    shared_idx = MIN(shared_idx, i);
+  }
+
+  // every free arena is a conflict, share one in use
+  if (shared_idx < SCRATCH_ARENA_AMOUNT) {
+    return scratch_acquire(shared_idx);
   }
   panic("no scratch arena available");
 }
 
+EXPORT ScratchStats scratch_stats() {
+  return scratch_pool_.stats;
+}
+
 EXPORT void Scratch::retire() {
   if (arena_ == nullptr)
     return;
 
-  Arena* arena = arena_;
-  arena_       = nullptr;
-  arena->pop_pos(0);
-
-  for (usize i = 0; i < SCRATCH_ARENA_AMOUNT; i++) {
-    if (scratch_storage[i] != nullptr) {
-      continue;
-    }
+  auto& pool = scratch_pool_;
+  usize idx  = 0;
+  while (idx < SCRATCH_ARENA_AMOUNT && pool.arenas[idx] != arena_) {
+    idx++;
+  }
+  ASSERTM(idx < SCRATCH_ARENA_AMOUNT, "not a scratch arena of this thread");
+  ASSERTM(pool.users[idx] == depth + 1, "scratches sharing an arena must be retired in reverse order");
+
+  SCRATCH_DEBUG_STMT(printf("Scratch: thread %zu, retire scratch %zu at %p\n", sync::thread_id(), idx, arena_->base));
+  pool.stats.peak_bytes = MAX(pool.stats.peak_bytes, arena_->pos());
+  arena_->pop_pos(old_pos);
+  pool.users[idx]--;
+  pool.live_count--;
+  arena_ = nullptr;
+}
 
-    SCRATCH_DEBUG_STMT(printf("Scratch: thread %zu, retire scratch %zu at %p\n", sync::thread_id(), i, arena_->base));
-    SWAP(scratch_storage[i], arena);
+static Arena* inflight_frame_arenas[FRAME_INFLIGHT_MAX]{};
+static u32 inflight_frame_id    = 0;
+static bool inflight_frame_open = false;
 
-    return;
+static Arena& inflight_frame_arena(u32 frame_id) {
+  ASSERTM(frame_id < FRAME_INFLIGHT_MAX, "frame %u is past FRAME_INFLIGHT_MAX", frame_id);
+  Arena*& arena = inflight_frame_arenas[frame_id];
+  if (arena == nullptr) {
+    arena = &arena_alloc();
+    track_arena(*arena, "FrameInflight");
   }
+  return *arena;
+}
+
+EXPORT void inflight_frame_begin(u32 frame_id) {
+  inflight_frame_arena(frame_id).reset();
+  inflight_frame_id   = frame_id;
+  inflight_frame_open = true;
+}
 
-  arena_dealloc(*arena);
+EXPORT void inflight_frame_end() {
+  inflight_frame_open = false;
 }
 
 EXPORT Arena& get_named_arena(ArenaName name) {
   switch (name) {
   case ArenaName::Frame: {
-    static Arena frame_arena = arena_alloc();
+    static Arena& frame_arena = [] -> Arena& {
+      Arena& arena = arena_alloc();
+      track_arena(arena, "Frame");
+      return arena;
+    }();
     return frame_arena;
   }
+  case ArenaName::FrameInflight:
+    // out of a frame, the allocation would go to an arena whose frame may be submitted already
+    ASSERTM(
+        inflight_frame_open, "the FrameInflight arena is only usable between inflight_frame_begin and inflight_frame_end"
+    );
+    return inflight_frame_arena(inflight_frame_id);
   }
 }
 
-EXPORT Allocator get_named_allocator(AllocatorName name) {
+static Allocator named_allocator(AllocatorName name) {
   switch (name) {
   case AllocatorName::General:
+#ifdef MEM_USE_MALLOC
     return {nullptr, &MallocVtable};
+#else
+    return {nullptr, &HeapVtable};
+#endif
   case AllocatorName::Frame:
     return get_named_arena(ArenaName::Frame);
+  case AllocatorName::FrameInflight:
+    return get_named_arena(ArenaName::FrameInflight);
+  }
+}
+
+EXPORT Allocator get_named_allocator(AllocatorName name) {
+  if (mem_tracking_enabled()) {
+    static const char* names[]{"General", "Frame", "FrameInflight"};
+    return tracked_allocator(named_allocator(name), names[(usize)name]);
   }
+  return named_allocator(name);
 }
 } // namespace core
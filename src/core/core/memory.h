@@ -4,16 +4,37 @@
 
 #include "fwd.h"
 #include "type_info.h"
+#include <atomic>
 #include <cstdlib>
 
 #ifndef SCRATCH_ARENA_AMOUNT
   #define SCRATCH_ARENA_AMOUNT 6
 #endif
 
+// Maximum number of frames in flight, there is one FrameInflight arena per frame
+#ifndef FRAME_INFLIGHT_MAX
+  #define FRAME_INFLIGHT_MAX 3
+#endif
+
+// Scratch arenas are chained, they start small
+#ifndef SCRATCH_ARENA_CAPACITY
+  #define SCRATCH_ARENA_CAPACITY MB(16zu)
+#endif
+
 #ifndef DEFAULT_ARENA_CAPACITY
   #define DEFAULT_ARENA_CAPACITY GB(1) // it's virtual memory, we have plenty
 #endif
 
+// Reservation of the first block of a chained arena, the next blocks are bigger
+#ifndef ARENA_BLOCK_CAPACITY
+  #define ARENA_BLOCK_CAPACITY MB(64zu)
+#endif
+
+// size of the virtual range reserved by the General heap
+#ifndef HEAP_CAPACITY
+  #define HEAP_CAPACITY GB(64zu) // it's virtual memory, we have plenty
+#endif
+
 #ifndef ALLOC_DEFAULT_ALIGNEMENT
   #define ALLOC_DEFAULT_ALIGNEMENT max_align
 #endif
@@ -25,6 +46,24 @@
   #define ARENA_PAGE_SIZE 0
 #endif // !ARENA_PAGE_SIZE
 
+// Default ArenaCommitPolicy
+// An arena commits at least ARENA_MIN_COMMIT bytes at once, then as much as it already has,
+// up to ARENA_MAX_COMMIT: committing is a syscall, doing it every page is slow
+#ifndef ARENA_MIN_COMMIT
+  #define ARENA_MIN_COMMIT KB(64zu)
+#endif // !ARENA_MIN_COMMIT
+#ifndef ARENA_MAX_COMMIT
+  #define ARENA_MAX_COMMIT MB(16zu)
+#endif // !ARENA_MAX_COMMIT
+// Popping keeps up to ARENA_RETAIN bytes committed past the bump pointer
+// What is above the peak usage is decommitted after ARENA_IDLE_RESETS resets that didn't need it
+#ifndef ARENA_RETAIN
+  #define ARENA_RETAIN MB(64zu)
+#endif // !ARENA_RETAIN
+#ifndef ARENA_IDLE_RESETS
+  #define ARENA_IDLE_RESETS 64
+#endif // !ARENA_IDLE_RESETS
+
 #if __has_feature(address_sanitizer) || defined(__SANITIZE_ADDRESS__)
   #include <sanitizer/asan_interface.h>
 
@@ -44,11 +83,16 @@ struct AllocatorVTable {
   using deallocate_pfn = void (*)(void*, void* alloc_base_ptr, usize size, const char* src);
   using try_resize_pfn = bool (*)(void*, void* alloc_base_ptr, usize cur_size, usize new_size, const char* src);
   using owns_pfn       = bool (*)(void*, void* alloc_base_ptr);
+  using arena_pfn      = Arena* (*)(void*);
 
   allocate_pfn allocate;
+  // the content of the allocation is undefined, for memory that is about to be overwritten anyway
+  allocate_pfn allocate_uninit;
   deallocate_pfn deallocate;
   try_resize_pfn try_resize;
   owns_pfn owns;
+  // the Arena the allocations end up in, through the wrappers, nullptr (or no function) if there is none
+  arena_pfn arena = nullptr;
 };
 
 struct Allocator {
@@ -82,6 +126,28 @@ struct Allocator {
     };
   }
 
+  inline void* allocate_uninit(usize size, usize alignement = ALLOC_DEFAULT_ALIGNEMENT, const char* src = "<unknown>") {
+    return vtable->allocate_uninit(userdata, size, alignement, src);
+  }
+  inline void* allocate_uninit(LayoutInfo layout, const char* src = "<unknown>") {
+    return vtable->allocate_uninit(userdata, layout.size, layout.alignement, src);
+  }
+  storage<u8> allocate_array_uninit(LayoutInfo layout, usize element_count, const char* src = "<unknown>") {
+    auto arr_layout = layout.array(element_count);
+    return {
+        arr_layout.size,
+        (u8*)allocate_uninit(arr_layout, src),
+    };
+  }
+  template <class T>
+  storage<T> allocate_array_uninit(usize element_count, const char* src = type_name<T>()) {
+    auto arr_layout = default_layout_of<T>().array(element_count);
+    return {
+        element_count,
+        (T*)allocate_uninit(arr_layout, src),
+    };
+  }
+
   inline void deallocate(void* alloc_base_ptr, usize size, const char* src = "<unknown>") {
     return vtable->deallocate(userdata, alloc_base_ptr, size, src);
   }
@@ -96,6 +162,38 @@ struct Allocator {
   inline bool owns(void* alloc_base_ptr) {
     return vtable->owns(userdata, alloc_base_ptr);
   }
+  inline Arena* arena() const {
+    return vtable->arena != nullptr ? vtable->arena(userdata) : nullptr;
+  }
+};
+
+struct ArenaCommitPolicy {
+  usize min_commit = ARENA_MIN_COMMIT;
+  usize max_commit = ARENA_MAX_COMMIT;
+  // transparent huge pages, commits are rounded to the huge page size
+  bool huge_pages = false;
+  // fault the pages in when they are committed, for arenas that are known to be hot
+  bool prefault = false;
+
+  usize retain    = ARENA_RETAIN;
+  u32 idle_resets = ARENA_IDLE_RESETS;
+
+  // reserve a new block when the arena is full instead of panicking
+  bool chained = true;
+};
+
+// INTERNAL
+// At the start of every chained block but the first one, the state of the block before it
+// The spare block of an arena holds its own state instead
+struct ArenaBlock {
+  u8* base;
+  u8* mem;
+  u8* committed;
+  usize capacity;
+  u8* zeroed;
+  u8* peak;
+  u64 base_pos;
+  ArenaBlock* block;
 };
 
 struct ArenaTemp;
@@ -104,8 +202,31 @@ struct Arena {
   u8* mem;
   u8* committed;
   usize capacity;
+  ArenaCommitPolicy policy;
+
+  // [zeroed, committed) has never been handed out since it was committed, it is still zero
+  u8* zeroed;
+
+  // incremented every time the arena goes back to pos 0
+  u32 reset_count;
+
+  // chained arenas: the current block, nullptr while in the block the arena header lives in
+  ArenaBlock* block;
+  // pos() of base
+  u64 base_pos;
+  // chained arenas: the last block popped, the next push_block takes it back
+  // released once policy.idle_resets resets did not need it
+  ArenaBlock* spare;
+  u32 spare_idle;
+
+  // highest mem since the last reset
+  u8* peak;
+  // highest peak of the resets that left committed memory unused
+  u8* idle_peak;
+  u32 idle_count;
 
   void* allocate(usize size, usize alignement, const char* src);
+  void* allocate_uninit(usize size, usize alignement, const char* src);
   bool try_resize(void* ptr, usize cur_size, usize new_size, const char* src = "<unknown>");
   void deallocate(void* ptr, usize size, const char* src = "<unknown>") {
     try_resize(ptr, size, 0, src);
@@ -116,6 +237,8 @@ struct Arena {
   void reset() {
     pop_pos(0);
   }
+  // Decommits what is not in use but one min_commit, whatever the policy says, and releases the spare block
+  void trim();
 
   operator Allocator() {
     return {this, &vtable};
@@ -127,19 +250,30 @@ struct Arena {
   u64 pos();
   void pop_pos(u64 pos);
   void deallocate(usize size);
+  // known_zero: the zeroed watermark, before the bump, of the block the allocation comes from
+  u8* bump(usize size, usize alignement, const char* src, u8*& known_zero);
+  void commit_until(u8* end);
+  void decommit_from(u8* keep);
+  void track_reset();
+  void push_block(usize size, usize alignement);
+  void pop_block();
+  void release_spare();
 };
 
 inline const AllocatorVTable Arena::vtable{
-    .allocate   = [](void* userdata, usize size, usize alignement, const char* src
+    .allocate        = [](void* userdata, usize size, usize alignement, const char* src
                 ) { return static_cast<Arena*>(userdata)->allocate(size, alignement, src); },
-    .deallocate = [](void* userdata, void* alloc_base_ptr, usize size, const char* src
+    .allocate_uninit = [](void* userdata, usize size, usize alignement, const char* src
+                       ) { return static_cast<Arena*>(userdata)->allocate_uninit(size, alignement, src); },
+    .deallocate      = [](void* userdata, void* alloc_base_ptr, usize size, const char* src
                   ) { return static_cast<Arena*>(userdata)->deallocate(alloc_base_ptr, size, src); },
-    .try_resize = [](void* userdata, void* ptr, usize cur_size, usize new_size, const char* src
+    .try_resize      = [](void* userdata, void* ptr, usize cur_size, usize new_size, const char* src
                   ) { return static_cast<Arena*>(userdata)->try_resize(ptr, cur_size, new_size, src); },
-    .owns       = [](void* userdata, void* ptr) { return static_cast<Arena*>(userdata)->owns(ptr); },
+    .owns            = [](void* userdata, void* ptr) { return static_cast<Arena*>(userdata)->owns(ptr); },
+    .arena           = [](void* userdata) { return static_cast<Arena*>(userdata); },
 };
 
-Arena& arena_alloc(usize capacity = DEFAULT_ARENA_CAPACITY);
+Arena& arena_alloc(usize capacity = ARENA_BLOCK_CAPACITY, ArenaCommitPolicy policy = {});
 void arena_dealloc(Arena& arena);
 
 struct ArenaTemp {
@@ -174,11 +308,114 @@ struct ArenaTemp {
   }
 };
 
+// An arena that can be shared between threads
+// allocate / try_resize / owns are lock-free: the bump pointer is advanced with a CAS and
+// commits race safely, each thread commits what it needs and the committed watermark only grows
+// pop_pos / reset / retiring a temp are NOT concurrent operations: the caller must make sure no
+// other thread allocates from the arena while rolling it back
+struct ConcurrentArenaTemp;
+struct ConcurrentArena {
+  u8* base;
+  std::atomic<u8*> mem;
+  std::atomic<u8*> committed;
+  usize capacity;
+
+  void* allocate(usize size, usize alignement, const char* src);
+  void* allocate_uninit(usize size, usize alignement, const char* src);
+  bool try_resize(void* ptr, usize cur_size, usize new_size, const char* src = "<unknown>");
+  void deallocate(void* ptr, usize size, const char* src = "<unknown>") {
+    try_resize(ptr, size, 0, src);
+  }
+  bool owns(void* ptr);
+
+  ConcurrentArenaTemp make_temp();
+  void reset() {
+    pop_pos(0);
+  }
+
+  operator Allocator() {
+    return {this, &vtable};
+  }
+
+  static const AllocatorVTable vtable;
+
+  // INTERNAL
+  u64 pos();
+  void pop_pos(u64 pos);
+  void commit_until(u8* end);
+};
+
+inline const AllocatorVTable ConcurrentArena::vtable{
+    .allocate        = [](void* userdata, usize size, usize alignement, const char* src
+                ) { return static_cast<ConcurrentArena*>(userdata)->allocate(size, alignement, src); },
+    .allocate_uninit = [](void* userdata, usize size, usize alignement, const char* src
+                       ) { return static_cast<ConcurrentArena*>(userdata)->allocate_uninit(size, alignement, src); },
+    .deallocate      = [](void* userdata, void* alloc_base_ptr, usize size, const char* src
+                  ) { return static_cast<ConcurrentArena*>(userdata)->deallocate(alloc_base_ptr, size, src); },
+    .try_resize      = [](void* userdata, void* ptr, usize cur_size, usize new_size, const char* src
+                  ) { return static_cast<ConcurrentArena*>(userdata)->try_resize(ptr, cur_size, new_size, src); },
+    .owns            = [](void* userdata, void* ptr) { return static_cast<ConcurrentArena*>(userdata)->owns(ptr); },
+};
+
+ConcurrentArena& concurrent_arena_alloc(usize capacity = DEFAULT_ARENA_CAPACITY);
+void concurrent_arena_dealloc(ConcurrentArena& arena);
+
+struct ConcurrentArenaTemp {
+  ConcurrentArena* arena_;
+  u64 old_pos;
+
+  inline void check() {
+    DEBUG_ASSERT(arena_ != nullptr);
+  }
+
+  void retire() {
+    if (arena_ != nullptr) {
+      arena_->pop_pos(old_pos);
+      arena_ = nullptr;
+    }
+  }
+
+  operator Allocator() {
+    check();
+    return *arena_;
+  }
+  ConcurrentArena* operator->() {
+    check();
+    return arena_;
+  }
+  ConcurrentArena& operator*() {
+    check();
+    return *arena_;
+  }
+  ~ConcurrentArenaTemp() {
+    retire();
+  }
+};
+
 struct Scratch;
+// Returns a scratch arena no other live scratch of this thread is using
 Scratch scratch_get();
+// Returns a scratch arena that is none of the conflicts, typically the allocator a result is built in
+// An unused arena is preferred, it is only shared with an enclosing scratch when every free arena is a conflict
+// Scratches sharing an arena must be retired in reverse order: retiring one frees everything allocated
+// on the arena since it was acquired, including what the enclosing scratch allocated meanwhile
+Scratch scratch_get_avoiding(storage<const Allocator> conflicts);
+
+// Per thread
+struct ScratchStats {
+  usize arena_count;    // scratch arenas created by this thread
+  usize get_count;      // scratches handed out
+  usize shared_count;   // ... that share their arena with an enclosing scratch
+  usize max_live_count; // most scratches alive at the same time
+  usize peak_bytes;     // biggest scratch arena position seen on retire
+};
+ScratchStats scratch_stats();
 
 struct Scratch {
   Arena* arena_;
+  u64 old_pos;
+  // scratches that were using the arena when it was handed out
+  u32 depth;
   inline void check() {
     DEBUG_ASSERT(arena_ != nullptr);
   }
@@ -200,6 +437,13 @@ struct Scratch {
   }
 };
 
+template <class... Conflicts>
+  requires(sizeof...(Conflicts) > 0)
+Scratch scratch_get(Conflicts&&... conflicts) {
+  const Allocator allocs[]{Allocator(conflicts)...};
+  return scratch_get_avoiding(allocs);
+}
+
 inline constexpr AllocatorVTable MallocVtable{
     .allocate =
         [](void*, usize size, usize alignement, const char* src) {
@@ -207,6 +451,12 @@ inline constexpr AllocatorVTable MallocVtable{
           ASSERT(mem);
           return mem;
         },
+    .allocate_uninit =
+        [](void*, usize size, usize alignement, const char* src) {
+          void* mem = malloc(size);
+          ASSERT(mem);
+          return mem;
+        },
     .deallocate = [](void* userdata, void* alloc_base_ptr, usize size, const char* src
                   ) { return free(alloc_base_ptr); },
     .try_resize =
@@ -220,16 +470,31 @@ inline constexpr AllocatorVTable MallocVtable{
     .owns = [](void* userdata, void* ptr) { return false; },
 };
 
+// Size class slab heap, see heap.cpp
+// deallocate and owns don't need the size, try_resize grows in place when it can
+EXPORT extern const AllocatorVTable HeapVtable;
+
 enum class AllocatorName {
   General,
+  // reset at the start of every CPU frame
   Frame,
+  // lives until the GPU is done with the frame, only between begin_frame and end_frame, see inflight_frame_begin
+  FrameInflight,
 };
 enum class ArenaName {
   Frame,
+  FrameInflight,
 };
 
 Allocator get_named_allocator(AllocatorName name);
 Arena& get_named_arena(ArenaName name);
 
+// Makes the FrameInflight arena of frame_id the current one and resets it
+// The caller must make sure that the previous frame that used frame_id is complete (its fence has signalled)
+// vk::begin_frame calls it once the image is acquired and vk::end_frame calls inflight_frame_end once the frame is
+// submitted: the FrameInflight arena can only be used in between, what runs earlier in the tick can not use it
+void inflight_frame_begin(u32 frame_id);
+void inflight_frame_end();
+
 } // namespace core
 #endif // INCLUDE_CORE_MEMORY_H_
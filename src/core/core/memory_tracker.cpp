@@ -0,0 +1,369 @@
+#include "memory_tracker.h"
+
+#include <core/containers/hash_map.h>
+#include <core/containers/vec.h>
+#include <core/core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+namespace core {
+namespace {
+
+// The tracking data must not be tracked itself
+const Allocator untracked{nullptr, &MallocVtable};
+
+struct live_allocation {
+  usize size;
+  u32 tag;
+  u32 reset_count;
+};
+
+struct tracker {
+  std::mutex lock;
+  const char* name;
+  Allocator inner;
+  // when inner is an arena, its allocations die on reset
+  Arena* arena;
+  u32 seen_reset_count;
+
+  usize live_bytes;
+  usize live_count;
+  usize high_water;
+  vec<MemTagStats> tags;
+  hash_map<const char*, u32> tag_by_ptr;
+  hash_map<void*, live_allocation> live;
+
+  u32 tag_of(const char* src) {
+    if (src == nullptr) {
+      src = "<unknown>";
+    }
+
+    if (auto it = tag_by_ptr.get(src); it.is_some()) {
+      return *it;
+    }
+
+    // The same tag can come from several translation units
+    u32 idx = 0;
+    for (; idx < tags.size(); idx++) {
+      if (strcmp(tags[idx].tag, src) == 0) {
+        break;
+      }
+    }
+    if (idx == tags.size()) {
+      tags.push(untracked, {.tag = src});
+    }
+
+    tag_by_ptr.insert(untracked, src, idx);
+    return idx;
+  }
+
+  void forget(const live_allocation& a) {
+    auto& tag       = tags[a.tag];
+    tag.live_bytes -= a.size;
+    tag.live_count--;
+    live_bytes -= a.size;
+    live_count--;
+  }
+
+  void purge_reset_allocations() {
+    if (arena == nullptr || arena->reset_count == seen_reset_count) {
+      return;
+    }
+
+    seen_reset_count = arena->reset_count;
+    live.remove_if([&](void*, const live_allocation& a) {
+      if (a.reset_count == seen_reset_count) {
+        return false;
+      }
+      forget(a);
+      return true;
+    });
+  }
+
+  void record(void* ptr, usize size, const char* src) {
+    if (ptr == nullptr) {
+      return;
+    }
+
+    std::lock_guard guard{lock};
+    purge_reset_allocations();
+
+    // the address has been reused, the previous allocation is dead
+    if (auto it = live.remove(ptr); it.is_some()) {
+      forget(*it);
+    }
+
+    u32 tag_idx = tag_of(src);
+    live.insert(untracked, ptr, {size, tag_idx, arena != nullptr ? arena->reset_count : 0});
+
+    auto& tag       = tags[tag_idx];
+    tag.live_bytes += size;
+    tag.live_count++;
+    tag.total_count++;
+    tag.high_water = MAX(tag.high_water, tag.live_bytes);
+
+    live_bytes += size;
+    live_count++;
+    high_water = MAX(high_water, live_bytes);
+  }
+
+  void resize(void* ptr, usize new_size) {
+    std::lock_guard guard{lock};
+    purge_reset_allocations();
+
+    auto it = live.get(ptr);
+    if (it.is_none()) {
+      return;
+    }
+    if (new_size == 0) {
+      forget(*it);
+      live.remove(ptr);
+      return;
+    }
+
+    auto& a        = *it;
+    auto& tag      = tags[a.tag];
+    tag.live_bytes = tag.live_bytes - a.size + new_size;
+    live_bytes     = live_bytes - a.size + new_size;
+    a.size         = new_size;
+
+    tag.high_water = MAX(tag.high_water, tag.live_bytes);
+    high_water     = MAX(high_water, live_bytes);
+  }
+
+  void clear() {
+    std::lock_guard guard{lock};
+    live.reset(untracked);
+    tag_by_ptr.reset(untracked);
+    tags.reset(untracked);
+    live_bytes = live_count = high_water = 0;
+  }
+};
+
+struct tracked_arena {
+  Arena* arena;
+  const char* name;
+};
+
+struct {
+#ifdef MEM_TRACKING
+  std::atomic<bool> enabled{true};
+#else
+  std::atomic<bool> enabled{false};
+#endif
+
+  // trackers are never destroyed, the tracked allocators that have been given out point to them
+  std::mutex lock;
+  tracker trackers[MEM_TRACKER_MAX];
+  usize tracker_count;
+  tracked_arena arenas[MEM_TRACKED_ARENA_MAX];
+} tracking;
+
+const AllocatorVTable tracked_vtable{
+    .allocate =
+        [](void* userdata, usize size, usize alignement, const char* src) {
+          auto& t   = *static_cast<tracker*>(userdata);
+          void* ptr = t.inner.allocate(size, alignement, src);
+          t.record(ptr, size, src);
+          return ptr;
+        },
+    .allocate_uninit =
+        [](void* userdata, usize size, usize alignement, const char* src) {
+          auto& t   = *static_cast<tracker*>(userdata);
+          void* ptr = t.inner.allocate_uninit(size, alignement, src);
+          t.record(ptr, size, src);
+          return ptr;
+        },
+    .deallocate =
+        [](void* userdata, void* alloc_base_ptr, usize size, const char* src) {
+          auto& t = *static_cast<tracker*>(userdata);
+          t.resize(alloc_base_ptr, 0);
+          t.inner.deallocate(alloc_base_ptr, size, src);
+        },
+    .try_resize =
+        [](void* userdata, void* ptr, usize cur_size, usize new_size, const char* src) {
+          auto& t = *static_cast<tracker*>(userdata);
+          if (!t.inner.try_resize(ptr, cur_size, new_size, src)) {
+            return false;
+          }
+          t.resize(ptr, new_size);
+          return true;
+        },
+    .owns  = [](void* userdata, void* ptr) { return static_cast<tracker*>(userdata)->inner.owns(ptr); },
+    .arena = [](void* userdata) { return static_cast<tracker*>(userdata)->inner.arena(); },
+};
+
+} // namespace
+
+EXPORT void mem_tracking_enable(bool enabled) {
+  if (tracking.enabled.exchange(enabled) == enabled || enabled) {
+    return;
+  }
+
+  // the numbers would drift from reality while disabled
+  std::lock_guard guard{tracking.lock};
+  for (usize i = 0; i < tracking.tracker_count; i++) {
+    tracking.trackers[i].clear();
+  }
+}
+
+EXPORT bool mem_tracking_enabled() {
+  return tracking.enabled.load(std::memory_order_relaxed);
+}
+
+EXPORT Allocator tracked_allocator(Allocator inner, const char* name) {
+  std::lock_guard guard{tracking.lock};
+  for (usize i = 0; i < tracking.tracker_count; i++) {
+    auto& t = tracking.trackers[i];
+    if (t.inner.userdata == inner.userdata && t.inner.vtable == inner.vtable) {
+      // a new arena at the address of an untracked one
+      if (inner.vtable == &Arena::vtable && t.arena == nullptr) {
+        t.arena            = static_cast<Arena*>(inner.userdata);
+        t.seen_reset_count = t.arena->reset_count;
+      }
+      return {&t, &tracked_vtable};
+    }
+  }
+
+  if (tracking.tracker_count == MEM_TRACKER_MAX) {
+    return inner;
+  }
+
+  auto& t = tracking.trackers[tracking.tracker_count++];
+  t.name  = name;
+  t.inner = inner;
+  if (inner.vtable == &Arena::vtable) {
+    t.arena            = static_cast<Arena*>(inner.userdata);
+    t.seen_reset_count = t.arena->reset_count;
+  }
+  return {&t, &tracked_vtable};
+}
+
+EXPORT void track_arena(Arena& arena, const char* name) {
+  std::lock_guard guard{tracking.lock};
+  for (auto& a : tracking.arenas) {
+    if (a.arena == nullptr) {
+      a = {&arena, name};
+      return;
+    }
+  }
+}
+
+EXPORT void untrack_arena(Arena& arena) {
+  std::lock_guard guard{tracking.lock};
+  for (auto& a : tracking.arenas) {
+    if (a.arena == &arena) {
+      a = {};
+    }
+  }
+
+  // the tracker stays, but it must not look at the arena anymore
+  for (usize i = 0; i < tracking.tracker_count; i++) {
+    auto& t = tracking.trackers[i];
+    if (t.arena == &arena) {
+      t.clear();
+      t.arena = nullptr;
+    }
+  }
+}
+
+EXPORT ArenaUsage arena_usage(Arena& arena, const char* name) {
+  ArenaUsage usage{
+      .name      = name,
+      .used      = arena.pos(),
+      .committed = usize(arena.committed - arena.base),
+      .reserved  = arena.capacity,
+      .blocks    = 1,
+  };
+  for (ArenaBlock* b = arena.block; b != nullptr; b = b->block) {
+    usage.committed += usize(b->committed - b->base);
+    usage.reserved  += b->capacity;
+    usage.blocks++;
+  }
+  if (arena.spare != nullptr) {
+    usage.committed += usize(arena.spare->committed - arena.spare->base);
+    usage.reserved  += arena.spare->capacity;
+  }
+  return usage;
+}
+
+EXPORT MemTrackingSnapshot mem_tracking_snapshot(Allocator alloc) {
+  std::lock_guard guard{tracking.lock};
+
+  MemTrackingSnapshot snapshot{};
+  snapshot.trackers = alloc.allocate_array<MemTrackerStats>(tracking.tracker_count);
+  for (auto [idx, stats] : enumerate{snapshot.trackers.iter()}) {
+    auto& t = tracking.trackers[idx];
+    std::lock_guard tracker_guard{t.lock};
+    t.purge_reset_allocations();
+
+    *stats = {
+        .name       = t.name,
+        .live_bytes = t.live_bytes,
+        .live_count = t.live_count,
+        .high_water = t.high_water,
+        .tags       = alloc.allocate_array<MemTagStats>(t.tags.size()),
+    };
+    memcpy(stats->tags.data, t.tags.data(), t.tags.size() * sizeof(MemTagStats));
+    std::sort(stats->tags.data, stats->tags.data + stats->tags.size, [](auto& a, auto& b) {
+      return a.live_bytes > b.live_bytes;
+    });
+  }
+
+  usize arena_count = 0;
+  for (auto& a : tracking.arenas) {
+    arena_count += a.arena != nullptr;
+  }
+  snapshot.arenas = alloc.allocate_array<ArenaUsage>(arena_count);
+  usize arena_idx = 0;
+  for (auto& a : tracking.arenas) {
+    if (a.arena != nullptr) {
+      snapshot.arenas[arena_idx++] = arena_usage(*a.arena, a.name);
+    }
+  }
+
+  return snapshot;
+}
+
+EXPORT void mem_tracking_dump(FILE* f) {
+  auto scratch  = scratch_get();
+  auto snapshot = mem_tracking_snapshot(*scratch);
+
+  fprintf(f, "=== arenas ===\n");
+  fprintf(f, "%-32s %14s %14s %14s %6s\n", "name", "used", "committed", "reserved", "blocks");
+  for (auto& a : snapshot.arenas.iter()) {
+    fprintf(f, "%-32s %14zu %14zu %14zu %6zu\n", a.name, a.used, a.committed, a.reserved, a.blocks);
+  }
+
+  for (auto& t : snapshot.trackers.iter()) {
+    fprintf(
+        f, "\n=== %s: %zu bytes live in %zu allocations, high water %zu bytes ===\n", t.name, t.live_bytes,
+        t.live_count, t.high_water
+    );
+    fprintf(f, "%-48s %14s %10s %14s %10s\n", "tag", "live bytes", "live", "high water", "total");
+    for (auto& tag : t.tags.iter()) {
+      fprintf(
+          f, "%-48s %14zu %10zu %14zu %10zu\n", tag.tag, tag.live_bytes, tag.live_count, tag.high_water,
+          tag.total_count
+      );
+    }
+  }
+}
+
+EXPORT bool mem_tracking_dump(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (f == nullptr) {
+    LOG_ERROR("can't open %s: %s", path, strerror(errno));
+    return false;
+  }
+  defer { fclose(f); };
+
+  mem_tracking_dump(f);
+  return true;
+}
+
+} // namespace core
@@ -0,0 +1,77 @@
+#ifndef INCLUDE_CORE_MEMORY_TRACKER_H_
+#define INCLUDE_CORE_MEMORY_TRACKER_H_
+
+#include "fwd.h"
+#include "memory.h"
+
+#include <cstdio>
+
+// Opt-in allocation tracking
+//
+// tracked_allocator wraps an Allocator and aggregates every allocation under its src tag:
+// live bytes, live allocations and high water marks, per tag and per tracked allocator
+// When tracking is enabled, get_named_allocator hands out tracked allocators
+//
+// Allocations of an arena die when the arena is reset, partial pops (temps) are not seen
+// Allocations made before the tracking was enabled are not known
+//
+// Define MEM_TRACKING to enable the tracking from the start
+
+#ifndef MEM_TRACKER_MAX
+  #define MEM_TRACKER_MAX 32
+#endif
+#ifndef MEM_TRACKED_ARENA_MAX
+  #define MEM_TRACKED_ARENA_MAX 32
+#endif
+
+namespace core {
+
+void mem_tracking_enable(bool enabled);
+bool mem_tracking_enabled();
+
+// Returns the same tracker for the same inner allocator, if there are too many trackers inner is returned
+Allocator tracked_allocator(Allocator inner, const char* name);
+
+// Arenas shown in the memory panel, arena_dealloc untracks them
+void track_arena(Arena& arena, const char* name);
+void untrack_arena(Arena& arena);
+
+struct MemTagStats {
+  const char* tag;
+  usize live_bytes;
+  usize live_count;
+  usize high_water;
+  usize total_count;
+};
+
+struct MemTrackerStats {
+  const char* name;
+  usize live_bytes;
+  usize live_count;
+  usize high_water;
+  storage<MemTagStats> tags;
+};
+
+struct ArenaUsage {
+  const char* name;
+  usize used;
+  usize committed;
+  usize reserved;
+  usize blocks;
+};
+ArenaUsage arena_usage(Arena& arena, const char* name = "<arena>");
+
+struct MemTrackingSnapshot {
+  storage<MemTrackerStats> trackers;
+  storage<ArenaUsage> arenas;
+};
+
+// tags are sorted by live bytes
+MemTrackingSnapshot mem_tracking_snapshot(Allocator alloc);
+
+void mem_tracking_dump(FILE* f);
+bool mem_tracking_dump(const char* path);
+
+} // namespace core
+
+#endif // INCLUDE_CORE_MEMORY_TRACKER_H_
@@ -0,0 +1,60 @@
+#include "parallel.h"
+#include "sched.h"
+
+#include <atomic>
+
+namespace core {
+namespace detail_ {
+
+namespace {
+// The chunks are claimed one at a time by whoever is free: the caller and one helper job per worker
+struct parallel_ctx {
+  void (*run_chunk)(void*, usize);
+  void* ctx;
+  usize chunk_count;
+  alignas(CACHE_LINE_SIZE) std::atomic<usize> next;
+};
+
+void drain(parallel_ctx& c) {
+  usize i;
+  while ((i = c.next.fetch_add(1, std::memory_order_relaxed)) < c.chunk_count) {
+    c.run_chunk(c.ctx, i);
+  }
+}
+
+TaskReturn helper(parallel_ctx* c, TaskQueue*) {
+  drain(*c);
+  return TaskReturn::Stop;
+}
+} // namespace
+
+EXPORT void parallel_run(usize chunk_count, void (*run_chunk)(void*, usize), void* ctx) {
+  auto* queue   = default_task_queue();
+  usize helpers = MIN(queue->worker_count(), chunk_count - 1);
+  if (helpers == 0) {
+    for (usize i = 0; i < chunk_count; i++) {
+      run_chunk(ctx, i);
+    }
+    return;
+  }
+
+  parallel_ctx c{run_chunk, ctx, chunk_count, {}};
+  c.next.store(0, std::memory_order_relaxed);
+
+  auto scratch          = scratch_get();
+  core::Allocator alloc = scratch;
+  Job* jobs             = alloc.allocate_array_uninit<Job>(helpers, "parallel_run").data;
+  JobCounter done;
+  for (usize i = 0; i < helpers; i++) {
+    new (&jobs[i]) Job;
+    jobs[i].init(Task::from(helper, &c, TaskAffinity::Worker, TaskPriority::FrameCritical), &done);
+    queue->launch(jobs[i]);
+  }
+
+  drain(c);
+  // the helpers that start now find nothing left, the ones still running finish their last chunk
+  queue->wait(done);
+}
+
+} // namespace detail_
+} // namespace core
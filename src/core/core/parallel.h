@@ -0,0 +1,160 @@
+#ifndef INCLUDE_CORE_PARALLEL_H_
+#define INCLUDE_CORE_PARALLEL_H_
+
+#include "base.h"
+#include "memory.h"
+
+#include <new>
+
+#ifndef CACHE_LINE_SIZE
+  #define CACHE_LINE_SIZE 64
+#endif
+
+namespace core {
+
+// === Data parallel loops ===
+//
+// The storage is split in chunks of about grain elements, run by the workers of the default task queue and by the
+// calling thread, which returns once every chunk is done
+// - the chunk boundaries are aligned on cache lines when sizeof(T) divides one (the grain is rounded up to a whole
+//   number of lines): two chunks never write to the same line
+// - every chunk gets a scratch arena of the thread running it, reset after the chunk
+// - a storage that fits in one chunk, or a queue without workers, runs inline on the calling thread
+// The chunks can run in any order and at the same time, fn must only write to its own chunk
+//
+//   core::parallel_for(vertices, 4096, [&](core::storage<Vertex> chunk, usize first, core::Arena& scratch) {
+//     for (usize i = 0; i < chunk.size; i++) { chunk[i] = unpack(first + i); }
+//   });
+
+namespace detail_ {
+// Runs run_chunk(ctx, i) for every i in [0, chunk_count)
+void parallel_run(usize chunk_count, void (*run_chunk)(void*, usize), void* ctx);
+
+template <class T>
+struct parallel_chunks {
+  usize size;
+  usize head; // the elements before the first cache line boundary, they go in the first chunk
+  usize grain;
+  usize count;
+
+  parallel_chunks(storage<T> data, usize grain_)
+      : size(data.size)
+      , head(0)
+      , grain(MAX(grain_, 1zu)) {
+    if constexpr (CACHE_LINE_SIZE % sizeof(T) == 0) {
+      constexpr usize PER_LINE = CACHE_LINE_SIZE / sizeof(T);
+      uptr addr                = (uptr)data.data;
+      grain                    = ALIGN_UP(grain, PER_LINE);
+      if (addr % sizeof(T) == 0) {
+        head = MIN(size, (ALIGN_UP(addr, (uptr)CACHE_LINE_SIZE) - addr) / sizeof(T));
+      }
+    }
+    count = size > head ? (size - head + grain - 1) / grain : 1;
+  }
+
+  usize begin(usize i) const {
+    return i == 0 ? 0 : head + i * grain;
+  }
+  usize end(usize i) const {
+    return MIN(size, head + (i + 1) * grain);
+  }
+  storage<T> chunk(storage<T> data, usize i) const {
+    return {end(i) - begin(i), data.data + begin(i)};
+  }
+};
+
+template <class F>
+void parallel_run(usize chunk_count, F& f) {
+  if (chunk_count == 1) {
+    return f(0);
+  }
+  parallel_run(chunk_count, [](void* ctx, usize i) { (*(F*)ctx)(i); }, (void*)&f);
+}
+} // namespace detail_
+
+// fn(storage<T> chunk, usize first, Arena& scratch), first is the index of chunk[0] in data
+template <class T, class F>
+void parallel_for(storage<T> data, usize grain, F&& fn) {
+  detail_::parallel_chunks<T> chunks{data, grain};
+  auto run = [&](usize i) {
+    auto scratch = scratch_get();
+    fn(chunks.chunk(data, i), chunks.begin(i), *scratch);
+  };
+  detail_::parallel_run(chunks.count, run);
+}
+
+// fn(storage<T> chunk, usize first, Arena& scratch) reduces a chunk, the results are combined in order:
+// combine(combine(combine(init, r0), r1), r2)...
+// The result does not depend on the number of workers, only on the grain
+template <class T, class R, class F, class C>
+R parallel_reduce(storage<T> data, usize grain, R init, F&& fn, C&& combine) {
+  detail_::parallel_chunks<T> chunks{data, grain};
+  auto scratch          = scratch_get();
+  core::Allocator alloc = scratch;
+  R* partial            = alloc.allocate_array_uninit<R>(chunks.count, "parallel_reduce").data;
+
+  auto run = [&](usize i) {
+    auto chunk_scratch = scratch_get();
+    new (&partial[i]) R(fn(chunks.chunk(data, i), chunks.begin(i), *chunk_scratch));
+  };
+  detail_::parallel_run(chunks.count, run);
+
+  R result = init;
+  for (usize i = 0; i < chunks.count; i++) {
+    result = combine(result, partial[i]);
+    partial[i].~R();
+  }
+  return result;
+}
+
+// Inclusive scan: out[i] = op(...op(op(identity, in[0]), in[1])..., in[i]), op must be associative
+// in and out may be the same storage
+// Two parallel passes: the sum of every chunk, then the scan of every chunk from the sum of the chunks before it
+template <class T, class Op>
+void parallel_scan(storage<const T> in, storage<T> out, usize grain, T identity, Op&& op) {
+  ASSERTM(in.size == out.size, "parallel_scan: %zu inputs for %zu outputs", in.size, out.size);
+  detail_::parallel_chunks<T> chunks{out, grain};
+  auto scan_chunk = [&](usize i, T acc) {
+    for (usize j = chunks.begin(i); j < chunks.end(i); j++) {
+      acc    = op(acc, in[j]);
+      out[j] = acc;
+    }
+  };
+  if (chunks.count == 1) {
+    return scan_chunk(0, identity);
+  }
+
+  auto scratch          = scratch_get();
+  core::Allocator alloc = scratch;
+  T* sums               = alloc.allocate_array_uninit<T>(chunks.count, "parallel_scan").data;
+
+  // the last chunk is not needed by anyone
+  auto reduce = [&](usize i) {
+    T acc = identity;
+    for (usize j = chunks.begin(i); j < chunks.end(i); j++) {
+      acc = op(acc, in[j]);
+    }
+    sums[i] = acc;
+  };
+  detail_::parallel_run(chunks.count - 1, reduce);
+
+  // exclusive prefix of the sums, serial: there are few chunks
+  T acc = identity;
+  for (usize i = 0; i < chunks.count; i++) {
+    T sum   = i + 1 < chunks.count ? sums[i] : identity;
+    sums[i] = acc;
+    acc     = op(acc, sum);
+  }
+
+  auto scan = [&](usize i) { scan_chunk(i, sums[i]); };
+  detail_::parallel_run(chunks.count, scan);
+}
+
+template <class T, class Op>
+void parallel_scan(storage<T> data, usize grain, T identity, Op&& op) {
+  parallel_scan(storage<const T>{data.size, data.data}, data, grain, identity, FWD(op));
+}
+
+} // namespace core
+
+#endif // INCLUDE_CORE_PARALLEL_H_
@@ -1,9 +1,478 @@
 #include "sched.h"
+#include <core/containers/deque.h>
+#include <core/containers/sync.h>
+#include <core/core.h>
+#include <core/os/time.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifndef JOB_INJECTOR_CAPACITY
+  #define JOB_INJECTOR_CAPACITY 4096
+#endif
+#ifndef JOB_DEQUE_CAPACITY
+  #define JOB_DEQUE_CAPACITY 256
+#endif
 
 namespace core {
-static TaskQueue default_task_queue_;
+
+struct JobSystem {
+  struct worker {
+    sync::ws_deque<Task*> deque;
+    std::thread thread;
+  };
+
+  TaskQueue* queue;
+  worker* workers;
+  // published once the workers are set up, read by any thread that submits or helps
+  std::atomic<usize> worker_count;
+
+  // submissions from threads that are not workers
+  sync::mpmc_queue<Task*> injector;
+
+  // tasks in the deques and the injector
+  std::atomic<usize> pending;
+  std::atomic<usize> sleeping;
+  std::atomic<bool> stopping;
+  std::mutex park_lock;
+  std::condition_variable park_cv;
+
+  // worker tasks for the next run: the ones that yielded, or that did not fit in the injector, or that were submitted
+  // while there were no workers
+  std::mutex retry_lock;
+  deque<Task*> retry;
+  // Main jobs that are ready, run by run and wait, also under retry_lock
+  deque<Task*> main_ready;
+};
+
+static thread_local JobSystem* current_jobs = nullptr;
+static thread_local usize current_worker    = 0;
+
+EXPORT TaskQueue::TaskQueue() {
+  jobs        = new (get_named_allocator(AllocatorName::General).allocate<JobSystem>()) JobSystem{};
+  jobs->queue = this;
+  jobs->injector.init(get_named_allocator(AllocatorName::General), JOB_INJECTOR_CAPACITY);
+}
+
+static void push_retry(JobSystem& js, Task* task) {
+  std::lock_guard lock(js.retry_lock);
+  js.retry.push_back(get_named_allocator(AllocatorName::General), task);
+}
+
+static Maybe<Task*> pop_retry(JobSystem& js) {
+  std::lock_guard lock(js.retry_lock);
+  if (js.retry.size() == 0) {
+    return {};
+  }
+  return js.retry.pop_front();
+}
+
+// Own deque, then the injector, then the other workers
+static Maybe<Task*> find_task(JobSystem& js) {
+  Maybe<Task*> task;
+  bool is_worker     = current_jobs == &js;
+  usize worker_count = js.worker_count.load(std::memory_order_acquire);
+  if (is_worker) {
+    task = js.workers[current_worker].deque.pop();
+  }
+  if (task.is_none()) {
+    task = js.injector.try_pop();
+  }
+  for (usize i = 0; i < worker_count && task.is_none(); i++) {
+    usize victim = (current_worker + 1 + i) % worker_count;
+    if (!is_worker || victim != current_worker) {
+      task = js.workers[victim].deque.steal();
+    }
+  }
+
+  if (task.is_some()) {
+    js.pending.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return task;
+}
+
+static TaskReturn run_job(Job* job, TaskQueue* queue) {
+  auto ret = job->task.run(queue);
+  if (ret == TaskReturn::Stop) {
+    job->task.status.store(TaskStatus::Stopped, std::memory_order_release);
+  }
+  return ret;
+}
+
+// The job may be deallocated as soon as done reaches 0
+static void finish_job(Job* job) {
+  JobCounter* signal = job->signal;
+  job->done.decrement();
+  if (signal != nullptr) {
+    signal->decrement();
+  }
+}
+
+// A yielding task goes to requeue
+static void run_task(JobSystem& js, Task* task, deque<Task*>& requeue) {
+  auto ret = task->run(js.queue);
+  if (ret == TaskReturn::Yield) {
+    std::lock_guard lock(js.retry_lock);
+    requeue.push_back(get_named_allocator(AllocatorName::General), task);
+    return;
+  }
+
+  // the task may be deallocated as soon as it is Stopped, except the runner of a job: its job owns it
+  Job* job = task->func == task_func<>(static_cast<task_func<Job>>(run_job)) ? (Job*)task->data : nullptr;
+  task->status.store(TaskStatus::Stopped, std::memory_order_release);
+  if (job != nullptr) {
+    finish_job(job);
+  }
+}
+
+static bool run_main_job(JobSystem& js) {
+  Task* task;
+  {
+    std::lock_guard lock(js.retry_lock);
+    if (js.main_ready.size() == 0) {
+      return false;
+    }
+    task = js.main_ready.pop_front();
+  }
+  run_task(js, task, js.main_ready);
+  return true;
+}
+
+static void worker_main(JobSystem* js, usize worker_idx) {
+  current_jobs   = js;
+  current_worker = worker_idx;
+
+  while (!js->stopping.load(std::memory_order_relaxed)) {
+    if (auto task = find_task(*js); task.is_some()) {
+      run_task(*js, *task, js->retry);
+      continue;
+    }
+
+    // a submitter bumps pending before it reads sleeping, a worker bumps sleeping before it reads pending:
+    // one of them sees the other and the task is not left behind a parked worker
+    std::unique_lock lock(js->park_lock);
+    js->sleeping.fetch_add(1, std::memory_order_seq_cst);
+    js->park_cv.wait(lock, [&] {
+      return js->pending.load(std::memory_order_seq_cst) > 0 || js->stopping.load(std::memory_order_relaxed);
+    });
+    js->sleeping.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  current_jobs = nullptr;
+}
+
+EXPORT Task* TaskQueue::spawn(Task task) {
+  Task* t = allocate_job();
+  *t      = task;
+  if (task.affinity == TaskAffinity::Worker) {
+    submit(t);
+  }
+  return t;
+}
+
+EXPORT void TaskQueue::submit(Task* task) {
+  auto& js = *jobs;
+  if (js.worker_count.load(std::memory_order_acquire) == 0) {
+    push_retry(js, task);
+    return;
+  }
+
+  js.pending.fetch_add(1, std::memory_order_seq_cst);
+  if (current_jobs == &js) {
+    js.workers[current_worker].deque.push(task);
+  } else if (!js.injector.try_push(task)) {
+    js.pending.fetch_sub(1, std::memory_order_relaxed);
+    push_retry(js, task);
+    return;
+  }
+
+  if (js.sleeping.load(std::memory_order_seq_cst) > 0) {
+    std::lock_guard lock(js.park_lock);
+    js.park_cv.notify_one();
+  }
+}
+
+EXPORT void TaskQueue::start_workers(usize worker_count) {
+  auto& js = *jobs;
+  ASSERTM(js.worker_count.load(std::memory_order_relaxed) == 0, "workers already started");
+  if (worker_count == 0) {
+    worker_count = MAX(1zu, (usize)std::thread::hardware_concurrency() - 1);
+  }
+
+  auto alloc = get_named_allocator(AllocatorName::General);
+  js.workers = (JobSystem::worker*)alloc.allocate(
+      worker_count * sizeof(JobSystem::worker), alignof(JobSystem::worker), "job workers"
+  );
+  for (usize i = 0; i < worker_count; i++) {
+    new (&js.workers[i]) JobSystem::worker{};
+    js.workers[i].deque.init(alloc, JOB_DEQUE_CAPACITY);
+  }
+  js.stopping.store(false, std::memory_order_relaxed);
+  js.worker_count.store(worker_count, std::memory_order_release);
+  for (usize i = 0; i < worker_count; i++) {
+    js.workers[i].thread = std::thread(worker_main, &js, i);
+  }
+  LOG_INFO("job system: %zu workers", worker_count);
+}
+
+EXPORT void TaskQueue::stop_workers() {
+  auto& js           = *jobs;
+  usize worker_count = js.worker_count.load(std::memory_order_relaxed);
+  if (worker_count == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard lock(js.park_lock);
+    js.stopping.store(true, std::memory_order_relaxed);
+  }
+  js.park_cv.notify_all();
+  for (usize i = 0; i < worker_count; i++) {
+    js.workers[i].thread.join();
+  }
+  // submissions from now on wait for the next run
+  js.worker_count.store(0, std::memory_order_release);
+
+  // the tasks that were still queued wait for the next run
+  for (auto task = js.injector.try_pop(); task.is_some(); task = js.injector.try_pop()) {
+    push_retry(js, *task);
+  }
+  auto alloc = get_named_allocator(AllocatorName::General);
+  for (usize i = 0; i < worker_count; i++) {
+    auto& w = js.workers[i];
+    for (auto task = w.deque.steal(); task.is_some(); task = w.deque.steal()) {
+      push_retry(js, *task);
+    }
+    w.deque.deallocate();
+    w.~worker();
+  }
+  alloc.deallocate(js.workers, worker_count * sizeof(JobSystem::worker), "job workers");
+  js.workers = nullptr;
+  js.pending.store(0, std::memory_order_relaxed);
+}
+
+EXPORT usize TaskQueue::worker_count() const {
+  return jobs->worker_count.load(std::memory_order_acquire);
+}
+
+EXPORT bool TaskQueue::help() {
+  auto& js = *jobs;
+
+  auto task = js.worker_count.load(std::memory_order_acquire) > 0 ? find_task(js) : pop_retry(js);
+  if (task.is_none()) {
+    return false;
+  }
+  run_task(js, *task, js.retry);
+  return true;
+}
+
+namespace {
+// The time a run started and its budget, Background tasks are started while it lasts
+struct run_clock {
+  u64 start;
+  u64 budget_ns;
+  u64 background_ns = 0;
+  u32 deferred      = 0;
+
+  u64 elapsed() const {
+    return os::time_monotonic().ns - start;
+  }
+
+  // Runs f now if task is not Background or if there is budget left, returns false if it has been deferred
+  bool run(Task& task, auto&& f) {
+    if (task.priority != TaskPriority::Background) {
+      f();
+      return true;
+    }
+
+    u64 before = elapsed();
+    if (before >= budget_ns) {
+      deferred++;
+      return false;
+    }
+    f();
+    background_ns += elapsed() - before;
+    return true;
+  }
+};
+} // namespace
+
+EXPORT void TaskQueue::run(u64 budget_ns) {
+  run_clock clock{os::time_monotonic().ns, budget_ns};
+
+  auto run_pool_task = [&](Task& task) {
+    switch (task.run(this)) {
+    case TaskReturn::Stop:
+      task.status.store(TaskStatus::Stopped, std::memory_order_release);
+      break;
+    case TaskReturn::Yield:
+      break;
+    }
+  };
+  // the workers write the status of the Worker tasks, they are not run from the pool
+  auto runnable = [](Task& task) {
+    return task.affinity == TaskAffinity::Main && task.status.load(std::memory_order_relaxed) == TaskStatus::Active;
+  };
+
+  for (auto priority : {TaskPriority::FrameCritical, TaskPriority::Interactive}) {
+    for (auto& task : tasks.iter()) {
+      if (runnable(task) && task.priority == priority) {
+        run_pool_task(task);
+      }
+    }
+  }
+
+  // Background tasks from the first one the last run deferred, round robin
+  auto background = [&](Task& task) {
+    return runnable(task) && task.priority == TaskPriority::Background;
+  };
+  usize background_count = 0;
+  for (auto& task : tasks.iter()) {
+    background_count += background(task);
+  }
+  usize start       = background_count > 0 ? background_cursor % background_count : 0;
+  background_cursor = 0;
+  for (bool wrapped : {false, true}) {
+    usize idx = 0;
+    for (auto& task : tasks.iter()) {
+      if (!background(task)) {
+        continue;
+      }
+      usize i = idx++;
+      if (wrapped != (i < start)) {
+        continue;
+      }
+      if (!clock.run(task, [&] { run_pool_task(task); }) && clock.deferred == 1) {
+        background_cursor = i;
+      }
+    }
+  }
+
+  // The worker tasks of the last tick, the ones that yield again are queued after them for the next tick
+  usize count;
+  {
+    std::lock_guard lock(jobs->retry_lock);
+    count = jobs->retry.size();
+  }
+  for (usize i = 0; i < count; i++) {
+    auto task = pop_retry(*jobs);
+    if (task.is_none()) {
+      break;
+    }
+
+    if (jobs->worker_count.load(std::memory_order_acquire) != 0) {
+      submit(*task);
+    } else if (!clock.run(**task, [&] { run_task(*jobs, *task, jobs->retry); })) {
+      push_retry(*jobs, *task);
+    }
+  }
+
+  // Same for the Main jobs
+  {
+    std::lock_guard lock(jobs->retry_lock);
+    count = jobs->main_ready.size();
+  }
+  for (usize i = 0; i < count; i++) {
+    Task* task;
+    {
+      std::lock_guard lock(jobs->retry_lock);
+      if (jobs->main_ready.size() == 0) {
+        break;
+      }
+      task = jobs->main_ready.pop_front();
+    }
+    if (!clock.run(*task, [&] { run_task(*jobs, task, jobs->main_ready); })) {
+      std::lock_guard lock(jobs->retry_lock);
+      jobs->main_ready.push_back(get_named_allocator(AllocatorName::General), task);
+    }
+  }
+
+  last_run = {clock.elapsed(), clock.background_ns, clock.deferred};
+}
+
+EXPORT void TaskQueue::launch(Job& job) {
+  job.queue = this;
+  job.dependency_done();
+}
+
+EXPORT void TaskQueue::wait(JobCounter& counter) {
+  bool on_worker = current_jobs == jobs;
+  while (!counter.is_zero()) {
+    if (help()) {
+      continue;
+    }
+    if (!on_worker && run_main_job(*jobs)) {
+      continue;
+    }
+    std::this_thread::yield();
+  }
+}
+
+EXPORT void JobCounter::decrement() {
+  usize prev = value.fetch_sub(1, std::memory_order_acq_rel);
+  ASSERTM(prev > 0, "JobCounter decremented past 0");
+  if (prev != 1) {
+    return;
+  }
+
+  JobLink* link = waiters.exchange(closed(), std::memory_order_acq_rel);
+  while (link != nullptr) {
+    // the link lives in its job, that may be gone once launched
+    JobLink* next = link->next;
+    link->job->dependency_done();
+    link = next;
+  }
+}
+
+EXPORT void Job::init(Task task_, JobCounter* signal_) {
+  task       = task_;
+  signal     = signal_;
+  pending    = 1; // released by the launch
+  link_count = 0;
+  runner     = Task::from(run_job, this, task.affinity, task.priority);
+  queue      = nullptr;
+  done.add(1);
+  if (signal != nullptr) {
+    signal->add(1);
+  }
+}
+
+EXPORT void Job::depends_on(JobCounter& counter) {
+  ASSERTM(link_count < JOB_MAX_DEPENDENCIES, "a job has at most %d dependencies", JOB_MAX_DEPENDENCIES);
+  pending.fetch_add(1, std::memory_order_relaxed);
+
+  JobLink* link = &links[link_count++];
+  link->job     = this;
+  JobLink* head = counter.waiters.load(std::memory_order_acquire);
+  do {
+    if (head == JobCounter::closed()) {
+      // already at 0
+      pending.fetch_sub(1, std::memory_order_relaxed);
+      return;
+    }
+    link->next = head;
+  } while (!counter.waiters.compare_exchange_weak(head, link, std::memory_order_acq_rel, std::memory_order_acquire));
+}
+
+EXPORT void Job::dependency_done() {
+  if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  if (task.affinity == TaskAffinity::Worker) {
+    queue->submit(&runner);
+  } else {
+    auto& js = *queue->jobs;
+    std::lock_guard lock(js.retry_lock);
+    js.main_ready.push_back(get_named_allocator(AllocatorName::General), &runner);
+  }
+}
 
 EXPORT TaskQueue* default_task_queue() {
+  // on first use, the job system allocates from General
+  static TaskQueue default_task_queue_;
   return &default_task_queue_;
 }
 } // namespace core
@@ -1,61 +1,212 @@
 #ifndef INCLUDE_CORE_SCHED_H_
 #define INCLUDE_CORE_SCHED_H_
 
+#include <atomic>
 #include <concepts>
 #include <core/containers/pool.h>
 #include <core/core/memory.h>
 
+#ifndef JOB_MAX_DEPENDENCIES
+  #define JOB_MAX_DEPENDENCIES 8
+#endif
+#define TASK_NO_BUDGET (~0ull)
+
 namespace core {
 struct TaskQueue;
+struct JobSystem;
+struct Job;
 
 enum class TaskReturn { Yield, Stop };
 enum class TaskStatus { Active, Stopped };
+// Main tasks are run by TaskQueue::run on the main thread
+// Worker tasks are run by the workers of the queue, or by TaskQueue::run when it has none
+enum class TaskAffinity { Main, Worker };
+// On the main thread, FrameCritical tasks run first then the Interactive ones, every tick
+// Background tasks run after them while the budget of the tick lasts, the ones left for the next tick go first then
+// Workers do not look at priorities
+enum class TaskPriority : u8 { FrameCritical, Interactive, Background };
 
 template <class Data = void>
 using task_func = TaskReturn (*)(Data*, TaskQueue*);
 
 struct Task {
-  TaskStatus status;
-  void* data;
-  task_func<> func;
+  // Written by the thread that runs the task, can be read from any thread
+  std::atomic<TaskStatus> status{TaskStatus::Active};
+  void* data            = nullptr;
+  task_func<> func      = nullptr;
+  TaskAffinity affinity = TaskAffinity::Main;
+  TaskPriority priority = TaskPriority::Interactive;
+
+  Task() = default;
+  Task(TaskStatus status, void* data, task_func<> func, TaskAffinity affinity, TaskPriority priority)
+      : status(status)
+      , data(data)
+      , func(func)
+      , affinity(affinity)
+      , priority(priority) {}
+  // Tasks are copied before they are submitted, nothing runs them yet
+  Task(const Task& other)
+      : Task(other.status.load(std::memory_order_relaxed), other.data, other.func, other.affinity, other.priority) {}
+  Task& operator=(const Task& other) {
+    status.store(other.status.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    data     = other.data;
+    func     = other.func;
+    affinity = other.affinity;
+    priority = other.priority;
+    return *this;
+  }
 
   TaskReturn run(TaskQueue* queue) {
     return (*func)(data, queue);
   }
 
   template <class Data = void, std::convertible_to<task_func<Data>> F>
-  static Task from(F f, Data* data = nullptr) {
+  static Task from(
+      F f,
+      Data* data            = nullptr,
+      TaskAffinity affinity = TaskAffinity::Main,
+      TaskPriority priority = TaskPriority::Interactive
+  ) {
     return Task{
         TaskStatus::Active,
         (void*)data,
         task_func<>(static_cast<task_func<Data>>(f)),
+        affinity,
+        priority,
     };
   }
 };
 
+// === Job graph ===
+//
+// A job is a task that runs once its dependencies are done, a dependency is a counter reaching 0
+// Every job has a done counter, so a job can depend on another one, and may signal a shared counter for fan-in:
+//   parse.init(parse_task);
+//   decode.init(decode_task, &all_done);  decode.depends_on(parse.done);
+//   convert.init(convert_task, &all_done); convert.depends_on(parse.done);
+//   upload.init(upload_task);             upload.depends_on(all_done);
+//   queue.launch(parse); queue.launch(decode); queue.launch(convert); queue.launch(upload);
+// A job whose counters reached 0 is submitted right away, nothing polls them
+// The job runs until its task returns Stop, then it decrements its counters and launches the jobs waiting on them
+
+struct JobLink {
+  Job* job;
+  JobLink* next;
+};
+
+struct JobCounter {
+  std::atomic<usize> value{};
+  // The jobs waiting for 0, closed once it is reached
+  std::atomic<JobLink*> waiters{closed()};
+
+  // Must happen before the jobs decrementing it are launched
+  // A counter at 0 can be reused by adding to it again, once nothing decrements it anymore
+  void add(usize n) {
+    JobLink* expected = closed();
+    waiters.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+    value.fetch_add(n, std::memory_order_acq_rel);
+  }
+  // Launches the waiting jobs when it reaches 0
+  void decrement();
+  // Closed once the last decrement is done with the counter, it can be destroyed then
+  bool is_zero() const {
+    return waiters.load(std::memory_order_acquire) == closed();
+  }
+
+  static JobLink* closed() {
+    return reinterpret_cast<JobLink*>(uptr(1));
+  }
+};
+
+// Owned by the caller, it must stay alive until done reaches 0
+struct Job {
+  Task task;
+  JobCounter done;
+  JobCounter* signal;
+
+  // INTERNAL
+  std::atomic<u32> pending;
+  u32 link_count;
+  JobLink links[JOB_MAX_DEPENDENCIES];
+  Task runner;
+  TaskQueue* queue;
+
+  // signal is decremented along with done, when the task stops
+  void init(Task task, JobCounter* signal = nullptr);
+  // Before the launch, at most JOB_MAX_DEPENDENCIES times
+  void depends_on(JobCounter& counter);
+
+  // INTERNAL
+  void dependency_done();
+};
+
+struct TaskRunStats {
+  u64 elapsed_ns;
+  u64 background_ns;
+  // Background tasks left for the next tick
+  u32 deferred;
+};
+
+// Tasks are run once per tick (a call to run) until they return Stop
+//
+// Worker tasks go through a work stealing job system when start_workers has been called:
+// - every worker owns a Chase-Lev deque, a task submitted from a worker goes to the bottom of its deque,
+//   a task submitted from another thread goes through a shared injector queue
+// - an idle worker pops its own deque, then the injector, then steals from the others, then parks
+// - a worker task that yields is submitted again by the next run, it is not spun on
+// - the worker that stops a task does not touch it anymore, the task can be deallocated once its status is Stopped
 struct TaskQueue {
   core::pool<Task> tasks;
+  // Created with the queue, any thread may submit to it before the workers are started
+  JobSystem* jobs = nullptr;
 
+  // What is left until the next frame for the ticks in between, the app sets it once per frame
+  u64 frame_budget_ns = TASK_NO_BUDGET;
+  TaskRunStats last_run{};
+  // INTERNAL: the Background task the last run stopped at, counted in pool order
+  usize background_cursor = 0;
+
+  TaskQueue();
+
+  // Called from the main thread
   Task* allocate_job() {
-    return &tasks.allocate(core::get_named_allocator(core::AllocatorName::General));
+    return new (&tasks.allocate(core::get_named_allocator(core::AllocatorName::General))) Task{};
   }
+  // A worker task must be stopped before it is deallocated
   void deallocate_job(Task* task) {
     return tasks.deallocate(core::get_named_allocator(core::AllocatorName::General), *task);
   }
 
-  void run() {
-    for (auto& task : tasks.iter()) {
-      if (task.status != TaskStatus::Active)
-        continue;
-
-      switch (task.run(this)) {
-      case TaskReturn::Stop:
-        task.status = TaskStatus::Stopped;
-        break;
-      case TaskReturn::Yield:
-        break;
-      }
-    }
+  // Allocates a task and submits it when it goes to the workers
+  Task* spawn(Task task);
+  // Runs task on a worker, task must stay alive until it returns Stop
+  // Any thread, when there are no workers the next run of the main thread runs it
+  void submit(Task* task);
+
+  // 0 starts one worker per hardware thread but one, for the main thread
+  void start_workers(usize worker_count = 0);
+  // Waits for the running tasks, the tasks still queued are kept for the next start_workers or run
+  void stop_workers();
+  usize worker_count() const;
+
+  // Runs one queued worker task on the calling thread, returns false if there was none
+  // For a thread that waits on worker tasks and wants to help instead of blocking
+  bool help();
+
+  // Any thread, the job is scheduled when all its dependencies are done
+  void launch(Job& job);
+  // Runs other jobs until counter reaches 0
+  // From the main thread, it also runs the Main jobs, a worker can not wait on a counter that waits on them
+  void wait(JobCounter& counter);
+
+  // Called from the main thread
+  // Also runs the Main jobs that are ready
+  // Background tasks are not started once budget_ns has elapsed since the start of the run
+  void run(u64 budget_ns = TASK_NO_BUDGET);
+  // A run with what is left of frame_budget_ns, and takes its time out of it
+  void run_frame_slice() {
+    run(frame_budget_ns);
+    frame_budget_ns -= MIN(frame_budget_ns, last_run.elapsed_ns);
   }
 };
 
@@ -0,0 +1,258 @@
+#ifndef INCLUDE_CORE_SORT_H_
+#define INCLUDE_CORE_SORT_H_
+
+#include "base.h"
+#include "memory.h"
+#include "parallel.h"
+
+#include <bit>
+#include <cstring>
+#include <type_traits>
+
+#ifndef RADIX_SORT_GRAIN
+  #define RADIX_SORT_GRAIN (1zu << 16)
+#endif
+
+namespace core {
+
+// === Sort keys ===
+//
+// Packs fields in an integer key, the first field pushed is the most significant
+// Sorting the keys sorts by the first field, then the second...
+//   u64 key = sort_key{}.push(pipeline_idx, 8).push(texture_idx, 16).push(mesh_idx, 32).finish();
+struct sort_key {
+  u64 key   = 0;
+  u32 width = 0;
+
+  constexpr sort_key& push(u64 value, u32 bits) {
+    ASSERTM(width + bits <= 64, "sort_key: more than 64 bits");
+    ASSERTM(bits == 64 || value < (1ull << bits), "sort_key: %zu does not fit in %u bits", (usize)value, bits);
+    key    = bits == 64 ? value : key << bits | value;
+    width += bits;
+    return *this;
+  }
+
+  // The fields are moved to the top bits: the low bytes are all 0 and radix_sort skips them
+  constexpr u64 finish() const {
+    return width == 0 ? 0 : key << (64 - width);
+  }
+};
+
+// Maps a float to an u32 in the same order (negative floats included)
+inline u32 sort_key_from_f32(f32 f) {
+  u32 bits = std::bit_cast<u32>(f);
+  return bits & 0x80000000 ? ~bits : bits | 0x80000000;
+}
+
+// === Radix sort ===
+//
+// LSD radix sort on u32 or u64 keys, one pass per byte with 256 buckets, stable
+// The histograms of every byte are built in a single read of the keys and a pass is skipped when all the keys share
+// the byte, so keys from sort_key that only use their top bytes cost as many passes as they have bytes of fields
+// The temporaries (one copy of the keys and of the values) come from a scratch arena
+//
+// radix_sort_parallel splits the keys in chunks of grain keys run on the default task queue, each pass:
+// - every chunk counts its keys per bucket
+// - the offsets are scanned bucket-major: a bucket gets the keys of chunk 0, then the ones of chunk 1... it stays stable
+// - every chunk scatters its keys from its own offsets
+// The first read builds the histograms of every byte per chunk, for the skipped bytes and the first pass
+
+namespace detail_ {
+template <class K, class V>
+void radix_sort_impl(storage<K> keys, V* values) {
+  static_assert(std::is_same_v<K, u32> || std::is_same_v<K, u64>, "radix_sort sorts u32 and u64 keys");
+  constexpr usize BYTES   = sizeof(K);
+  constexpr bool HAS_VALS = !std::is_void_v<V>;
+  using value_type        = std::conditional_t<HAS_VALS, V, u8>;
+
+  usize n = keys.size;
+  if (n < 2) {
+    return;
+  }
+
+  auto scratch          = scratch_get();
+  core::Allocator alloc = scratch;
+  auto* counts          = alloc.allocate_array<usize>(BYTES * 256, "radix_sort").data;
+  for (auto k : keys.iter()) {
+    for (usize b = 0; b < BYTES; b++) {
+      counts[b * 256 + ((k >> (8 * b)) & 0xFF)]++;
+    }
+  }
+
+  K* src              = keys.data;
+  K* dst              = alloc.allocate_array_uninit<K>(n, "radix_sort").data;
+  value_type* src_val = nullptr;
+  value_type* dst_val = nullptr;
+  if constexpr (HAS_VALS) {
+    src_val = values;
+    dst_val = alloc.allocate_array_uninit<value_type>(n, "radix_sort").data;
+  }
+
+  for (usize b = 0; b < BYTES; b++) {
+    usize* count = counts + b * 256;
+    if (count[(src[0] >> (8 * b)) & 0xFF] == n) {
+      continue;
+    }
+
+    // bucket starts
+    usize sum = 0;
+    for (usize i = 0; i < 256; i++) {
+      usize c   = count[i];
+      count[i]  = sum;
+      sum      += c;
+    }
+
+    for (usize i = 0; i < n; i++) {
+      usize pos = count[(src[i] >> (8 * b)) & 0xFF]++;
+      dst[pos]  = src[i];
+      if constexpr (HAS_VALS) {
+        dst_val[pos] = src_val[i];
+      }
+    }
+    SWAP(src, dst);
+    if constexpr (HAS_VALS) {
+      SWAP(src_val, dst_val);
+    }
+  }
+
+  // an odd number of passes left the result in the temporaries
+  if (src != keys.data) {
+    memcpy(keys.data, src, n * sizeof(K));
+    if constexpr (HAS_VALS) {
+      memcpy((void*)values, src_val, n * sizeof(value_type));
+    }
+  }
+}
+
+template <class K, class V>
+void radix_sort_parallel_impl(storage<K> keys, V* values, usize grain) {
+  static_assert(std::is_same_v<K, u32> || std::is_same_v<K, u64>, "radix_sort sorts u32 and u64 keys");
+  constexpr usize BYTES   = sizeof(K);
+  constexpr bool HAS_VALS = !std::is_void_v<V>;
+  using value_type        = std::conditional_t<HAS_VALS, V, u8>;
+
+  usize n           = keys.size;
+  grain             = MAX(grain, 1zu);
+  usize chunk_count = (n + grain - 1) / grain;
+  if (chunk_count < 2) {
+    return radix_sort_impl<K, V>(keys, values);
+  }
+  auto chunk_begin = [&](usize c) { return c * grain; };
+  auto chunk_end   = [&](usize c) { return MIN(n, (c + 1) * grain); };
+
+  auto scratch          = scratch_get();
+  core::Allocator alloc = scratch;
+  // the keys of chunk c whose byte b is d: counts[(c * BYTES + b) * 256 + d]
+  auto* counts  = alloc.allocate_array<usize>(chunk_count * BYTES * 256, "radix_sort").data;
+  auto* offsets = alloc.allocate_array_uninit<usize>(chunk_count * 256, "radix_sort").data;
+
+  K* src              = keys.data;
+  K* dst              = alloc.allocate_array_uninit<K>(n, "radix_sort").data;
+  value_type* src_val = nullptr;
+  value_type* dst_val = nullptr;
+  if constexpr (HAS_VALS) {
+    src_val = values;
+    dst_val = alloc.allocate_array_uninit<value_type>(n, "radix_sort").data;
+  }
+
+  auto histograms = [&](usize c) {
+    usize* count = counts + c * BYTES * 256;
+    for (usize i = chunk_begin(c); i < chunk_end(c); i++) {
+      for (usize b = 0; b < BYTES; b++) {
+        count[b * 256 + ((src[i] >> (8 * b)) & 0xFF)]++;
+      }
+    }
+  };
+  parallel_run(chunk_count, histograms);
+
+  bool fresh = true;
+  for (usize b = 0; b < BYTES; b++) {
+    // the totals of a byte do not depend on the order of the keys, the histograms of the first read still give them
+    usize digit = (src[0] >> (8 * b)) & 0xFF;
+    usize total = 0;
+    for (usize c = 0; c < chunk_count; c++) {
+      total += counts[(c * BYTES + b) * 256 + digit];
+    }
+    if (total == n) {
+      continue;
+    }
+
+    // the keys moved between chunks since the first read
+    if (!fresh) {
+      auto histogram = [&](usize c) {
+        usize* count = counts + (c * BYTES + b) * 256;
+        memset(count, 0, 256 * sizeof(usize));
+        for (usize i = chunk_begin(c); i < chunk_end(c); i++) {
+          count[(src[i] >> (8 * b)) & 0xFF]++;
+        }
+      };
+      parallel_run(chunk_count, histogram);
+    }
+    fresh = false;
+
+    usize sum = 0;
+    for (usize d = 0; d < 256; d++) {
+      for (usize c = 0; c < chunk_count; c++) {
+        offsets[c * 256 + d]  = sum;
+        sum                  += counts[(c * BYTES + b) * 256 + d];
+      }
+    }
+
+    auto scatter = [&](usize c) {
+      usize* offset = offsets + c * 256;
+      for (usize i = chunk_begin(c); i < chunk_end(c); i++) {
+        usize pos = offset[(src[i] >> (8 * b)) & 0xFF]++;
+        dst[pos]  = src[i];
+        if constexpr (HAS_VALS) {
+          dst_val[pos] = src_val[i];
+        }
+      }
+    };
+    parallel_run(chunk_count, scatter);
+    SWAP(src, dst);
+    if constexpr (HAS_VALS) {
+      SWAP(src_val, dst_val);
+    }
+  }
+
+  if (src != keys.data) {
+    auto copy_back = [&](usize c) {
+      usize first = chunk_begin(c);
+      memcpy(keys.data + first, src + first, (chunk_end(c) - first) * sizeof(K));
+      if constexpr (HAS_VALS) {
+        memcpy((void*)(values + first), src_val + first, (chunk_end(c) - first) * sizeof(value_type));
+      }
+    };
+    parallel_run(chunk_count, copy_back);
+  }
+}
+} // namespace detail_
+
+template <class K>
+void radix_sort(storage<K> keys) {
+  detail_::radix_sort_impl<K, void>(keys, nullptr);
+}
+
+// Sorts values along with their keys, values[i] is the payload of keys[i]
+template <class K, class V>
+void radix_sort(storage<K> keys, storage<V> values) {
+  static_assert(std::is_trivially_copyable_v<V>);
+  ASSERTM(keys.size == values.size, "radix_sort: %zu keys for %zu values", keys.size, values.size);
+  detail_::radix_sort_impl<K, V>(keys, values.data);
+}
+
+template <class K>
+void radix_sort_parallel(storage<K> keys, usize grain = RADIX_SORT_GRAIN) {
+  detail_::radix_sort_parallel_impl<K, void>(keys, nullptr, grain);
+}
+
+template <class K, class V>
+void radix_sort_parallel(storage<K> keys, storage<V> values, usize grain = RADIX_SORT_GRAIN) {
+  static_assert(std::is_trivially_copyable_v<V>);
+  ASSERTM(keys.size == values.size, "radix_sort: %zu keys for %zu values", keys.size, values.size);
+  detail_::radix_sort_parallel_impl<K, V>(keys, values.data, grain);
+}
+
+} // namespace core
+
+#endif // INCLUDE_CORE_SORT_H_
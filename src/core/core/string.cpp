@@ -4,8 +4,8 @@
 #include <cstdio>
 #include <cstring>
 
+#include <core/containers/hash_map.h>
 #include <core/core.h>
-#include <unordered_map>
 
 namespace core {
 
@@ -46,7 +46,7 @@ EXPORT str8 string_builder::commit(Allocator alloc, str8 join) const {
 
   const usize expected_len = total_len + (node_count - 1) * join.len;
   const string_node* node  = first;
-  auto storage             = alloc.allocate_array<u8>(expected_len);
+  auto storage             = alloc.allocate_array_uninit<u8>(expected_len);
   usize offset             = 0;
   usize count              = 0;
   while (node != nullptr) {
@@ -111,7 +111,7 @@ EXPORT string_builder& string_builder::append(string_builder& sb) {
 }
 
 EXPORT str8 str8::clone(Allocator alloc) {
-  auto storage = alloc.allocate_array<u8>(len);
+  auto storage = alloc.allocate_array_uninit<u8>(len);
   memcpy(storage.data, data, len);
   return {len, storage.data};
 }
@@ -124,7 +124,7 @@ EXPORT hstr8 hstr8::clone(Allocator alloc) {
 EXPORT const char* str8::cstring(Allocator alloc) {
   u8* cstr = (u8*)data;
   if (!alloc.try_resize((void*)data, len, len + 1)) {
-    cstr = (u8*)alloc.allocate(len + 1, alignof(char));
+    cstr = (u8*)alloc.allocate_uninit(len + 1, alignof(char));
     memcpy(cstr, data, len);
   }
 
@@ -133,27 +133,28 @@ EXPORT const char* str8::cstring(Allocator alloc) {
 }
 
 static struct {
-  std::unordered_map<u64, hstr8> m;
+  hash_map<u64, hstr8> m;
 } interned;
 
 EXPORT hstr8 intern(hstr8 s) {
-  auto it = interned.m.find(s.hash);
-  if (it == interned.m.end()) {
-    auto h = s.clone(get_named_allocator(AllocatorName::General));
-    interned.m.insert({h.hash, h});
+  auto it = interned.m.get(s.hash);
+  if (it.is_none()) {
+    auto alloc = get_named_allocator(AllocatorName::General);
+    auto h     = s.clone(alloc);
+    interned.m.insert(alloc, h.hash, h);
     return h;
   }
-  return it->second;
+  return *it;
 }
 
 EXPORT hstr8 unintern(u64 hash) {
-  auto it = interned.m.find(hash);
-  if (it == interned.m.end()) {
+  auto it = interned.m.get(hash);
+  if (it.is_none()) {
     LOG_WARNING("trying to unintern an unknown string");
     return "<unknown>"_hs;
   }
 
-  return it->second;
+  return *it;
 }
 
 const char* hstr8::cstring(Allocator alloc) {
@@ -6,8 +6,12 @@
 
 #include <cstdio>
 
+#include <atomic>
+
 #include <cerrno>
+#include <cstring>
 #include <filesystem>
+#include <thread>
 #include <uv.h>
 
 namespace std {
@@ -53,11 +57,14 @@ struct {
   usize watch_id;
 
   uv_loop_t* event_loop;
+  // the thread that runs the event loop, libuv requests are started from it
+  std::thread::id loop_thread;
 } fs;
 
 EXPORT void init(uv_loop_t* event_loop) {
-  fs.event_loop = event_loop;
-  fs.arena      = &core::arena_alloc();
+  fs.event_loop  = event_loop;
+  fs.arena       = &core::arena_alloc();
+  fs.loop_thread = std::this_thread::get_id();
 }
 
 EXPORT void mount(core::str8 path, core::str8 target) {
@@ -117,7 +124,7 @@ EXPORT core::Maybe<core::str8> resolve_path(core::Allocator alloc, core::str8 pa
 }
 
 EXPORT core::storage<u8> read_all(core::Allocator alloc, virtualpath path) {
-  auto scratch = core::scratch_get();
+  auto scratch = core::scratch_get(alloc);
 
   LOG2_TRACE("reading file ", path);
   auto realpath = resolve_path(*scratch, path).expect("can't find path").cstring(*scratch);
@@ -133,7 +140,7 @@ EXPORT core::storage<u8> read_all(core::Allocator alloc, virtualpath path) {
   usize sz = (usize)ftell(f);
   fseek(f, 0, SEEK_SET);
 
-  auto storage    = alloc.allocate_array<u8>(sz);
+  auto storage    = alloc.allocate_array_uninit<u8>(sz);
   usize data_read = fread(storage.data, 1, sz, f);
   ASSERT(data_read == sz);
 
@@ -141,6 +148,111 @@ EXPORT core::storage<u8> read_all(core::Allocator alloc, virtualpath path) {
   return storage;
 }
 
+// open -> fstat -> read until everything is there -> close, each step is started by the callback of the previous one
+struct read_request {
+  uv_fs_t uv;
+  core::Allocator alloc;
+  // owned by the request, General
+  char* path;
+  usize path_size;
+  uv_file file;
+  core::storage<u8> data;
+  usize offset;
+  std::atomic<bool> done;
+};
+
+static void read_request_check(read_request* req, ssize_t result, const char* step) {
+  if (result < 0) {
+    LOG_BUILDER(
+        core::LogLevel::Error,
+        with_stacktrace().panic().pushf("can't %s file %s: %s", step, req->path, uv_strerror((int)result))
+    );
+  }
+}
+
+static void read_request_read(read_request* req);
+
+static void read_request_on_close(uv_fs_t* uv) {
+  auto* req = (read_request*)uv->data;
+  uv_fs_req_cleanup(uv);
+  req->done.store(true, std::memory_order_release);
+}
+
+static void read_request_on_read(uv_fs_t* uv) {
+  auto* req = (read_request*)uv->data;
+  read_request_check(req, uv->result, "read");
+  ASSERTM(uv->result > 0, "file %s is shorter than expected", req->path);
+  req->offset += (usize)uv->result;
+  uv_fs_req_cleanup(uv);
+
+  if (req->offset < req->data.size) {
+    return read_request_read(req);
+  }
+  ASSERT(uv_fs_close(fs.event_loop, &req->uv, req->file, read_request_on_close) == 0);
+}
+
+static void read_request_read(read_request* req) {
+  uv_buf_t buf = uv_buf_init((char*)req->data.data + req->offset, (unsigned)(req->data.size - req->offset));
+  ASSERT(uv_fs_read(fs.event_loop, &req->uv, req->file, &buf, 1, (s64)req->offset, read_request_on_read) == 0);
+}
+
+static void read_request_on_stat(uv_fs_t* uv) {
+  auto* req = (read_request*)uv->data;
+  read_request_check(req, uv->result, "stat");
+  usize sz = (usize)uv->statbuf.st_size;
+  uv_fs_req_cleanup(uv);
+
+  req->data = req->alloc.allocate_array_uninit<u8>(sz);
+  if (sz == 0) {
+    ASSERT(uv_fs_close(fs.event_loop, &req->uv, req->file, read_request_on_close) == 0);
+    return;
+  }
+  read_request_read(req);
+}
+
+static void read_request_on_open(uv_fs_t* uv) {
+  auto* req = (read_request*)uv->data;
+  read_request_check(req, uv->result, "open");
+  req->file = (uv_file)uv->result;
+  uv_fs_req_cleanup(uv);
+  ASSERT(uv_fs_fstat(fs.event_loop, &req->uv, req->file, read_request_on_stat) == 0);
+}
+
+EXPORT read_file_awaiter read_file(core::Allocator alloc, virtualpath path) {
+  ASSERTM(
+      std::this_thread::get_id() == fs.loop_thread, "fs::read_file must be called from the thread of the event loop"
+  );
+  auto general = core::get_named_allocator(core::AllocatorName::General);
+  auto* req    = new (general.allocate<read_request>()) read_request{};
+  req->alloc   = alloc;
+
+  // the path is used until the request is done, the caller may reset its arenas before that
+  auto scratch   = core::scratch_get(alloc);
+  auto resolved  = resolve_path(*scratch, path).expect("can't find path");
+  req->path_size = resolved.len + 1;
+  req->path      = (char*)general.allocate_uninit(req->path_size, alignof(char), "read_request");
+  memcpy(req->path, resolved.data, resolved.len);
+  req->path[resolved.len] = 0;
+  uv_req_set_data((uv_req_t*)&req->uv, req);
+
+  LOG2_TRACE("reading file ", path);
+  ASSERT(uv_fs_open(fs.event_loop, &req->uv, req->path, UV_FS_O_RDONLY, 0, read_request_on_open) == 0);
+  return {{}, req};
+}
+
+EXPORT bool read_file_awaiter::poll() {
+  return req->done.load(std::memory_order_acquire);
+}
+
+EXPORT core::storage<u8> read_file_awaiter::await_resume() {
+  auto data    = req->data;
+  auto general = core::get_named_allocator(core::AllocatorName::General);
+  general.deallocate(req->path, req->path_size, "read_request");
+  req->~read_request();
+  general.deallocate(req, sizeof(read_request), "read_request");
+  return data;
+}
+
 EXPORT on_file_modified_handle
 register_modified_file_callback(core::str8 path, on_file_modified_t callback, void* userdata) {
   const char* cpath = resolve_path(*fs.arena, path).expect("can't resolve path").cstring(*fs.arena);
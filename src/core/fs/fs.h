@@ -2,6 +2,9 @@
 #define INCLUDE_FS_FS_H_
 
 #include <core/core.h>
+#include <core/core/coro.h>
+
+#include <atomic>
 
 #if WINDOWS
   #define PATH_SEPARATOR_S "\\"_s
@@ -23,6 +26,19 @@ void mount(virtualpath path, realpath target);
 core::Maybe<realpath> resolve_path(core::Allocator alloc, virtualpath);
 core::storage<u8> read_all(core::Allocator alloc, virtualpath);
 
+// read_all through the uv loop, for a coroutine: auto bytes = co_await fs::read_file(alloc, path);
+struct read_request;
+struct read_file_awaiter : core::poll_awaiter<read_file_awaiter> {
+  read_request* req;
+
+  bool poll();
+  core::storage<u8> await_resume();
+};
+// The read starts right away, the awaiter must be awaited
+// From the thread of the event loop only: a coroutine that reads files is spawned with the Main affinity
+// The data is allocated from alloc, on the thread of the event loop
+read_file_awaiter read_file(core::Allocator alloc, virtualpath);
+
 using on_file_modified_t      = void (*)(void*);
 using on_file_modified_handle = core::handle_t<on_file_modified_t>;
 on_file_modified_handle register_modified_file_callback(virtualpath vpath, on_file_modified_t callback, void* userdata);
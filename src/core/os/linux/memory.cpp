@@ -1,11 +1,17 @@
 #include "../memory.h"
 #include <core/core.h>
 
+#include <atomic>
 #include <cerrno>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
+#ifndef MADV_POPULATE_WRITE
+  #define MADV_POPULATE_WRITE 23 // linux 5.14
+#endif
+
 using namespace core::enum_helpers;
 
 #ifdef MEM_DEBUG
@@ -13,8 +19,25 @@ using namespace core::enum_helpers;
 #endif
 
 namespace os {
+static std::atomic<usize> commit_count;
+static std::atomic<usize> decommit_count;
+static std::atomic<usize> commit_bytes;
+static std::atomic<usize> decommit_bytes;
+
 #ifndef MEM_USE_MALLOC
 
+static void populate(void* ptr, usize size) {
+  if (madvise(ptr, size, MADV_POPULATE_WRITE) == 0) {
+    return;
+  }
+
+  // older kernel, touch every page ourselves
+  // the range may already hold data, so it's a read then a write of the same value
+  for (volatile u8* p = (u8*)ptr; p < (u8*)ptr + size; p += mem_page_size()) {
+    *p = *p;
+  }
+}
+
 void* mem_allocate(void* ptr, usize size, MemAllocationFlags flags) {
   if (any(flags & MemAllocationFlags::Reserve)) {
     ASSERT(ptr == nullptr);
@@ -22,12 +45,34 @@ void* mem_allocate(void* ptr, usize size, MemAllocationFlags flags) {
 
     usize alloc_size = size;
     MEM_DEBUG_STMT(alloc_size += mem_page_size());
-    ptr = mmap(nullptr, alloc_size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+
+    const bool huge_pages = any(flags & MemAllocationFlags::HugePages);
+    usize map_size        = huge_pages ? alloc_size + mem_huge_page_size() : alloc_size;
+    ptr                   = mmap(nullptr, map_size, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
 
     if (ptr == MAP_FAILED) {
       core::panic("%s", strerrordesc_np(errno));
     }
 
+    if (huge_pages) {
+      // Only unmap the slack so that the range given back is huge page aligned
+      usize debug_offset = 0;
+      MEM_DEBUG_STMT(debug_offset = mem_page_size());
+
+      u8* start = ALIGN_UP((u8*)ptr + debug_offset, mem_huge_page_size()) - debug_offset;
+      u8* end   = (u8*)ptr + map_size;
+      if (start != ptr) {
+        munmap(ptr, usize(start - (u8*)ptr));
+      }
+      if (start + alloc_size != end) {
+        munmap(start + alloc_size, usize(end - start - alloc_size));
+      }
+      ptr = start;
+
+      // best effort, THP may be disabled
+      madvise(ptr, alloc_size, MADV_HUGEPAGE);
+    }
+
     ASAN_POISON_MEMORY_REGION(ptr, alloc_size);
 
     MEM_DEBUG_STMT(ptr = (void*)((char*)ptr + mem_page_size()));
@@ -38,7 +83,13 @@ void* mem_allocate(void* ptr, usize size, MemAllocationFlags flags) {
     if (mprotect(ptr, size, PROT_READ | PROT_WRITE) == -1) {
       core::panic("%s", strerrordesc_np(errno));
     }
+    commit_count.fetch_add(1, std::memory_order_relaxed);
+    commit_bytes.fetch_add(size, std::memory_order_relaxed);
     ASAN_UNPOISON_MEMORY_REGION(ptr, size);
+
+    if (any(flags & MemAllocationFlags::Populate)) {
+      populate(ptr, size);
+    }
   }
 
   return ptr;
@@ -54,6 +105,8 @@ void mem_deallocate(void* ptr, usize size, MemDeallocationFlags flags) {
     if (mprotect(ptr, size, PROT_NONE) == -1) {
       core::panic("%s", strerror(errno));
     }
+    decommit_count.fetch_add(1, std::memory_order_relaxed);
+    decommit_bytes.fetch_add(size, std::memory_order_relaxed);
     ASAN_POISON_MEMORY_REGION(ptr, size);
   }
   if (any(flags & MemDeallocationFlags::Release)) {
@@ -78,4 +131,20 @@ usize mem_page_size() {
   return page_size_;
 }
 
+usize mem_huge_page_size() {
+  return MB(2zu);
+}
+
+MemStats mem_stats() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return {
+      .commit_count   = commit_count.load(std::memory_order_relaxed),
+      .decommit_count = decommit_count.load(std::memory_order_relaxed),
+      .commit_bytes   = commit_bytes.load(std::memory_order_relaxed),
+      .decommit_bytes = decommit_bytes.load(std::memory_order_relaxed),
+      .page_faults    = usize(usage.ru_minflt + usage.ru_majflt),
+  };
+}
+
 } // namespace os
@@ -14,6 +14,10 @@ namespace os {
 enum class MemAllocationFlags : u8 {
   Reserve = 0x1,
   Commit  = 0x2,
+  // Reserve: align the range on mem_huge_page_size() and ask for transparent huge pages
+  HugePages = 0x4,
+  // Commit: fault the pages in now instead of on first touch
+  Populate = 0x8,
 };
 void* mem_allocate(void* ptr, usize size, MemAllocationFlags flags);
 
@@ -24,6 +28,19 @@ enum class MemDeallocationFlags {
 void mem_deallocate(void* ptr, usize size, MemDeallocationFlags flags);
 
 usize mem_page_size();
+// mem_page_size() if the platform has no transparent huge pages
+usize mem_huge_page_size();
+
+struct MemStats {
+  // syscalls made by mem_allocate(Commit) and mem_deallocate(Decommit)
+  usize commit_count;
+  usize decommit_count;
+  usize commit_bytes;
+  usize decommit_bytes;
+  // for the whole process
+  usize page_faults;
+};
+MemStats mem_stats();
 } // namespace os
 
 #endif // INCLUDE_OS_MEMORY_H_
@@ -1,13 +1,21 @@
 #include "../memory.h"
 #include <core/core.h>
 
+#include <atomic>
 #include <cerrno>
 #include <string.h>
 #include <windows.h>
 
+#include <psapi.h>
+
 using namespace core::enum_helpers;
 
 namespace os {
+static std::atomic<usize> commit_count;
+static std::atomic<usize> decommit_count;
+static std::atomic<usize> commit_bytes;
+static std::atomic<usize> decommit_bytes;
+
 #ifndef MEM_USE_MALLOC
 
 void* mem_allocate(void* ptr, usize size, MemAllocationFlags flags) {
@@ -17,8 +25,18 @@ void* mem_allocate(void* ptr, usize size, MemAllocationFlags flags) {
   }
   if (any(flags & MemAllocationFlags::Commit)) {
     fl |= MEM_COMMIT;
+    commit_count.fetch_add(1, std::memory_order_relaxed);
+    commit_bytes.fetch_add(size, std::memory_order_relaxed);
   }
-  return VirtualAlloc(ptr, size, fl, PAGE_READWRITE);
+  // HugePages: large pages need a privilege, they are not worth it here
+  ptr = VirtualAlloc(ptr, size, fl, PAGE_READWRITE);
+
+  if (ptr != nullptr && any(flags & MemAllocationFlags::Populate)) {
+    for (volatile u8* p = (u8*)ptr; p < (u8*)ptr + size; p += mem_page_size()) {
+      *p = *p;
+    }
+  }
+  return ptr;
 }
 
 void mem_deallocate(void* ptr, usize size, MemDeallocationFlags flags) {
@@ -29,6 +47,8 @@ void mem_deallocate(void* ptr, usize size, MemDeallocationFlags flags) {
   }
   if (any(flags & MemDeallocationFlags::Decommit)) {
     fl |= MEM_DECOMMIT;
+    decommit_count.fetch_add(1, std::memory_order_relaxed);
+    decommit_bytes.fetch_add(size, std::memory_order_relaxed);
   }
   VirtualFree(ptr, size, fl);
   return;
@@ -44,4 +64,20 @@ usize mem_page_size() {
   return page_size_;
 }
 
+usize mem_huge_page_size() {
+  return page_size_;
+}
+
+MemStats mem_stats() {
+  PROCESS_MEMORY_COUNTERS counters{};
+  GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+  return {
+      .commit_count   = commit_count.load(std::memory_order_relaxed),
+      .decommit_count = decommit_count.load(std::memory_order_relaxed),
+      .commit_bytes   = commit_bytes.load(std::memory_order_relaxed),
+      .decommit_bytes = decommit_bytes.load(std::memory_order_relaxed),
+      .page_faults    = (usize)counters.PageFaultCount,
+  };
+}
+
 } // namespace os
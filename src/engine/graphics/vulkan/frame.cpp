@@ -59,6 +59,8 @@ EXPORT core::tuple<core::Maybe<Frame>, bool> begin_frame(
   }
 
   vmaSetCurrentFrameIndex(device.allocator, frame_id);
+  // the fence has signalled, what the GPU was reading from this frame arena is not used anymore
+  core::inflight_frame_begin(frame_id);
   vkResetFences(device, 1, &sync.render_done_fences[frame_id]);
   sync.frame_id = frame_id;
   return {
@@ -75,6 +77,8 @@ EXPORT core::tuple<core::Maybe<Frame>, bool> begin_frame(
 EXPORT VkResult end_frame(VkDevice device, VkQueue present_queue, VkSwapchainKHR swapchain, Frame frame) {
   auto present = utils::scope_start("present"_hs);
   defer { utils::scope_end(present); };
+  // the frame is submitted, what is allocated from now on would not be waited on by its fence
+  core::inflight_frame_end();
   VkPresentInfoKHR present_infos{
       .sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
       .waitSemaphoreCount = 1,
@@ -86,6 +90,10 @@ EXPORT VkResult end_frame(VkDevice device, VkQueue present_queue, VkSwapchainKHR
   return vkQueuePresentKHR(present_queue, &present_infos);
 }
 EXPORT FrameSynchro create_frame_synchro(core::Allocator alloc, VkDevice device, u32 inflight) {
+  ASSERTM(
+      inflight <= FRAME_INFLIGHT_MAX, "%u frames in flight but there are only %u frame arenas", inflight,
+      FRAME_INFLIGHT_MAX
+  );
   FrameSynchro frame_synchro{
       inflight,
       0,
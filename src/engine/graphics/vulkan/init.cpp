@@ -450,6 +450,7 @@ EXPORT Result<Device> create_default_device(
       .dynamic_rendering   = true,
       .timestamps          = true,
       .descriptor_indexing = true,
+      .timeline_semaphore  = true,
   };
   auto [physical_device, queues_creation_infos] = [&] {
     auto physical_device = find_physical_device(*ar, instance, requested_features);
@@ -542,6 +543,14 @@ EXPORT VkPhysicalDeviceFeatures2 physical_device_features::into_vk_physical_devi
     };
     VK_PUSH_NEXT(&physical_device_features2, physical_device_descriptor_indexing_features);
   }
+  if (timeline_semaphore) {
+    auto physical_device_timeline_semaphore_features = alloc.allocate<VkPhysicalDeviceTimelineSemaphoreFeatures>();
+    *physical_device_timeline_semaphore_features     = {
+            .sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+            .timelineSemaphore = VK_TRUE,
+    };
+    VK_PUSH_NEXT(&physical_device_features2, physical_device_timeline_semaphore_features);
+  }
   return physical_device_features2;
 }
 EXPORT bool physical_device_features::check_features(const VkPhysicalDeviceProperties2& physical_device_properties2
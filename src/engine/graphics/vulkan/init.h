@@ -67,6 +67,7 @@ struct physical_device_features {
   bool dynamic_rendering;
   bool timestamps;
   bool descriptor_indexing;
+  bool timeline_semaphore;
 
   bool check_features(const VkPhysicalDeviceProperties2& physical_device_properties2) const;
   VkPhysicalDeviceFeatures2 into_vk_physical_device_features2(core::Allocator alloc) const;
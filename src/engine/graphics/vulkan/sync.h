@@ -3,6 +3,7 @@
 
 #include "vulkan.h"
 #include <core/core.h>
+#include <core/core/coro.h>
 
 namespace vk {
 
@@ -91,6 +92,43 @@ inline void pipeline_barrier(VkCommandBuffer cmd, Args... args)
   return pipeline_barrier(cmd, vk::Barriers{args...});
 }
 
+// === Awaitables, for core::task ===
+// Polled once per tick, the coroutine never waits on the device
+
+// co_await vk::fence_signaled(device, fence);
+struct fence_signaled : core::poll_awaiter<fence_signaled> {
+  VkDevice device;
+  VkFence fence;
+
+  fence_signaled(VkDevice device, VkFence fence)
+      : device(device)
+      , fence(fence) {}
+
+  bool poll() {
+    return vkGetFenceStatus(device, fence) == VK_SUCCESS;
+  }
+  void await_resume() {}
+};
+
+// co_await vk::semaphore_reached(device, timeline, value);
+struct semaphore_reached : core::poll_awaiter<semaphore_reached> {
+  VkDevice device;
+  VkSemaphore semaphore;
+  u64 value;
+
+  semaphore_reached(VkDevice device, VkSemaphore semaphore, u64 value)
+      : device(device)
+      , semaphore(semaphore)
+      , value(value) {}
+
+  bool poll() {
+    u64 current;
+    VK_ASSERT(vkGetSemaphoreCounterValue(device, semaphore, &current));
+    return current >= value;
+  }
+  void await_resume() {}
+};
+
 } // namespace vk
 
 #endif // INCLUDE_VULKAN_SYNC_H_
@@ -1,8 +1,10 @@
 #include "time.h"
+#include <core/containers/hash_map.h>
 #include <core/core.h>
 #include <core/math.h>
 #include <core/os/time.h>
 
+// Keeps the insertion order, the profiler colors scopes by their index
 struct string_map {
   using T = os::time;
   struct Data {
@@ -10,20 +12,24 @@ struct string_map {
     T value;
   };
   core::vec<Data> data;
+  core::hash_map<core::hstr8, u32> indices;
 
   T& operator[](core::hstr8 h) {
-    for (usize offset = 0; offset < data.size(); offset++) {
-      auto& d = data[offset];
-      if (d.key == h) {
-        return d.value;
-      }
+    auto idx = indices.get(h);
+    if (idx.is_some()) {
+      return data[*idx].value;
     }
+
+    // reserved in reset, this does not allocate
+    indices.insert(core::get_named_allocator(core::AllocatorName::General), h, (u32)data.size());
     data.push(core::noalloc, {h, {}});
     return data[data.size() - 1].value;
   }
 
   void reset() {
     data.set_size(0);
+    indices.reserve(core::get_named_allocator(core::AllocatorName::General), data.capacity());
+    indices.clear();
   }
 
   auto iter() {
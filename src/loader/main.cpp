@@ -66,6 +66,8 @@ int main(int argc, char* argv[]) {
         loop
     );
   }
+  // the jobs spawned by the app with TaskAffinity::Worker, the main thread keeps the uv loop and the app tasks
+  core::default_task_queue()->start_workers();
 
   fs::init(uv_default_loop());
   mount_paths();
@@ -97,7 +99,7 @@ int main(int argc, char* argv[]) {
   /// === Main loop ===
   /// Note: frame start and end are not directly dictated by the loop
   while (!false) {
-    core::default_task_queue()->run();
+    core::default_task_queue()->run_frame_slice();
 
     /// === Frame Udpate ===
     auto sev = app_pfns.process_events(*app);
@@ -127,6 +129,7 @@ int main(int argc, char* argv[]) {
 
   LOG_INFO("Exiting...");
   app_pfns.uninit(*app, false);
+  core::default_task_queue()->stop_workers();
 
   ImGui_ImplSDL3_Shutdown();
   ImGui::DestroyContext();
@@ -0,0 +1,336 @@
+#include "tests.h"
+
+#include <core/core.h>
+#include <core/core/memory_tracker.h>
+#include <core/os/memory.h>
+#include <thread>
+
+TEST(concurrent arena) {
+  auto& arena           = core::concurrent_arena_alloc(MB(1));
+  core::Allocator alloc = arena;
+  defer { core::concurrent_arena_dealloc(arena); };
+
+  auto* a = (u8*)alloc.allocate(3, 1);
+  auto* b = (u64*)alloc.allocate(sizeof(u64), alignof(u64));
+  tassert(((uptr)b & (alignof(u64) - 1)) == 0, "allocation is missaligned");
+  tassert(alloc.owns(a) && alloc.owns(b), "arena should own its allocations");
+  tassert(*b == 0, "allocations should be zeroed");
+
+  tassert(!alloc.try_resize(a, 3, 6), "only the last allocation can be resized");
+  tassert(alloc.try_resize(b, sizeof(u64), 2 * sizeof(u64)), "last allocation should be resizable");
+  tassert(arena.pos() == (u64)((u8*)b + 2 * sizeof(u64) - arena.base), "invalid pos after resize");
+
+  {
+    auto temp = arena.make_temp();
+    alloc.allocate(KB(64), 1);
+    tassert(arena.pos() > temp.old_pos, "temp allocation should move pos");
+  }
+  tassert(arena.pos() == (u64)((u8*)b + 2 * sizeof(u64) - arena.base), "temp should roll back");
+}
+
+TEST(concurrent arena threads) {
+  auto& arena = core::concurrent_arena_alloc(MB(64));
+  defer { core::concurrent_arena_dealloc(arena); };
+
+  const usize thread_count = 8;
+  const usize alloc_count  = 4096;
+  const usize alloc_size   = 48;
+
+  core::array<u8**, thread_count> allocations{};
+  for (auto& a : allocations.iter()) {
+    a = (u8**)calloc(alloc_count, sizeof(u8*));
+  }
+  defer {
+    for (auto a : allocations.iter()) {
+      free(a);
+    }
+  };
+
+  core::array<std::thread, thread_count> threads{};
+  for (auto [thread_idx, thread] : core::enumerate{threads.iter()}) {
+    *thread = std::thread([&arena, &allocations, thread_idx] {
+      core::Allocator alloc = arena;
+      for (usize i = 0; i < alloc_count; i++) {
+        auto* p = (u8*)alloc.allocate(alloc_size, 16);
+        memset(p, (int)thread_idx + 1, alloc_size);
+        allocations[thread_idx][i] = p;
+      }
+    });
+  }
+  for (auto& thread : threads.iter()) {
+    thread.join();
+  }
+
+  for (auto [thread_idx, a] : core::enumerate{allocations.iter()}) {
+    for (usize i = 0; i < alloc_count; i++) {
+      for (usize j = 0; j < alloc_size; j++) {
+        tassert((*a)[i][j] == thread_idx + 1, "allocation of thread %zu has been overwritten", thread_idx);
+      }
+    }
+  }
+  tassert(arena.pos() >= thread_count * alloc_count * alloc_size, "arena lost allocations");
+}
+
+TEST(arena commit policy) {
+  auto& arena = core::arena_alloc(MB(64), {.min_commit = KB(64), .max_commit = MB(4)});
+  defer { core::arena_dealloc(arena); };
+
+  auto before = os::mem_stats();
+  for (usize i = 0; i < MB(16) / KB(4); i++) {
+    arena.allocate(KB(4), 1, "test");
+  }
+  usize commit_count = os::mem_stats().commit_count - before.commit_count;
+  tassert(commit_count < 16, "commits should grow geometrically, got %zu commits for 16MB", commit_count);
+  tassert(arena.committed >= arena.mem, "allocated memory should be committed");
+
+  arena.reset();
+  tassert(arena.committed >= arena.base + MB(16), "reset should keep up to policy.retain bytes committed");
+}
+
+TEST(arena huge pages and prefault) {
+  auto& arena = core::arena_alloc(MB(64), {.huge_pages = true, .prefault = true});
+  defer { core::arena_dealloc(arena); };
+
+  tassert(arena.policy.min_commit >= os::mem_huge_page_size(), "huge page arenas should commit huge pages");
+  tassert(((uptr)arena.committed & (os::mem_huge_page_size() - 1)) == 0, "commits should be huge page aligned");
+
+  auto* p = (u8*)arena.allocate(MB(5), 1, "test");
+  for (usize i = 0; i < MB(5); i += KB(4)) {
+    tassert(p[i] == 0, "allocations should be zeroed");
+    p[i] = 1;
+  }
+}
+
+TEST(arena decommit hysteresis) {
+  auto& arena = core::arena_alloc(MB(64), {.min_commit = KB(64), .retain = KB(512), .idle_resets = 4});
+  defer { core::arena_dealloc(arena); };
+
+  arena.allocate(MB(2), 1, "test");
+  arena.reset();
+  tassert(arena.committed <= arena.base + KB(512) + 2 * KB(64), "popping should only retain policy.retain bytes");
+
+  // once the extra has been trimmed, a steady frame shouldn't do any syscall
+  for (usize i = 0; i < 8; i++) {
+    arena.allocate(KB(300), 1, "test");
+    arena.reset();
+  }
+  auto before = os::mem_stats();
+  for (usize i = 0; i < 16; i++) {
+    arena.allocate(KB(300), 1, "test");
+    arena.reset();
+  }
+  auto after = os::mem_stats();
+  tassert(after.commit_count == before.commit_count, "steady resets should not commit");
+  tassert(after.decommit_count == before.decommit_count, "steady resets should not decommit");
+
+  // smaller frames let the extra go after idle_resets resets
+  for (usize i = 0; i < 4; i++) {
+    arena.allocate(KB(10), 1, "test");
+    arena.reset();
+  }
+  tassert(arena.committed <= arena.base + 3 * KB(64), "idle committed memory should be decommitted");
+
+  arena.allocate(KB(300), 1, "test");
+  arena.reset();
+  arena.trim();
+  tassert(arena.committed <= arena.base + 2 * KB(64), "trim should decommit what is not in use");
+}
+
+TEST(arena uninit allocations) {
+  auto& arena           = core::arena_alloc(MB(64));
+  core::Allocator alloc = arena;
+  defer { core::arena_dealloc(arena); };
+
+  auto* a = (u8*)alloc.allocate_uninit(KB(256), 1);
+  memset(a, 0xFF, KB(256));
+  tassert(arena.zeroed >= a + KB(256), "uninit allocations should move the zero watermark");
+
+  arena.reset();
+  auto* b = (u8*)alloc.allocate(KB(512), 1);
+  tassert(b == a, "arena should give back the same memory after a reset");
+  for (usize i = 0; i < KB(512); i++) {
+    tassert(b[i] == 0, "recycled memory should be cleared at %zu", i);
+  }
+
+  arena.reset();
+  arena.trim();
+  tassert(arena.zeroed <= arena.committed, "decommitted memory is zero again");
+  auto storage = alloc.allocate_array_uninit<u32>(1024);
+  tassert(storage.size == 1024 && storage.data != nullptr, "uninit arrays should be allocated");
+}
+
+TEST(chained arena) {
+  auto& arena           = core::arena_alloc(KB(64));
+  core::Allocator alloc = arena;
+  defer { core::arena_dealloc(arena); };
+
+  auto* first = (u8*)alloc.allocate(KB(16), 1);
+  auto temp   = arena.make_temp();
+
+  usize pos = arena.pos();
+  core::array<u8*, 256> ptrs{};
+  for (auto& p : ptrs.iter()) {
+    p = (u8*)alloc.allocate(KB(4), 16);
+    tassert(((uptr)p & 15) == 0, "chained allocations should be aligned");
+    tassert(arena.pos() > pos, "pos should keep growing across blocks");
+    pos = arena.pos();
+    memset(p, 1, KB(4));
+  }
+  tassert(arena.block != nullptr, "1MB shouldn't fit in a 64KB arena without chaining");
+  tassert(alloc.owns(first) && alloc.owns(ptrs[0]) && alloc.owns(ptrs[255]), "chained arena should own all blocks");
+  tassert(!alloc.try_resize(ptrs[255], KB(4), MB(64)), "resizing can't move to another block");
+
+  temp.retire();
+  tassert(arena.block == nullptr, "popping should release the chained blocks");
+  tassert(arena.pos() == (u64)(first + KB(16) - arena.base), "pos should be restored");
+
+  auto* big = (u8*)alloc.allocate(MB(1), 1);
+  tassert(big != nullptr && big[MB(1) - 1] == 0, "allocations bigger than a block should get their own block");
+  arena.reset();
+  tassert(arena.block == nullptr && arena.pos() == 0, "reset should go back to the first block");
+}
+
+TEST(chained arena spare block) {
+  auto& arena = core::arena_alloc(KB(64), {.min_commit = KB(64), .retain = KB(512), .idle_resets = 4});
+  defer { core::arena_dealloc(arena); };
+
+  // a frame that peaks just past the first block
+  auto frame = [&] {
+    arena.allocate(KB(96), 1, "test");
+    arena.allocate(KB(48), 1, "test");
+    tassert(arena.block != nullptr, "the frame should not fit in the first block");
+    arena.reset();
+  };
+  frame();
+  core::ArenaBlock* spare = arena.spare;
+  tassert(spare != nullptr, "the popped block should be kept");
+
+  auto before = os::mem_stats();
+  for (usize i = 0; i < 16; i++) {
+    frame();
+    tassert(arena.spare == spare, "steady frames should reuse the same block");
+  }
+  auto after = os::mem_stats();
+  tassert(after.commit_count == before.commit_count, "steady frames should not commit");
+  tassert(after.decommit_count == before.decommit_count, "steady frames should not decommit");
+
+  // smaller frames let it go after idle_resets resets
+  for (usize i = 0; i < 3; i++) {
+    arena.allocate(KB(16), 1, "test");
+    arena.reset();
+    tassert(arena.spare != nullptr, "the spare block should be kept until idle_resets resets");
+  }
+  arena.reset();
+  tassert(arena.spare == nullptr, "an unused spare block should be released");
+
+  frame();
+  arena.trim();
+  tassert(arena.spare == nullptr, "trim should release the spare block");
+}
+
+TEST(chained arena spare block zeroing) {
+  auto& arena = core::arena_alloc(KB(64), {.min_commit = KB(64), .retain = KB(512)});
+  defer { core::arena_dealloc(arena); };
+
+  // dirty a chained block, then pop it so that it becomes the spare
+  arena.allocate(KB(48), 1, "test");
+  auto* dirty = (u8*)arena.allocate_uninit(KB(96), 1, "test");
+  tassert(arena.block != nullptr, "the allocation should not fit in the first block");
+  memset(dirty, 0xFF, KB(96));
+  arena.reset();
+  tassert(arena.spare != nullptr, "the popped block should be kept");
+
+  arena.allocate(KB(48), 1, "test");
+  auto* p = (u8*)arena.allocate(KB(96), 1, "test");
+  tassert(p == dirty, "the spare block should be reused");
+  for (usize i = 0; i < KB(96); i++) {
+    tassert(p[i] == 0, "memory from a reused spare block should be cleared at %zu", i);
+  }
+}
+
+TEST(scratch nesting) {
+  auto a = core::scratch_get();
+  auto b = core::scratch_get();
+  auto c = core::scratch_get();
+  tassert(&*a != &*b && &*b != &*c && &*a != &*c, "nested scratches should be different arenas");
+  a->allocate(KB(1), 1, "test");
+}
+
+// Holds a scratch on count more arenas while f runs
+template <class F>
+static void hold_scratches(usize count, F&& f) {
+  if (count == 0) {
+    f();
+    return;
+  }
+  auto held = core::scratch_get();
+  hold_scratches(count - 1, f);
+}
+
+TEST(scratch conflicts) {
+  auto stats_before = core::scratch_stats();
+
+  auto a  = core::scratch_get();
+  auto* x = (u32*)a->allocate(sizeof(u32), 4, "test");
+  *x      = 42;
+  {
+    auto b = core::scratch_get(a);
+    auto c = core::scratch_get(a);
+    tassert(&*b != &*a && &*c != &*a, "a conflict should never be handed out");
+    tassert(&*b != &*c, "an unused arena should be preferred over sharing one");
+    {
+      auto d = core::scratch_get(a, b);
+      tassert(&*d != &*a && &*d != &*b, "conflicts should never be handed out");
+    }
+  }
+  {
+    auto b  = core::scratch_get(a);
+    auto* y = (u32*)b->allocate(sizeof(u32), 4, "test");
+    *y      = 1;
+
+    // with every other arena in use, c has to share the arena of b
+    hold_scratches(SCRATCH_ARENA_AMOUNT - 2, [&] {
+      auto c = core::scratch_get(a);
+      tassert(&*c == &*b, "c should share the arena of b");
+
+      u64 shared_pos = b->pos();
+      b->allocate(KB(1), 1, "test");
+      c->allocate(KB(4), 1, "test");
+      c.retire();
+      tassert(b->pos() == shared_pos, "retiring c should free what was allocated on the arena since it was acquired");
+    });
+    tassert(*y == 1, "retiring c should not free what b allocated before c was acquired");
+  }
+  tassert(*x == 42, "a should not be touched");
+
+  auto stats = core::scratch_stats();
+  tassert(stats.get_count - stats_before.get_count == SCRATCH_ARENA_AMOUNT + 3, "invalid get count");
+  tassert(stats.shared_count - stats_before.shared_count == 1, "invalid shared count");
+  tassert(stats.max_live_count >= SCRATCH_ARENA_AMOUNT + 1, "invalid max live count");
+  tassert(stats.arena_count <= SCRATCH_ARENA_AMOUNT, "invalid arena count");
+}
+
+TEST(scratch tracked conflicts) {
+  auto a       = core::scratch_get();
+  auto tracked = core::tracked_allocator(*a, "test scratch");
+  tassert(tracked.arena() == &*a, "a tracked allocator should give the arena it wraps");
+  tassert(core::get_named_allocator(core::AllocatorName::General).arena() == nullptr, "General is not an arena");
+
+  auto b = core::scratch_get(tracked);
+  tassert(&*b != &*a, "a tracked scratch arena should be a conflict");
+}
+
+TEST(inflight frame arenas) {
+  core::inflight_frame_begin(0);
+  auto* a = (u32*)core::get_named_allocator(core::AllocatorName::FrameInflight).allocate(sizeof(u32));
+  *a      = 42;
+
+  core::inflight_frame_begin(1);
+  auto* b = (u32*)core::get_named_allocator(core::AllocatorName::FrameInflight).allocate(sizeof(u32));
+  tassert(a != b, "each frame in flight should have its own arena");
+  tassert(*a == 42, "the data of a frame should live until its frame_id comes back");
+
+  core::inflight_frame_begin(0);
+  tassert(core::get_named_arena(core::ArenaName::FrameInflight).pos() == 0, "the arena should be reset");
+  core::inflight_frame_end();
+}
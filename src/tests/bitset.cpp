@@ -0,0 +1,79 @@
+#include "tests.h"
+
+#include <core/containers/bitset.h>
+#include <core/core.h>
+
+TEST(bitset) {
+  core::bitset<200> b;
+  tassert(b.none() && b.count() == 0, "a new bitset should be empty");
+  tassert(*b.find_first_unset() == 0 && b.find_first_set().is_none(), "invalid find on an empty bitset");
+
+  b.set(3);
+  b.set(64);
+  b.set(130);
+  b.set(199);
+  tassert(b.test(64) && !b.test(65) && b.count() == 4, "invalid set");
+  tassert(*b.find_first_set() == 3 && *b.find_first_set(4) == 64 && *b.find_first_set(131) == 199, "find_first_set");
+
+  usize expected[] = {3, 64, 130, 199};
+  usize n          = 0;
+  for (auto i : b.iter()) {
+    tassert(n < ARRAY_SIZE(expected) && i == expected[n], "iter should give the set bits in order");
+    n++;
+  }
+  tassert(n == 4, "iter should give every set bit");
+
+  b.set_all();
+  tassert(b.count() == 200 && b.find_first_unset().is_none(), "set_all should not set the bits past the size");
+  b.unset(150);
+  tassert(*b.find_first_unset() == 150, "find_first_unset should skip the full words");
+}
+
+TEST(bitset bulk ops) {
+  core::bitset<1000> a, b;
+  for (usize i = 0; i < 1000; i += 2) {
+    a.set(i);
+  }
+  for (usize i = 0; i < 1000; i += 3) {
+    b.set(i);
+  }
+
+  auto c = a;
+  c &= b;
+  for (usize i = 0; i < 1000; i++) {
+    tassert(c.test(i) == (i % 6 == 0), "and at %zu", i);
+  }
+  c  = a;
+  c |= b;
+  for (usize i = 0; i < 1000; i++) {
+    tassert(c.test(i) == (i % 2 == 0 || i % 3 == 0), "or at %zu", i);
+  }
+  c = a;
+  c.andnot(b);
+  for (usize i = 0; i < 1000; i++) {
+    tassert(c.test(i) == (i % 2 == 0 && i % 3 != 0), "andnot at %zu", i);
+  }
+}
+
+TEST(dyn bitset) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::dyn_bitset b;
+  defer { b.reset(alloc); };
+
+  b.resize(alloc, 100);
+  b.set_all();
+  tassert(b.count() == 100, "invalid count");
+
+  // shrinking then growing again does not bring old bits back
+  b.resize(alloc, 70);
+  tassert(b.count() == 70, "shrinking should drop the bits past the size");
+  b.resize(alloc, 1000);
+  tassert(b.count() == 70 && *b.find_first_unset() == 70, "the new bits should be unset");
+
+  core::bitset<1000> mask;
+  mask.set(10);
+  mask.set(900);
+  b.set(900);
+  b &= mask;
+  tassert(b.count() == 2 && *b.find_first_set() == 10 && *b.find_first_set(11) == 900, "dyn & fixed");
+}
@@ -0,0 +1,110 @@
+#include "tests.h"
+
+#include <core/core.h>
+#include <core/core/coro.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+core::task<u32> add(core::Allocator alloc, u32 a, u32 b) {
+  co_await core::next_tick{};
+  co_return a + b;
+}
+
+core::task<u32> sum_to(core::Allocator alloc, u32 n) {
+  u32 sum = 0;
+  for (u32 i = 1; i <= n; i++) {
+    sum = co_await add(alloc, sum, i);
+  }
+  co_return sum;
+}
+
+core::task<> pipeline(core::Allocator alloc, u32* out, usize* steps) {
+  // a child that returns without suspending
+  u32 zero = co_await sum_to(alloc, 0);
+  *out     = zero + co_await sum_to(alloc, 4);
+  (*steps)++;
+}
+
+core::TaskReturn stop_now(std::atomic<usize>* counter, core::TaskQueue*) {
+  counter->fetch_add(1);
+  return core::TaskReturn::Stop;
+}
+
+core::task<> wait_children(core::TaskQueue* queue, std::atomic<usize>* counter, bool* done) {
+  core::Job children[16];
+  core::JobCounter all;
+  for (auto& child : children) {
+    child.init(core::Task::from(stop_now, counter, core::TaskAffinity::Worker), &all);
+    queue->launch(child);
+  }
+  co_await core::job_done(all);
+  *done = true;
+}
+} // namespace
+
+TEST(coroutine tasks) {
+  core::TaskQueue queue{};
+  auto scratch          = core::scratch_get();
+  core::Allocator alloc = scratch;
+
+  u32 result  = 0;
+  usize steps = 0;
+  auto* task  = core::spawn(queue, pipeline(alloc, &result, &steps));
+  tassert(result == 0, "a task should not start before its first tick");
+
+  // one tick to start, then one per next_tick
+  usize ticks = 0;
+  while (task->status != core::TaskStatus::Stopped) {
+    queue.run();
+    ticks++;
+    tassert(ticks < 100, "the task should be done");
+  }
+  tassert(result == 10, "1 + 2 + 3 + 4 should be 10, got %u", result);
+  tassert(steps == 1, "the pipeline should have run once");
+  tassert(ticks == 5, "the pipeline should have taken 5 ticks, took %zu", ticks);
+  queue.deallocate_job(task);
+}
+
+TEST(coroutine frames) {
+  auto scratch = core::scratch_get();
+  core::Arena& arena = *scratch;
+
+  // frames from the allocator parameter
+  u64 pos = arena.pos();
+  {
+    auto t = add(arena, 1, 2);
+    tassert(arena.pos() > pos, "the frame should be in the arena");
+  }
+
+  // frames without allocator are recycled
+  auto no_alloc = [](u32 v) -> core::task<u32> { co_return v; };
+  void* first;
+  {
+    auto t = no_alloc(1);
+    first  = t.handle.address();
+  }
+  {
+    auto t = no_alloc(2);
+    tassert(t.handle.address() == first, "the frame should have been recycled");
+  }
+}
+
+TEST(coroutine child jobs) {
+  core::TaskQueue queue{};
+  queue.start_workers(2);
+
+  std::atomic<usize> counter{};
+  bool done  = false;
+  auto* task = core::spawn(queue, wait_children(&queue, &counter, &done));
+  while (task->status != core::TaskStatus::Stopped) {
+    queue.run();
+    std::this_thread::yield();
+  }
+  tassert(done, "the coroutine should be done");
+  tassert(counter == 16, "every child job should have run, %zu did", counter.load());
+
+  queue.deallocate_job(task);
+  queue.stop_workers();
+}
@@ -0,0 +1,77 @@
+#include "tests.h"
+
+#include <core/containers/deque.h>
+#include <core/core.h>
+
+TEST(deque fifo) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::deque<usize> d;
+  defer { d.reset(alloc); };
+
+  for (usize i = 0; i < 1000; i++) {
+    d.push_back(alloc, i);
+    if (i % 3 == 2) {
+      usize front = d.pop_front();
+      tassert(front == i / 3, "pop_front should keep the push order, got %zu", front);
+    }
+  }
+  tassert(std::has_single_bit(d.capacity()) && d.capacity() >= d.size(), "invalid capacity %zu", d.capacity());
+  for (auto [i, x] : core::enumerate{d.iter()}) {
+    tassert(*x == 1000 / 3 + i, "d[%zu] == %zu", i, *x);
+  }
+}
+
+TEST(deque both ends) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::deque<usize> d;
+  defer { d.reset(alloc); };
+
+  for (usize i = 0; i < 100; i++) {
+    d.push_front(alloc, i);
+    d.push_back(alloc, 1000 + i);
+  }
+  tassert(d.size() == 200, "invalid size");
+  tassert(*d.front() == 99 && *d.back() == 1099, "invalid ends");
+  for (usize i = 0; i < 100; i++) {
+    tassert(d[i] == 99 - i && d[100 + i] == 1000 + i, "invalid order at %zu", i);
+  }
+
+  for (usize i = 0; i < 100; i++) {
+    tassert(d.pop_back() == 1099 - i, "pop_back");
+    tassert(d.pop_front() == 99 - i, "pop_front");
+  }
+  tassert(d.size() == 0 && d.front().is_none(), "the deque should be empty");
+}
+
+TEST(deque slices) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::deque<u32> d;
+  defer { d.reset(alloc); };
+  d.reserve(alloc, 16);
+  tassert(d.capacity() == 16, "invalid capacity");
+
+  // wrap around the end of the ring
+  for (u32 i = 0; i < 12; i++) {
+    d.push_back(core::noalloc, i);
+  }
+  for (u32 i = 0; i < 10; i++) {
+    d.pop_front();
+  }
+  for (u32 i = 12; i < 20; i++) {
+    d.push_back(core::noalloc, i);
+  }
+
+  auto s = d.as_slices();
+  tassert(s.first.size == 6 && s.second.size == 4, "invalid slices %zu %zu", s.first.size, s.second.size);
+  u32 out[10];
+  memcpy(out, s.first.data, s.first.size * sizeof(u32));
+  memcpy(out + s.first.size, s.second.data, s.second.size * sizeof(u32));
+  for (u32 i = 0; i < 10; i++) {
+    tassert(out[i] == 10 + i, "out[%u] == %u", i, out[i]);
+  }
+
+  // growing makes the elements contiguous again
+  d.reserve(alloc, 32);
+  s = d.as_slices();
+  tassert(s.first.size == 10 && s.second.size == 0 && s.first[0] == 10, "growing should keep the order");
+}
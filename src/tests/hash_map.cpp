@@ -0,0 +1,96 @@
+#include "tests.h"
+
+#include <core/containers/hash_map.h>
+#include <core/core.h>
+
+#include <unordered_map>
+
+TEST(hash map) {
+  auto scratch = core::scratch_get();
+
+  core::hash_map<u64, u64> m;
+  tassert(m.get(0).is_none(), "empty map should not contain anything");
+
+  for (u64 i = 0; i < 1000; i++) {
+    m.insert(scratch, i * 7, i);
+  }
+  tassert(m.size() == 1000, "invalid size");
+  tassert(m.size() <= m.capacity() / 8 * 7, "load factor should stay under 7/8");
+  for (u64 i = 0; i < 1000; i++) {
+    tassert(m.get(i * 7).is_some() && *m.get(i * 7) == i, "m[%zu] should be %zu", i * 7, i);
+    tassert(!m.contains(i * 7 + 1), "%zu should not be in the map", i * 7 + 1);
+  }
+
+  m.insert(scratch, 7, 42);
+  tassert(m.size() == 1000 && *m.get(7) == 42, "insert should overwrite");
+  tassert(m.get_or_insert(scratch, 7, 0) == 42, "get_or_insert should not overwrite");
+
+  usize count = 0;
+  u64 sum     = 0;
+  for (auto& e : m.iter()) {
+    count++;
+    sum += e.value;
+  }
+  tassert(count == 1000 && sum == 999 * 1000 / 2 - 1 + 42, "iteration should see every entry once");
+
+  for (u64 i = 0; i < 1000; i += 2) {
+    tassert(m.remove(i * 7).is_some(), "%zu should be removed", i * 7);
+  }
+  tassert(m.remove(0).is_none(), "0 is already removed");
+  tassert(m.size() == 500, "invalid size");
+  for (u64 i = 1; i < 1000; i += 2) {
+    tassert(m.contains(i * 7), "%zu should still be in the map", i * 7);
+  }
+
+  m.clear();
+  tassert(m.size() == 0 && m.get(7).is_none(), "clear should remove everything");
+  m.reset(scratch);
+}
+
+// Every key lands in the same cluster, removing has to shift the entries back
+struct colliding_hash {
+  u64 operator()(u64 k) const {
+    return k % 3;
+  }
+};
+
+TEST(hash map removal) {
+  auto scratch = core::scratch_get();
+
+  core::hash_map<u64, u64, colliding_hash> m;
+  std::unordered_map<u64, u64> reference;
+
+  u64 state = 12345;
+  for (usize i = 0; i < 20000; i++) {
+    state   = state * 6364136223846793005 + 1442695040888963407;
+    u64 key = (state >> 33) % 256;
+    if ((state >> 20) % 3 == 0) {
+      tassert(m.remove(key).is_some() == (reference.erase(key) == 1), "remove of %zu disagrees", key);
+    } else {
+      m.insert(scratch, key, i);
+      reference[key] = i;
+    }
+  }
+
+  tassert(m.size() == reference.size(), "invalid size");
+  for (auto& [k, v] : reference) {
+    tassert(m.get(k).is_some() && *m.get(k) == v, "m[%zu] should be %zu", k, v);
+  }
+
+  // the removals shift colliding entries back over the slots being scanned
+  m.remove_if([](u64, u64 v) { return v % 2 == 0; });
+  std::erase_if(reference, [](auto& kv) { return kv.second % 2 == 0; });
+  tassert(m.size() == reference.size(), "remove_if should remove the even values");
+  for (auto& [k, v] : reference) {
+    tassert(m.get(k).is_some() && *m.get(k) == v, "m[%zu] should be kept", k);
+  }
+}
+
+TEST(hash map str8) {
+  auto scratch = core::scratch_get();
+
+  core::hash_map<core::str8, u32> m;
+  m.insert(scratch, "a"_s, 1);
+  m.insert(scratch, "b"_s, 2);
+  tassert(*m.get("a"_s) == 1 && *m.get("b"_s) == 2 && m.get("c"_s).is_none(), "str8 keys");
+}
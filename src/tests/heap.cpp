@@ -0,0 +1,173 @@
+#include "tests.h"
+
+#include <core/containers/vec.h>
+#include <core/core.h>
+#include <thread>
+
+TEST(heap sizes) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  for (usize size = 1; size <= MB(1); size = size * 3 / 2 + 1) {
+    auto* p = (u8*)alloc.allocate(size, 1);
+    tassert(p != nullptr, "allocation of %zu bytes failed", size);
+    tassert(alloc.owns(p) && alloc.owns(p + size - 1), "heap should own its allocation of %zu bytes", size);
+    tassert(((uptr)p & (max_align - 1)) == 0, "allocation of %zu bytes is missaligned", size);
+    for (usize i = 0; i < size; i++) {
+      tassert(p[i] == 0, "allocation of %zu bytes is not zeroed at %zu", size, i);
+    }
+    memset(p, 0xAB, size);
+    alloc.deallocate(p, size);
+  }
+
+  int on_stack;
+  tassert(!alloc.owns(&on_stack), "heap should not own a stack pointer");
+}
+
+TEST(heap alignement) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  for (usize alignement = 1; alignement <= KB(64); alignement *= 2) {
+    for (usize size : {1zu, 24zu, 100zu, KB(3zu), KB(40zu)}) {
+      void* p = alloc.allocate(size, alignement);
+      tassert(((uptr)p & (alignement - 1)) == 0, "allocation of %zu bytes is not aligned to %zu", size, alignement);
+      alloc.deallocate(p, size);
+    }
+  }
+}
+
+TEST(heap reuse is zeroed) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  core::array<u8*, 64> ptrs{};
+  for (auto& p : ptrs.iter()) {
+    p = (u8*)alloc.allocate(96);
+    memset(p, 0xFF, 96);
+  }
+  for (auto p : ptrs.iter()) {
+    alloc.deallocate(p, 96);
+  }
+
+  for (auto& p : ptrs.iter()) {
+    p = (u8*)alloc.allocate(96);
+    for (usize i = 0; i < 96; i++) {
+      tassert(p[i] == 0, "recycled block is not zeroed");
+    }
+  }
+  for (auto p : ptrs.iter()) {
+    alloc.deallocate(p, 96);
+  }
+}
+
+TEST(heap uninit) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  auto* a = (u8*)alloc.allocate_uninit(200);
+  memset(a, 0xFF, 200);
+  alloc.deallocate(a, 200);
+
+  auto* b = (u8*)alloc.allocate(200);
+  tassert(b == a, "the thread cache should give back the last freed block");
+  for (usize i = 0; i < 200; i++) {
+    tassert(b[i] == 0, "allocate should clear recycled blocks");
+  }
+  alloc.deallocate(b, 200);
+}
+
+TEST(heap resize) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  // 20 bytes live in the 32 bytes class
+  auto* small = (u8*)alloc.allocate(20);
+  memset(small, 1, 20);
+  tassert(alloc.try_resize(small, 20, 32), "small allocation should grow inside its class");
+  tassert(small[19] == 1 && small[20] == 0 && small[31] == 0, "in place growth should keep data and zero the rest");
+  tassert(!alloc.try_resize(small, 32, 33), "small allocation can't grow past its class");
+  tassert(alloc.try_resize(small, 32, 0), "resizing to 0 frees");
+
+  auto* large = (u8*)alloc.allocate(KB(100));
+  memset(large, 2, KB(100));
+  tassert(alloc.try_resize(large, KB(100), KB(120)), "large allocation should grow inside its run");
+  tassert(large[KB(100) - 1] == 2 && large[KB(120) - 1] == 0, "large growth should keep data and zero the rest");
+
+  tassert(alloc.try_resize(large, KB(120), KB(64)), "shrinking always works");
+  tassert(alloc.try_resize(large, KB(64), KB(120)), "growing back after shrinking");
+  tassert(large[KB(64)] == 0 && large[KB(120) - 1] == 0, "growing back should zero what was left before");
+  alloc.deallocate(large, KB(120));
+}
+
+TEST(heap large runs are coalesced) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  // big enough that no free run left by the other tests fits the merged size
+  const usize size = MB(16);
+  auto* a          = (u8*)alloc.allocate_uninit(size);
+  auto* b          = (u8*)alloc.allocate_uninit(size);
+  auto* c          = (u8*)alloc.allocate_uninit(size);
+  auto* guard      = (u8*)alloc.allocate_uninit(size);
+  tassert(b == a + size && c == b + size && guard == c + size, "runs should be taken from the frontier");
+
+  // b is merged with the free runs on both sides
+  alloc.deallocate(a, size);
+  alloc.deallocate(c, size);
+  alloc.deallocate(b, size);
+  auto* merged = (u8*)alloc.allocate_uninit(3 * size);
+  tassert(merged == a, "the free runs should have been merged");
+  alloc.deallocate(merged, 3 * size);
+
+  // the frontier takes back the free run before the last one
+  alloc.deallocate(guard, size);
+  auto* again = (u8*)alloc.allocate_uninit(4 * size);
+  tassert(again == a, "the frontier should have absorbed the free run before it");
+  alloc.deallocate(again, 4 * size);
+}
+
+TEST(heap vec) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  core::vec<u32> v{};
+  for (u32 i = 0; i < 100000; i++) {
+    v.push(alloc, i);
+  }
+  for (u32 i = 0; i < 100000; i++) {
+    tassert(v[i] == i, "vec content has been corrupted at %u", i);
+  }
+  v.reset(alloc);
+}
+
+TEST(heap threads) {
+  const usize thread_count = 8;
+  const usize round_count  = 64;
+  const usize alloc_count  = 256;
+
+  core::array<std::thread, thread_count> threads{};
+  std::atomic<usize> errors{};
+  for (auto [thread_idx, thread] : core::enumerate{threads.iter()}) {
+    *thread = std::thread([&errors, thread_idx] {
+      auto alloc = core::get_named_allocator(core::AllocatorName::General);
+      core::array<u8*, alloc_count> ptrs{};
+
+      for (usize round = 0; round < round_count; round++) {
+        for (auto [i, p] : core::enumerate{ptrs.iter()}) {
+          usize size = 8 + (i * 37 + round) % 2048;
+          *p         = (u8*)alloc.allocate(size);
+          memset(*p, (int)thread_idx + 1, size);
+        }
+        for (auto [i, p] : core::enumerate{ptrs.iter()}) {
+          usize size = 8 + (i * 37 + round) % 2048;
+          for (usize j = 0; j < size; j++) {
+            if ((*p)[j] != thread_idx + 1) {
+              errors.fetch_add(1);
+              break;
+            }
+          }
+          alloc.deallocate(*p, size);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads.iter()) {
+    thread.join();
+  }
+
+  tassert(errors.load() == 0, "%zu allocations have been overwritten by another thread", errors.load());
+}
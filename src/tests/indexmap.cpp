@@ -1,6 +1,7 @@
 #include "core/core.h"
 #include "tests.h"
 #include <core/containers/handle_map.h>
+#include <core/containers/handle_soa_map.h>
 
 TEST(handle map adapter compiles) {
   core::handle_map_adapter im{};
@@ -117,3 +118,64 @@ TEST(handle_map iter) {
   tassert(h2access, "h2 accesed");
   tassert(h1access, "h1 accesed");
 }
+
+TEST(handle_soa_map) {
+  auto scratch          = core::scratch_get();
+  core::Allocator alloc = scratch;
+
+  core::handle_soa_map<u32, f32, u8> a;
+  core::vec<decltype(a)::handle> hs;
+  for (u32 i = 0; i < 100; i++) {
+    hs.push(alloc, a.insert(alloc, i, (f32)i * 0.5f, (u8)i));
+  }
+  tassert(a.size() == 100, "invalid size");
+  for (u32 i = 0; i < 100; i += 3) {
+    tassert(*a.get<0>(hs[i]) == i && *a.get<1>(hs[i]) == (f32)i * 0.5f, "invalid row %u", i);
+  }
+  tassert((uptr)a.column<1>().data % HANDLE_SOA_COLUMN_ALIGN == 0, "columns should be aligned");
+
+  // swap delete keeps the other handles valid
+  for (u32 i = 0; i < 100; i += 2) {
+    a.destroy(hs[i]);
+  }
+  tassert(a.size() == 50, "invalid size after destroy");
+  for (u32 i = 0; i < 100; i++) {
+    auto v = a.get<2>(hs[i]);
+    tassert(v.is_some() == (i % 2 == 1), "handle %u should %s", i, i % 2 ? "resolve" : "be stale");
+    tassert(v.is_none() || *v == i, "invalid value for %u", i);
+  }
+
+  // the rows and the handles column agree
+  for (auto [row, h] : core::enumerate{a.handles().iter()}) {
+    tassert(*a.row_of(*h) == row, "row_of should match the handles column");
+  }
+  u32 sum = 0;
+  for (auto [x, y] : a.iter<0, 2>()) {
+    tassert(x == y, "iter<0, 2> should zip the rows");
+    sum += x;
+  }
+  tassert(sum == 50 * 50, "iter should go over every row, sum is %u", sum);
+
+  // reused slots get a new generation
+  auto h = a.insert(alloc, 7, 0.f, 7);
+  tassert(a.get<0>(hs[0]).is_none() && *a.get<0>(h) == 7, "a stale handle should not see a reused slot");
+}
+
+TEST(handle_soa_map generations) {
+  auto scratch          = core::scratch_get();
+  core::Allocator alloc = scratch;
+
+  // 4 bits of generation: the 16th reuse of a slot wraps
+  using layout = core::handle_soa_layout<core::handle_t<void, u16>, 12>;
+  core::basic_handle_soa_map<layout, u32> a;
+  auto first = a.insert(alloc, 0);
+  a.destroy(first);
+  for (u32 i = 1; i < 16; i++) {
+    auto h = a.insert(alloc, i);
+    tassert(layout::index(h) == layout::index(first) && layout::generation(h) == i, "invalid generation");
+    tassert(a.get<0>(first).is_none(), "the first handle should be stale");
+    a.destroy(h);
+  }
+  auto wrapped = a.insert(alloc, 16);
+  tassert(layout::generation(wrapped) == 0, "the generation should wrap after 2^4 reuses");
+}
@@ -0,0 +1,79 @@
+#include "tests.h"
+
+#include <core/core.h>
+#include <core/core/memory_tracker.h>
+
+static const core::MemTrackerStats* find_tracker(core::MemTrackingSnapshot& snapshot, const char* name) {
+  for (auto& t : snapshot.trackers.iter()) {
+    if (strcmp(t.name, name) == 0) {
+      return &t;
+    }
+  }
+  return nullptr;
+}
+
+static const core::MemTagStats* find_tag(const core::MemTrackerStats& tracker, const char* tag) {
+  for (auto& t : tracker.tags.iter()) {
+    if (strcmp(t.tag, tag) == 0) {
+      return &t;
+    }
+  }
+  return nullptr;
+}
+
+TEST(memory tracker tags) {
+  auto alloc = core::tracked_allocator(core::get_named_allocator(core::AllocatorName::General), "test general");
+  auto scratch = core::scratch_get();
+
+  void* a = alloc.allocate(100, 8, "tag a");
+  void* b = alloc.allocate(200, 8, "tag a");
+  void* c = alloc.allocate(KB(64), 8, "tag b");
+  alloc.deallocate(b, 200);
+
+  auto snapshot = core::mem_tracking_snapshot(*scratch);
+  auto* tracker = find_tracker(snapshot, "test general");
+  tassert(tracker != nullptr, "tracker should be in the snapshot");
+  tassert(tracker->live_bytes == 100 + KB(64) && tracker->live_count == 2, "invalid live stats");
+  tassert(tracker->high_water == 300 + KB(64), "invalid high water");
+  tassert(tracker->tags[0].live_bytes == KB(64), "tags should be sorted by live bytes");
+
+  auto* tag_a = find_tag(*tracker, "tag a");
+  tassert(tag_a != nullptr && tag_a->live_bytes == 100 && tag_a->high_water == 300, "invalid tag stats");
+  tassert(tag_a->total_count == 2, "invalid tag total count");
+
+  alloc.deallocate(a, 100);
+  alloc.deallocate(c, KB(64));
+}
+
+TEST(memory tracker arena) {
+  auto& arena = core::arena_alloc(MB(1));
+  defer { core::arena_dealloc(arena); };
+  core::track_arena(arena, "test arena");
+  auto alloc = core::tracked_allocator(arena, "test arena");
+
+  alloc.allocate(KB(4), 8, "frame data");
+  alloc.allocate(KB(4), 8, "frame data");
+  auto scratch = core::scratch_get();
+  {
+    auto snapshot = core::mem_tracking_snapshot(*scratch);
+    auto* tracker = find_tracker(snapshot, "test arena");
+    tassert(tracker != nullptr && tracker->live_bytes == KB(8), "arena allocations should be tracked");
+
+    bool found = false;
+    for (auto& a : snapshot.arenas.iter()) {
+      if (strcmp(a.name, "test arena") == 0) {
+        found = true;
+        tassert(a.used >= KB(8) && a.committed >= a.used && a.reserved >= a.committed, "invalid arena usage");
+      }
+    }
+    tassert(found, "tracked arena should be in the snapshot");
+  }
+
+  arena.reset();
+  {
+    auto snapshot = core::mem_tracking_snapshot(*scratch);
+    auto* tracker = find_tracker(snapshot, "test arena");
+    tassert(tracker->live_bytes == 0, "a reset should free the arena allocations");
+    tassert(tracker->high_water == KB(8), "high water should survive the reset");
+  }
+}
@@ -0,0 +1,83 @@
+#include "tests.h"
+
+#include <core/core.h>
+#include <core/core/parallel.h>
+#include <core/core/sched.h>
+
+namespace {
+void parallel_checks() {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+  const usize count = 100003;
+  auto data         = alloc.allocate_array<u32>(count);
+  defer { alloc.deallocate(data.data, data.size * sizeof(u32)); };
+
+  // chunks cover the storage exactly once, on cache line boundaries
+  core::parallel_for(data, 1000, [](core::storage<u32> chunk, usize first, core::Arena& scratch) {
+    auto* tmp = (u32*)scratch.allocate(chunk.size * sizeof(u32), alignof(u32), "test");
+    for (usize i = 0; i < chunk.size; i++) {
+      tmp[i] = (u32)(first + i);
+    }
+    for (usize i = 0; i < chunk.size; i++) {
+      chunk[i] += tmp[i] + 1;
+    }
+  });
+  for (usize i = 0; i < count; i++) {
+    tassert(data[i] == i + 1, "data[%zu] should be %zu, is %u", i, i + 1, data[i]);
+  }
+
+  core::detail_::parallel_chunks<u32> chunks{data, 1000};
+  tassert(chunks.grain % 16 == 0, "the grain should be a whole number of cache lines");
+  for (usize i = 1; i < chunks.count; i++) {
+    tassert((uptr)&data[chunks.begin(i)] % 64 == 0, "chunk %zu should start on a cache line", i);
+  }
+
+  u64 sum = core::parallel_reduce(
+      data, 1000, 0ull,
+      [](core::storage<u32> chunk, usize, core::Arena&) {
+        u64 s = 0;
+        for (auto v : chunk.iter()) {
+          s += v;
+        }
+        return s;
+      },
+      [](u64 a, u64 b) { return a + b; }
+  );
+  tassert(sum == (u64)count * (count + 1) / 2, "sum should be %zu, is %zu", (usize)count * (count + 1) / 2, sum);
+
+  // in place, then out of place
+  for (auto& v : data.iter()) {
+    v = 1;
+  }
+  core::parallel_scan(data, 1000, 0u, [](u32 a, u32 b) { return a + b; });
+  for (usize i = 0; i < count; i++) {
+    tassert(data[i] == i + 1, "scan[%zu] should be %zu, is %u", i, i + 1, data[i]);
+  }
+  auto out = alloc.allocate_array<u32>(count);
+  defer { alloc.deallocate(out.data, out.size * sizeof(u32)); };
+  core::parallel_scan(core::storage<const u32>{data.size, data.data}, out, 1000, 0u, [](u32 a, u32 b) {
+    return MAX(a, b);
+  });
+  for (usize i = 0; i < count; i++) {
+    tassert(out[i] == i + 1, "max scan[%zu] should be %zu, is %u", i, i + 1, out[i]);
+  }
+
+  // small inputs run inline
+  u32 small[3]{1, 2, 3};
+  usize calls = 0;
+  core::parallel_for(core::storage<u32>{3, small}, 1000, [&](core::storage<u32> chunk, usize, core::Arena&) {
+    calls++;
+  });
+  tassert(calls == 1, "a small input should be one chunk");
+}
+} // namespace
+
+TEST(parallel inline) {
+  parallel_checks();
+}
+
+TEST(parallel workers) {
+  auto* queue = core::default_task_queue();
+  queue->start_workers(3);
+  parallel_checks();
+  queue->stop_workers();
+}
@@ -0,0 +1,40 @@
+#include "tests.h"
+
+#include <core/containers/pool.h>
+#include <core/core.h>
+
+TEST(pool) {
+  auto scratch = core::scratch_get();
+
+  core::pool<usize> p;
+  usize* items[200];
+  for (usize i = 0; i < 200; i++) {
+    items[i]  = &p.allocate(scratch);
+    *items[i] = i;
+  }
+  tassert(p.size() == 200 && p.chunk_count == 4, "invalid size");
+
+  for (usize i = 0; i < 200; i += 2) {
+    p.deallocate(scratch, *items[i]);
+  }
+  usize sum = 0, count = 0;
+  for (auto& t : p.iter()) {
+    tassert(t % 2 == 1, "%zu should have been deallocated", t);
+    sum += t;
+    count++;
+  }
+  tassert(count == 100 && sum == 100 * 100, "iteration should visit every live item once");
+
+  // freed slots are reused, live items do not move
+  usize* reused = &p.allocate(scratch);
+  tassert(p.chunk_count == 4, "a free slot should be reused");
+  tassert(*items[1] == 1 && *items[199] == 199, "live items should not move");
+  p.deallocate(scratch, *reused);
+
+  // deallocating the visited item is allowed, empty chunks are released
+  for (auto& t : p.iter()) {
+    p.deallocate(scratch, t);
+  }
+  tassert(p.size() == 0 && p.chunk_count == 1, "empty chunks should be released but the last one");
+  p.reset(scratch);
+}
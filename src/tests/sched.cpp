@@ -1,5 +1,298 @@
 #include "tests.h"
 
+#include <core/core.h>
 #include <core/core/sched.h>
+#include <core/os/time.h>
 
-TEST(Sched) {}
+#include <atomic>
+#include <thread>
+
+namespace {
+struct counter_job {
+  std::atomic<usize>* counter;
+  usize ticks;
+};
+
+core::TaskReturn count_once(counter_job* job, core::TaskQueue*) {
+  job->counter->fetch_add(1);
+  return core::TaskReturn::Stop;
+}
+
+core::TaskReturn count_ticks(counter_job* job, core::TaskQueue*) {
+  job->counter->fetch_add(1);
+  return --job->ticks == 0 ? core::TaskReturn::Stop : core::TaskReturn::Yield;
+}
+} // namespace
+
+TEST(Sched main tasks) {
+  core::TaskQueue queue{};
+  std::atomic<usize> counter{};
+  counter_job job{&counter, 3};
+
+  queue.spawn(core::Task::from(count_ticks, &job));
+  for (usize i = 0; i < 5; i++) {
+    queue.run();
+  }
+  tassert(counter == 3, "the task should have run 3 times, ran %zu", counter.load());
+  tassert(queue.worker_count() == 0, "no worker should have been started");
+}
+
+TEST(Sched worker tasks without workers) {
+  core::TaskQueue queue{};
+  std::atomic<usize> counter{};
+  counter_job job{&counter, 0};
+
+  auto* task = queue.spawn(core::Task::from(count_once, &job, core::TaskAffinity::Worker));
+  tassert(counter == 0, "the task should wait for a run");
+  queue.run();
+  tassert(counter == 1, "the task should have run once, ran %zu", counter.load());
+  tassert(task->status == core::TaskStatus::Stopped, "the task should be stopped");
+  queue.run();
+  tassert(counter == 1, "a stopped task should not run again");
+}
+
+TEST(Sched submit from threads before the workers) {
+  core::TaskQueue queue{};
+  std::atomic<usize> counter{};
+  counter_job job{&counter, 0};
+
+  // submit is open to any thread, the job system exists before start_workers
+  const usize per_thread = 256;
+  core::Task tasks[2][per_thread];
+  std::thread threads[2];
+  for (usize t = 0; t < 2; t++) {
+    threads[t] = std::thread([&, t] {
+      for (auto& task : tasks[t]) {
+        task = core::Task::from(count_once, &job, core::TaskAffinity::Worker);
+        queue.submit(&task);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  queue.run();
+  tassert(counter == 2 * per_thread, "every task should have run once, %zu runs", counter.load());
+}
+
+TEST(Sched workers) {
+  core::TaskQueue queue{};
+  queue.start_workers(2);
+  tassert(queue.worker_count() == 2, "2 workers should be running");
+
+  const usize count = 1000;
+  std::atomic<usize> counter{};
+  counter_job job{&counter, 0};
+  for (usize i = 0; i < count; i++) {
+    queue.spawn(core::Task::from(count_once, &job, core::TaskAffinity::Worker));
+  }
+
+  // a yielding task gets one tick per run
+  std::atomic<usize> ticks{};
+  counter_job ticking{&ticks, 10};
+  auto* ticking_task = queue.spawn(core::Task::from(count_ticks, &ticking, core::TaskAffinity::Worker));
+
+  while (counter.load() < count || ticking_task->status != core::TaskStatus::Stopped) {
+    queue.run();
+    if (!queue.help()) {
+      std::this_thread::yield();
+    }
+  }
+  queue.run();
+  tassert(counter == count, "every task should have run once, %zu runs", counter.load());
+  tassert(ticks == 10, "the yielding task should have run 10 times, ran %zu", ticks.load());
+
+  queue.stop_workers();
+  tassert(queue.worker_count() == 0, "the workers should be stopped");
+
+  // restarting keeps working
+  queue.start_workers(1);
+  for (usize i = 0; i < count; i++) {
+    queue.spawn(core::Task::from(count_once, &job, core::TaskAffinity::Worker));
+  }
+  while (counter.load() < 2 * count) {
+    std::this_thread::yield();
+  }
+  queue.stop_workers();
+  tassert(counter == 2 * count, "every task should have run once, %zu runs", counter.load());
+}
+
+namespace {
+// Records the order the stages of a graph ran in
+struct stage_job {
+  std::atomic<usize>* clock;
+  usize ran_at;
+};
+
+core::TaskReturn stage(stage_job* job, core::TaskQueue*) {
+  job->ran_at = job->clock->fetch_add(1);
+  return core::TaskReturn::Stop;
+}
+
+void job_graph(core::TaskQueue& queue) {
+  std::atomic<usize> clock{};
+  stage_job parse_data{&clock, 0}, decode_data{&clock, 0}, upload_data{&clock, 0};
+  const usize primitive_count = 64;
+  stage_job convert_data[primitive_count];
+
+  // parse -> (decode || convert primitives) -> upload, upload on the main thread
+  core::Job parse, decode, upload;
+  core::Job convert[primitive_count];
+  core::JobCounter converted;
+  parse.init(core::Task::from(stage, &parse_data, core::TaskAffinity::Worker));
+  decode.init(core::Task::from(stage, &decode_data, core::TaskAffinity::Worker));
+  decode.depends_on(parse.done);
+  for (usize i = 0; i < primitive_count; i++) {
+    convert_data[i] = {&clock, 0};
+    convert[i].init(core::Task::from(stage, &convert_data[i], core::TaskAffinity::Worker), &converted);
+    convert[i].depends_on(parse.done);
+  }
+  upload.init(core::Task::from(stage, &upload_data));
+  upload.depends_on(decode.done);
+  upload.depends_on(converted);
+
+  // launched in reverse, nothing runs before its dependencies
+  queue.launch(upload);
+  for (auto& job : convert) {
+    queue.launch(job);
+  }
+  queue.launch(decode);
+  tassert(clock == 0, "nothing should run before parse is launched");
+  queue.launch(parse);
+  queue.wait(upload.done);
+
+  tassert(clock == primitive_count + 3, "every stage should have run once, %zu ran", clock.load());
+  tassert(parse_data.ran_at == 0, "parse should run first");
+  tassert(upload_data.ran_at == primitive_count + 2, "upload should run last");
+  tassert(converted.is_zero(), "every primitive should be converted");
+
+  // a dependency that is already done does not hold the job
+  core::Job late;
+  stage_job late_data{&clock, 0};
+  late.init(core::Task::from(stage, &late_data, core::TaskAffinity::Worker));
+  late.depends_on(parse.done);
+  queue.launch(late);
+  queue.wait(late.done);
+  tassert(late_data.ran_at == primitive_count + 3, "the late job should have run");
+}
+} // namespace
+
+TEST(Sched job graph without workers) {
+  core::TaskQueue queue{};
+  job_graph(queue);
+}
+
+TEST(Sched job graph) {
+  core::TaskQueue queue{};
+  queue.start_workers(2);
+  for (usize i = 0; i < 16; i++) {
+    job_graph(queue);
+  }
+  queue.stop_workers();
+}
+
+TEST(Sched counter destroyed after wait) {
+  core::TaskQueue queue{};
+  queue.start_workers(2);
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  std::atomic<usize> clock{};
+  const usize job_count = 8;
+  for (usize round = 0; round < 256; round++) {
+    // the counter and its jobs are freed as soon as the wait returns, the last decrement must be done with them
+    auto* counter = new (alloc.allocate<core::JobCounter>()) core::JobCounter{};
+    core::Job* jobs[job_count];
+    stage_job data[job_count];
+    for (usize i = 0; i < job_count; i++) {
+      data[i] = {&clock, 0};
+      jobs[i] = new (alloc.allocate<core::Job>()) core::Job{};
+      jobs[i]->init(core::Task::from(stage, &data[i], core::TaskAffinity::Worker), counter);
+    }
+    // launched by the last decrement, after the counter is closed
+    core::Job follower;
+    stage_job follower_data{&clock, 0};
+    follower.init(core::Task::from(stage, &follower_data, core::TaskAffinity::Worker));
+    follower.depends_on(*counter);
+
+    queue.launch(follower);
+    for (auto* job : jobs) {
+      queue.launch(*job);
+    }
+    queue.wait(*counter);
+    for (auto* job : jobs) {
+      alloc.deallocate(job);
+    }
+    alloc.deallocate(counter);
+    queue.wait(follower.done);
+  }
+  queue.stop_workers();
+  tassert(clock == 256 * (job_count + 1), "every job should have run once, %zu ran", clock.load());
+}
+
+namespace {
+struct timed_job {
+  usize id;
+  u64 cost_ns;
+  usize* order;
+  usize* order_count;
+};
+
+core::TaskReturn spend(timed_job* job, core::TaskQueue*) {
+  u64 start = os::time_monotonic().ns;
+  while (os::time_monotonic().ns - start < job->cost_ns) {
+  }
+  job->order[(*job->order_count)++] = job->id;
+  return core::TaskReturn::Yield;
+}
+} // namespace
+
+TEST(Sched budget) {
+  core::TaskQueue queue{};
+  usize order[64];
+  usize order_count = 0;
+
+  // budgets are far from the cost of a background task, so only the bounds that hold whatever the
+  // machine does are checked: a task takes at least its cost, at most ceil(budget / cost) of them start
+  const u64 cost = MSEC(20zu);
+  timed_job critical{0, 0, order, &order_count};
+  timed_job interactive{1, 0, order, &order_count};
+  timed_job background[3];
+  for (usize i = 0; i < 3; i++) {
+    background[i] = {2 + i, cost, order, &order_count};
+  }
+  for (auto& job : background) {
+    queue.spawn(core::Task::from(spend, &job, core::TaskAffinity::Main, core::TaskPriority::Background));
+  }
+  queue.spawn(core::Task::from(spend, &interactive));
+  queue.spawn(core::Task::from(spend, &critical, core::TaskAffinity::Main, core::TaskPriority::FrameCritical));
+
+  // no budget: only the tasks that are not Background
+  queue.run(0);
+  tassert(order_count == 2, "only 2 tasks should have run, %zu did", order_count);
+  tassert(order[0] == 0 && order[1] == 1, "the frame critical task should run first");
+  tassert(queue.last_run.deferred == 3, "the background tasks should be deferred");
+
+  // a budget for one or two of them
+  order_count = 0;
+  queue.run(MSEC(30zu));
+  usize ran = order_count - 2;
+  tassert(ran >= 1 && ran <= 2, "1 or 2 background tasks should have run, %zu did", ran);
+  tassert(queue.last_run.deferred == 3 - ran, "the other background tasks should be deferred");
+  tassert(queue.last_run.background_ns >= ran * cost, "the background tasks should have been measured");
+  usize left = order[order_count - 1] + 1;
+
+  // the deferred one goes first, and one task is past a budget under its cost
+  order_count = 0;
+  queue.run(MSEC(10zu));
+  tassert(order_count == 3, "1 background task should have run, %zu did", order_count - 2);
+  tassert(order[2] == left, "task %zu should have run first, %zu did", left, order[2]);
+
+  // the frame budget is used up by the runs
+  queue.frame_budget_ns = MSEC(10zu);
+  order_count           = 0;
+  queue.run_frame_slice();
+  tassert(order_count == 3, "1 background task should have run, %zu did", order_count - 2);
+  tassert(queue.frame_budget_ns == 0, "the frame budget should be spent");
+  queue.run_frame_slice();
+  tassert(order_count == 3 + 2, "no background task should have run");
+}
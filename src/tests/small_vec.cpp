@@ -0,0 +1,45 @@
+#include "tests.h"
+
+#include <core/containers/small_vec.h>
+#include <core/core.h>
+
+TEST(small vec inline) {
+  core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::small_vec<usize, 4> v;
+  for (usize i = 0; i < 4; i++) {
+    v.push(alloc, i);
+  }
+  tassert(!v.is_spilled() && v.capacity() == 4, "4 elements should stay inline");
+  tassert((u8*)v.data() == v.inline_, "the data should be inline");
+
+  // a copy does not point into the original
+  auto copy = v;
+  copy[0]   = 42;
+  tassert(v[0] == 0 && copy[0] == 42 && (u8*)copy.data() == copy.inline_, "copies should own their inline elements");
+
+  core::small_vec<u32, 4> init{1, 2, 3};
+  tassert(init.size() == 3 && init[2] == 3, "invalid initializer list");
+}
+
+TEST(small vec spill) {
+  core::Allocator alloc = core::get_named_allocator(core::AllocatorName::General);
+  core::small_vec<usize, 4> v;
+  defer { v.reset(alloc); };
+
+  for (usize i = 0; i < 100; i++) {
+    v.push(alloc, i);
+  }
+  tassert(v.is_spilled() && v.capacity() >= 100, "100 elements should spill");
+  for (auto [i, x] : core::enumerate{v.iter()}) {
+    tassert(*x == i, "v[%zu] == %zu", i, *x);
+  }
+
+  while (v.size() > 3) {
+    v.pop(alloc);
+  }
+  tassert(!v.is_spilled() && v.capacity() == 4, "popping should come back inline");
+  tassert(v[0] == 0 && v[1] == 1 && v[2] == 2, "the elements should be moved back inline");
+
+  v.push(alloc, 3);
+  tassert(v.swap_last_pop(0) == 0 && v[0] == 3, "swap_last_pop");
+}
@@ -0,0 +1,116 @@
+#include "tests.h"
+
+#include <core/core.h>
+#include <core/core/sched.h>
+#include <core/core/sort.h>
+
+static u64 next_random(u64& state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+TEST(radix sort) {
+  auto scratch          = core::scratch_get();
+  core::Allocator alloc = scratch;
+
+  const usize n = 10000;
+  auto keys     = alloc.allocate_array<u64>(n);
+  auto small    = alloc.allocate_array<u32>(n);
+  u64 state     = 0x9E3779B97F4A7C15;
+  for (usize i = 0; i < n; i++) {
+    keys[i]  = next_random(state);
+    small[i] = (u32)(keys[i] % 1000);
+  }
+
+  core::radix_sort(keys);
+  core::radix_sort(small);
+  for (usize i = 1; i < n; i++) {
+    tassert(keys[i - 1] <= keys[i], "u64 keys are not sorted at %zu", i);
+    tassert(small[i - 1] <= small[i], "u32 keys are not sorted at %zu", i);
+  }
+}
+
+TEST(radix sort payload) {
+  auto scratch          = core::scratch_get();
+  core::Allocator alloc = scratch;
+
+  // only one byte differs, the other passes are skipped and the sort must stay stable
+  const usize n = 1000;
+  auto keys     = alloc.allocate_array<u32>(n);
+  auto values   = alloc.allocate_array<usize>(n);
+  for (usize i = 0; i < n; i++) {
+    keys[i]   = 0xAB00CD00 | (u32)((n - i) % 7) << 16;
+    values[i] = i;
+  }
+
+  core::radix_sort(keys, values);
+  for (usize i = 1; i < n; i++) {
+    tassert(keys[i - 1] <= keys[i], "keys are not sorted at %zu", i);
+    tassert(keys[i - 1] != keys[i] || values[i - 1] < values[i], "the sort is not stable at %zu", i);
+  }
+  for (usize i = 0; i < n; i++) {
+    tassert(keys[i] == (0xAB00CD00 | (u32)((n - values[i]) % 7) << 16), "values do not follow their keys");
+  }
+}
+
+namespace {
+void radix_sort_parallel_checks() {
+  auto scratch          = core::scratch_get();
+  core::Allocator alloc = scratch;
+
+  // the same keys and payloads through both sorts, the low byte is shared and its pass is skipped
+  const usize n = 100003;
+  auto keys     = alloc.allocate_array<u64>(n);
+  auto values   = alloc.allocate_array<u32>(n);
+  auto expected = alloc.allocate_array<u64>(n);
+  auto exp_vals = alloc.allocate_array<u32>(n);
+  u64 state     = 0x9E3779B97F4A7C15;
+  for (usize i = 0; i < n; i++) {
+    keys[i]   = (next_random(state) % 5000) << 8 | 0x42;
+    values[i] = (u32)i;
+  }
+  memcpy(expected.data, keys.data, n * sizeof(u64));
+  memcpy(exp_vals.data, values.data, n * sizeof(u32));
+
+  core::radix_sort(expected, exp_vals);
+  core::radix_sort_parallel(keys, values, 1000);
+  for (usize i = 0; i < n; i++) {
+    tassert(keys[i] == expected[i], "parallel keys differ from the serial sort at %zu", i);
+    tassert(values[i] == exp_vals[i], "parallel payloads differ from the serial sort at %zu, it is not stable", i);
+  }
+
+  auto small = alloc.allocate_array<u32>(n);
+  for (usize i = 0; i < n; i++) {
+    small[i] = (u32)next_random(state);
+  }
+  core::radix_sort_parallel(small, 1000);
+  for (usize i = 1; i < n; i++) {
+    tassert(small[i - 1] <= small[i], "u32 keys are not sorted at %zu", i);
+  }
+}
+} // namespace
+
+TEST(radix sort parallel inline) {
+  radix_sort_parallel_checks();
+}
+
+TEST(radix sort parallel workers) {
+  auto* queue = core::default_task_queue();
+  queue->start_workers(3);
+  radix_sort_parallel_checks();
+  queue->stop_workers();
+}
+
+TEST(sort key) {
+  u64 a = core::sort_key{}.push(1, 8).push(200, 16).finish();
+  u64 b = core::sort_key{}.push(1, 8).push(300, 16).finish();
+  u64 c = core::sort_key{}.push(2, 8).push(0, 16).finish();
+  tassert(a < b && b < c, "the first field should be the most significant");
+  tassert((a & 0xFFFFFFFFFF) == 0, "the fields should be at the top of the key");
+
+  tassert(core::sort_key_from_f32(-2.f) < core::sort_key_from_f32(-1.f), "negative floats order");
+  tassert(core::sort_key_from_f32(-1.f) < core::sort_key_from_f32(0.f), "sign order");
+  tassert(core::sort_key_from_f32(0.5f) < core::sort_key_from_f32(3.f), "positive floats order");
+}
@@ -73,3 +73,49 @@ TEST(stable vec iter) {
     tassert(int(i + 1) == t, "iterate2");
   }
 }
+
+TEST(stable vec random access) {
+  auto scratch = core::scratch_get();
+
+  core::stable_vec<usize, 256> sv;
+  for (usize i = 0; i < 10000; i++) {
+    sv.push(scratch, i);
+  }
+  usize* first = &sv[0];
+  tassert(sv.size() == 10000, "invalid size");
+  for (usize i = 0; i < 10000; i += 37) {
+    tassert(sv[i] == i, "sv[%zu] == %zu", i, sv[i]);
+  }
+
+  // popped blocks are kept and reused
+  usize capacity = sv.capacity();
+  for (usize i = 0; i < 5000; i++) {
+    sv.pop();
+  }
+  for (usize i = 0; i < 5000; i++) {
+    sv.push(scratch, 5000 + i);
+  }
+  tassert(sv.capacity() == capacity, "blocks should be reused");
+  tassert(&sv[0] == first && sv[9999] == 9999, "elements should not move");
+  sv.deallocate(scratch);
+}
+
+TEST(stable vec chunks) {
+  auto scratch = core::scratch_get();
+
+  core::stable_vec<int, 32> sv;
+  for (int i = 0; i < 5; i++) {
+    sv.push(scratch, i);
+  }
+
+  usize chunk_count = 0;
+  int next          = 0;
+  for (auto chunk : sv.chunks()) {
+    tassert(chunk.size == 2 || chunk_count == 2, "only the last chunk can be partial");
+    for (auto& t : chunk.iter()) {
+      tassert(t == next++, "chunks should be in order");
+    }
+    chunk_count++;
+  }
+  tassert(chunk_count == 3 && next == 5, "invalid chunk count");
+}
@@ -0,0 +1,249 @@
+#include "tests.h"
+
+#include <core/containers/sync.h>
+#include <core/core.h>
+
+#include <atomic>
+#include <thread>
+
+TEST(spsc queue) {
+  auto scratch = core::scratch_get();
+
+  core::sync::spsc_queue<usize> q;
+  q.init(scratch, 100);
+  tassert(q.capacity() == 128, "capacity should be rounded up to a power of two");
+  tassert(q.try_pop().is_none(), "queue should be empty");
+  for (usize i = 0; i < 128; i++) {
+    tassert(q.try_push(i), "push %zu should succeed", i);
+  }
+  tassert(!q.try_push(128), "queue should be full");
+  tassert(*q.try_pop() == 0, "queue should be fifo");
+
+  const usize count = 1 << 18;
+  q.init(scratch, 64);
+  std::thread producer([&] {
+    for (usize i = 0; i < count; i++) {
+      while (!q.try_push(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  usize expected = 0;
+  while (expected < count) {
+    auto v = q.try_pop();
+    if (v.is_none()) {
+      std::this_thread::yield();
+      continue;
+    }
+    tassert(*v == expected, "got %zu instead of %zu", *v, expected);
+    expected++;
+  }
+  producer.join();
+  tassert(q.try_pop().is_none(), "queue should be empty");
+}
+
+TEST(mpmc queue stress) {
+  auto scratch = core::scratch_get();
+
+  core::sync::mpmc_queue<usize> q;
+  q.init(scratch, 256);
+
+  const usize producer_count = 4, consumer_count = 4;
+  const usize per_producer   = 1 << 16;
+  std::atomic<usize> sum{}, popped{};
+  // each producer pushes an increasing sequence, each consumer checks it never sees it going back
+  auto encode = [](usize producer, usize i) { return (producer << 32) | i; };
+
+  std::thread threads[producer_count + consumer_count];
+  for (usize p = 0; p < producer_count; p++) {
+    threads[p] = std::thread([&, p] {
+      for (usize i = 0; i < per_producer; i++) {
+        while (!q.try_push(encode(p, i))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  std::atomic<bool> ordered = true;
+  for (usize c = 0; c < consumer_count; c++) {
+    threads[producer_count + c] = std::thread([&] {
+      usize last[producer_count]{};
+      bool seen[producer_count]{};
+      while (popped.load(std::memory_order_relaxed) < producer_count * per_producer) {
+        auto v = q.try_pop();
+        if (v.is_none()) {
+          std::this_thread::yield();
+          continue;
+        }
+        usize p = *v >> 32, i = *v & 0xFFFFFFFF;
+        if (seen[p] && i <= last[p]) {
+          ordered.store(false, std::memory_order_relaxed);
+        }
+        seen[p] = true;
+        last[p] = i;
+        sum.fetch_add(i, std::memory_order_relaxed);
+        popped.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  tassert(popped.load() == producer_count * per_producer, "every item should be popped once");
+  tassert(sum.load() == producer_count * (per_producer * (per_producer - 1) / 2), "items should not be corrupted");
+  tassert(ordered.load(), "items of a producer should be popped in order");
+  tassert(q.try_pop().is_none(), "queue should be empty");
+}
+
+static std::atomic<usize> counted_frees{};
+static const core::AllocatorVTable counting_vtable{
+    .allocate        = core::MallocVtable.allocate,
+    .allocate_uninit = core::MallocVtable.allocate_uninit,
+    .deallocate =
+        [](void* userdata, void* ptr, usize size, const char* src) {
+          counted_frees.fetch_add(1);
+          core::MallocVtable.deallocate(userdata, ptr, size, src);
+        },
+    .try_resize = core::MallocVtable.try_resize,
+    .owns       = core::MallocVtable.owns,
+};
+
+TEST(epoch reclamation) {
+  core::Allocator alloc{nullptr, &counting_vtable};
+  counted_frees = 0;
+
+  void* p = alloc.allocate(16);
+  {
+    core::sync::epoch_guard guard;
+    core::sync::epoch_retire(alloc, p, 16);
+    core::sync::epoch_collect();
+    core::sync::epoch_collect();
+    tassert(counted_frees == 0, "a node should not be freed while a guard that could see it is alive");
+  }
+
+  for (usize i = 0; i < 3 && counted_frees == 0; i++) {
+    core::sync::epoch_collect();
+  }
+  tassert(counted_frees == 1, "the node should be freed once the guard is gone");
+}
+
+TEST(epoch reclamation stack stress) {
+  core::Allocator alloc{nullptr, &counting_vtable};
+  counted_frees = 0;
+
+  using stack = core::sync::stack<usize>;
+  stack s;
+  const usize thread_count = 4, per_thread = 1 << 14;
+
+  std::thread threads[thread_count];
+  for (usize t = 0; t < thread_count; t++) {
+    threads[t] = std::thread([&] {
+      for (usize i = 0; i < per_thread; i++) {
+        auto* n = stack::allocate_node(alloc);
+        n->data = i;
+        s.push(n);
+        if (auto* popped = s.pop()) {
+          stack::retire_node(alloc, popped);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  while (auto* popped = s.pop()) {
+    stack::retire_node(alloc, popped);
+  }
+
+  for (usize i = 0; i < 4; i++) {
+    core::sync::epoch_collect();
+  }
+  tassert(counted_frees == thread_count * per_thread, "every node should be freed, %zu are", counted_frees.load());
+  tassert(core::sync::epoch_stats().retired == 0, "nothing should be waiting");
+}
+
+TEST(ws deque) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  core::sync::ws_deque<usize> d;
+  d.init(alloc, 4);
+  tassert(d.pop().is_none(), "deque should be empty");
+  tassert(d.steal().is_none(), "deque should be empty");
+  // grows past the initial capacity
+  for (usize i = 0; i < 10; i++) {
+    d.push(i);
+  }
+  tassert(d.size() == 10, "deque should have 10 items, has %zu", d.size());
+  tassert(*d.pop() == 9, "owner should pop the last pushed");
+  tassert(*d.steal() == 0, "thieves should steal the first pushed");
+  tassert(*d.steal() == 1, "thieves should steal the first pushed");
+  for (usize i = 8; i >= 2; i--) {
+    tassert(*d.pop() == i, "owner should pop in lifo order");
+  }
+  tassert(d.pop().is_none(), "deque should be empty");
+  d.deallocate();
+  core::sync::epoch_collect();
+}
+
+TEST(ws deque stress) {
+  auto alloc = core::get_named_allocator(core::AllocatorName::General);
+
+  core::sync::ws_deque<usize> d;
+  d.init(alloc, 16);
+  const usize thief_count = 3, count = 1 << 16;
+  core::storage<std::atomic<u8>> taken{count, new std::atomic<u8>[count]{}};
+  std::atomic<usize> total{};
+  std::atomic<bool> done{};
+
+  std::thread thieves[thief_count];
+  for (auto& t : thieves) {
+    t = std::thread([&] {
+      while (!done.load()) {
+        auto v = d.steal();
+        if (v.is_none()) {
+          std::this_thread::yield();
+          continue;
+        }
+        taken[*v]++;
+        total++;
+      }
+    });
+  }
+
+  // the owner pushes and pops in bursts, the thieves take what it leaves
+  for (usize i = 0; i < count; i++) {
+    d.push(i);
+    if (i % 3 == 0) {
+      if (auto v = d.pop(); v.is_some()) {
+        taken[*v]++;
+        total++;
+      }
+    }
+    if (i % 1024 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  for (auto v = d.pop(); v.is_some(); v = d.pop()) {
+    taken[*v]++;
+    total++;
+  }
+  while (total.load() < count) {
+    std::this_thread::yield();
+  }
+  done = true;
+  for (auto& t : thieves) {
+    t.join();
+  }
+
+  tassert(total == count, "%zu items taken for %zu pushed", total.load(), count);
+  for (usize i = 0; i < count; i++) {
+    tassert(taken[i] == 1, "item %zu taken %u times", i, (u32)taken[i].load());
+  }
+  delete[] taken.data;
+  d.deallocate();
+  for (usize i = 0; i < 4; i++) {
+    core::sync::epoch_collect();
+  }
+}
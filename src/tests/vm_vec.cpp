@@ -0,0 +1,44 @@
+#include "tests.h"
+
+#include <core/containers/vm_vec.h>
+#include <core/core.h>
+
+TEST(vm vec) {
+  core::vm_vec<usize> v;
+  defer { v.deallocate(); };
+  tassert(v.capacity() == 0 && v.data() == nullptr, "nothing should be reserved before the first push");
+
+  v.push(0);
+  usize* first = v.data();
+  tassert(v.capacity() * sizeof(usize) == VM_VEC_MIN_COMMIT, "invalid capacity");
+
+  for (usize i = 1; i < 100000; i++) {
+    v.push(i);
+  }
+  tassert(v.data() == first, "growing should not move the elements");
+  tassert(v.size() == 100000 && v.capacity() >= v.size(), "invalid size");
+  for (auto [i, x] : core::enumerate{v.iter()}) {
+    tassert(*x == i, "v[%zu] == %zu", i, *x);
+  }
+
+  tassert(v.pop() == 99999, "pop 99999");
+  v.reset();
+  tassert(v.size() == 0 && v.capacity() == 0, "reset should decommit everything");
+  v.push(42);
+  tassert(v.data() == first && v[0] == 42, "the range should be reused after a reset");
+}
+
+TEST(vm vec shrink) {
+  core::vm_vec<u8> v{MB(1zu)};
+  defer { v.deallocate(); };
+  tassert(v.max_capacity() == MB(1zu), "invalid max capacity");
+
+  v.set_size(MB(1zu));
+  tassert(v.capacity() == MB(1zu), "the whole range should be committed");
+  memset(v.data(), 1, v.size());
+
+  v.set_size(10);
+  v.shrink_to_fit();
+  tassert(v.capacity() == VM_VEC_MIN_COMMIT, "shrink_to_fit should keep a single commit chunk");
+  tassert(v[9] == 1, "shrink_to_fit should keep the elements");
+}